@@ -0,0 +1,128 @@
+#include "AssetLoader.h"
+
+#include <algorithm>
+
+void AssetLoader::Initialise(uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+	threadCount = std::min(threadCount, ASSET_LOADER_MAX_THREADS);
+
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(&AssetLoader::workerLoop, this);
+	}
+
+	std::cout << "Asset loader started with " << threadCount << " threads.\n";
+}
+
+void AssetLoader::Request(uint32_t asset, AssetDecode decode)
+{
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+		requests.push_back({ asset, decode, std::chrono::steady_clock::now() });
+	}
+
+	requestReady.notify_one();
+	requestCount++;
+}
+
+VkDeviceSize AssetLoader::Drain(VkDeviceSize byteBudget)
+{
+	VkDeviceSize uploadedBytes = 0;
+	LoadResult result;
+
+	while (uploadedBytes < byteBudget && finished.Pop(result))
+	{
+		finishedCount.fetch_sub(1, std::memory_order_acq_rel);
+
+		uploadedBytes += result.upload();
+
+		auto uploaded = std::chrono::steady_clock::now();
+		uploadCount++;
+		decodeTimeSum += result.decodeTime;
+		latencySum += std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(uploaded - result.requested).count();
+	}
+
+	return uploadedBytes;
+}
+
+void AssetLoader::ReportMetrics()
+{
+	std::cout << "Asset loader: " << requestCount << " requests, " << uploadCount << " uploaded";
+	if (uploadCount > 0)
+	{
+		std::cout << ", " << decodeTimeSum / uploadCount << " milliseconds average decode, " << latencySum / uploadCount << " milliseconds average request to upload";
+	}
+	std::cout << ".\n";
+}
+
+void AssetLoader::Release()
+{
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+		stopping = true;
+		requests.clear();
+	}
+
+	requestReady.notify_all();
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+
+	//Drop decodes that were never uploaded, their data is freed with the upload
+	LoadResult result;
+	while (finished.Pop(result))
+	{
+		finishedCount.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
+
+void AssetLoader::workerLoop()
+{
+	for (;;)
+	{
+		LoadRequest request;
+		{
+			std::unique_lock<std::mutex> lock(requestMutex);
+			requestReady.wait(lock, [this]() { return stopping || !requests.empty(); });
+
+			if (stopping)
+			{
+				return;
+			}
+
+			request = requests.front();
+			requests.pop_front();
+		}
+
+		auto decodeStart = std::chrono::steady_clock::now();
+
+		LoadResult result;
+		result.asset = request.asset;
+		result.upload = request.decode();
+		result.requested = request.requested;
+
+		auto decodeEnd = std::chrono::steady_clock::now();
+		result.decodeTime = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(decodeEnd - decodeStart).count();
+
+		//The render thread drains a budget per frame, back off until it has made room
+		while (!finished.Push(std::move(result)))
+		{
+			if (stopping)
+			{
+				return;
+			}
+
+			std::this_thread::yield();
+		}
+
+		finishedCount.fetch_add(1, std::memory_order_acq_rel);
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "LockFreeQueue.h"
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <chrono>
+
+//Run on the render thread once the asset has been decoded, records its upload and returns the bytes uploaded
+typedef std::function<VkDeviceSize()> AssetUpload;
+
+//Run on a loader thread to parse and decode an asset, must only read state the render thread does not write
+typedef std::function<AssetUpload()> AssetDecode;
+
+//Upper bound on loader threads, the default leaves one core to the render thread
+const uint32_t ASSET_LOADER_MAX_THREADS = 4;
+
+//Decoded assets waiting for the render thread, loader threads back off while it is full
+const size_t ASSET_LOADER_QUEUE_SIZE = 64;
+
+//Pool of threads decoding assets off the render thread. Finished decodes are handed back through a lock-free queue
+//and their uploads recorded by Drain, so the render thread never waits on a file or a decoder
+class AssetLoader
+{
+public:
+	//Zero picks the thread count from the hardware concurrency
+	void Initialise(uint32_t threadCount);
+
+	void Request(uint32_t asset, AssetDecode decode);
+
+	//Run the uploads of finished decodes until byteBudget has been recorded, never blocks. Returns the bytes uploaded
+	VkDeviceSize Drain(VkDeviceSize byteBudget);
+
+	bool HasFinished() const { return finishedCount.load(std::memory_order_acquire) > 0; }
+
+	void ReportMetrics();
+
+	//Joins the threads, requests not yet uploaded are dropped
+	void Release();
+
+private:
+	struct LoadRequest
+	{
+		uint32_t asset;
+		AssetDecode decode;
+		std::chrono::time_point<std::chrono::steady_clock> requested;
+	};
+
+	struct LoadResult
+	{
+		uint32_t asset;
+		AssetUpload upload;
+		double decodeTime; //Milliseconds on the loader thread
+		std::chrono::time_point<std::chrono::steady_clock> requested;
+	};
+
+	std::vector<std::thread> workers;
+
+	std::mutex requestMutex;
+	std::condition_variable requestReady;
+	std::deque<LoadRequest> requests;
+	std::atomic<bool> stopping{ false };
+
+	LockFreeQueue<LoadResult, ASSET_LOADER_QUEUE_SIZE> finished;
+	std::atomic<uint32_t> finishedCount{ 0 };
+
+	uint32_t requestCount = 0;
+	uint32_t uploadCount = 0;
+	double decodeTimeSum = 0;
+	double latencySum = 0; //Milliseconds from request to upload
+
+	void workerLoop();
+};
@@ -0,0 +1,112 @@
+#include "AssetPack.h"
+
+#include <cstring>
+#include <sys/stat.h>
+
+bool AssetPack::Write(const std::string &path, const uint32_t metadata[4], const void *data, uint64_t size, bool compress, const std::string &sourcePath)
+{
+	const uint8_t *bytes = reinterpret_cast<const uint8_t*>(data);
+
+	std::vector<uint8_t> compressed;
+	if (compress)
+	{
+		compressed = BlockCompression::Compress(bytes, (size_t)size);
+	}
+
+	AssetPackHeader header = {};
+	header.magic = ASSET_PACK_MAGIC;
+	header.version = ASSET_PACK_VERSION;
+	header.compressed = compress ? 1 : 0;
+	memcpy(header.metadata, metadata, sizeof(header.metadata));
+	header.rawSize = size;
+	header.storedSize = compress ? compressed.size() : size;
+	if (!sourcePath.empty())
+	{
+		GetSourceStamp(sourcePath, header.source);
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Failed to create asset pack " << path << ".\n";
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(compress ? compressed.data() : bytes), header.storedSize);
+
+	if (!file.good())
+	{
+		std::cout << "Failed to write asset pack " << path << ".\n";
+		return false;
+	}
+
+	std::cout << "Asset pack " << path << " written: " << header.rawSize << " bytes stored as " << header.storedSize << ".\n";
+
+	return true;
+}
+
+bool AssetPack::Read(const std::string &path, AssetPackHeader &header, std::vector<uint8_t> &stored, const std::string &sourcePath)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file.good() || header.magic != ASSET_PACK_MAGIC || header.version != ASSET_PACK_VERSION)
+	{
+		std::cout << "Asset pack " << path << " is not valid.\n";
+		return false;
+	}
+
+	SourceStamp source;
+	if (!sourcePath.empty() && GetSourceStamp(sourcePath, source) && (source.size != header.source.size || source.modifiedTime != header.source.modifiedTime))
+	{
+		std::cout << "Asset pack " << path << " is older than " << sourcePath << ", rebuilding it.\n";
+		return false;
+	}
+
+	stored.resize((size_t)header.storedSize);
+	file.read(reinterpret_cast<char*>(stored.data()), stored.size());
+	if (!file.good())
+	{
+		std::cout << "Asset pack " << path << " is truncated.\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool AssetPack::Decode(const AssetPackHeader &header, const std::vector<uint8_t> &stored, void *destination, uint32_t threadCount)
+{
+	uint8_t *bytes = reinterpret_cast<uint8_t*>(destination);
+
+	if (!header.compressed)
+	{
+		if (stored.size() != header.rawSize)
+		{
+			return false;
+		}
+
+		memcpy(bytes, stored.data(), stored.size());
+		return true;
+	}
+
+	return BlockCompression::Decompress(stored.data(), stored.size(), bytes, (size_t)header.rawSize, threadCount);
+}
+
+bool AssetPack::GetSourceStamp(const std::string &path, SourceStamp &stamp)
+{
+	struct stat status;
+	if (stat(path.c_str(), &status) != 0)
+	{
+		return false;
+	}
+
+	stamp.size = (uint64_t)status.st_size;
+	stamp.modifiedTime = (int64_t)status.st_mtime;
+
+	return true;
+}
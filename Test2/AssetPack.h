@@ -0,0 +1,51 @@
+#pragma once
+
+#include "BlockCompression.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+const uint32_t ASSET_PACK_MAGIC = 0x4B504341; //"ACPK"
+const uint32_t ASSET_PACK_VERSION = 2;
+
+//Size and modification time of the file a cache was built from. A cache whose recorded stamp no longer matches its
+//source is rebuilt
+struct SourceStamp
+{
+	uint64_t size;
+	int64_t modifiedTime; //Seconds since the epoch
+};
+
+//Start of a pack file, followed by the payload either as stored or as a BlockCompression stream
+struct AssetPackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t compressed;
+	uint32_t metadata[4]; //Owner defined, image dimensions or element counts
+	uint32_t reserved;
+	uint64_t rawSize;
+	uint64_t storedSize;
+	SourceStamp source; //Zero when written without a source
+};
+
+//Single asset cache file holding already decoded data, so a load is a read and an optional decompression rather than a
+//parse. Reading only fetches the stored bytes, decoding is left to the caller so it can target mapped memory
+class AssetPack
+{
+public:
+	//The stamp of sourcePath is recorded so a later Read can tell the pack has gone stale
+	static bool Write(const std::string &path, const uint32_t metadata[4], const void *data, uint64_t size, bool compress, const std::string &sourcePath = std::string());
+
+	//Returns false if the file is missing, not a pack or built from an older version of sourcePath, stored receives the
+	//payload as it is on disk. A source that cannot be found leaves the pack in use
+	static bool Read(const std::string &path, AssetPackHeader &header, std::vector<uint8_t> &stored, const std::string &sourcePath = std::string());
+
+	//Expand a payload read above into destination, which must hold header.rawSize bytes
+	static bool Decode(const AssetPackHeader &header, const std::vector<uint8_t> &stored, void *destination, uint32_t threadCount = 0);
+
+	//Returns false if the file cannot be found
+	static bool GetSourceStamp(const std::string &path, SourceStamp &stamp);
+};
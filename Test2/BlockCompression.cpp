@@ -0,0 +1,321 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const uint32_t MIN_MATCH = 4;
+	const uint32_t MAX_OFFSET = 65535;
+	const uint32_t HASH_BITS = 14;
+
+	//The decoder copies without bounds checks near the end, so the tail is always literals
+	const size_t LAST_LITERALS = 5;
+	const size_t MATCH_SEARCH_LIMIT = 12;
+
+	uint32_t read32(const uint8_t *source)
+	{
+		uint32_t value;
+		memcpy(&value, source, sizeof(value));
+		return value;
+	}
+
+	uint32_t hashSequence(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+}
+
+std::vector<uint8_t> BlockCompression::Compress(const uint8_t *data, size_t size)
+{
+	CompressedStreamHeader header = {};
+	header.magic = COMPRESSED_STREAM_MAGIC;
+	header.blockSize = COMPRESSION_BLOCK_SIZE;
+	header.blockCount = (uint32_t)((size + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE);
+	header.rawSize = size;
+
+	std::vector<CompressedBlock> blocks(header.blockCount);
+	size_t tableEnd = sizeof(CompressedStreamHeader) + blocks.size() * sizeof(CompressedBlock);
+
+	//Worst case is every byte a literal plus the length bytes
+	std::vector<uint8_t> stream(tableEnd);
+	std::vector<uint8_t> scratch(COMPRESSION_BLOCK_SIZE + COMPRESSION_BLOCK_SIZE / 255 + 16);
+
+	for (uint32_t b = 0; b < header.blockCount; b++)
+	{
+		size_t blockStart = (size_t)b * COMPRESSION_BLOCK_SIZE;
+		size_t blockSize = std::min((size_t)COMPRESSION_BLOCK_SIZE, size - blockStart);
+
+		size_t compressedSize = compressBlock(data + blockStart, blockSize, scratch.data(), scratch.size());
+
+		blocks[b].offset = stream.size();
+		blocks[b].rawSize = (uint32_t)blockSize;
+
+		if (compressedSize > 0 && compressedSize < blockSize)
+		{
+			blocks[b].storedSize = (uint32_t)compressedSize;
+			stream.insert(stream.end(), scratch.begin(), scratch.begin() + compressedSize);
+		}
+		else
+		{
+			blocks[b].storedSize = (uint32_t)blockSize;
+			stream.insert(stream.end(), data + blockStart, data + blockStart + blockSize);
+		}
+	}
+
+	memcpy(stream.data(), &header, sizeof(header));
+	if (!blocks.empty())
+	{
+		memcpy(stream.data() + sizeof(header), blocks.data(), blocks.size() * sizeof(CompressedBlock));
+	}
+
+	return stream;
+}
+
+bool BlockCompression::ReadHeader(const uint8_t *stream, size_t streamSize, CompressedStreamHeader &header)
+{
+	if (streamSize < sizeof(CompressedStreamHeader))
+	{
+		return false;
+	}
+
+	memcpy(&header, stream, sizeof(header));
+
+	return header.magic == COMPRESSED_STREAM_MAGIC && header.blockSize > 0 &&
+		sizeof(CompressedStreamHeader) + (size_t)header.blockCount * sizeof(CompressedBlock) <= streamSize;
+}
+
+bool BlockCompression::Decompress(const uint8_t *stream, size_t streamSize, uint8_t *destination, size_t destinationSize, uint32_t threadCount)
+{
+	CompressedStreamHeader header;
+	if (!ReadHeader(stream, streamSize, header) || header.rawSize != destinationSize)
+	{
+		return false;
+	}
+
+	const CompressedBlock *blocks = reinterpret_cast<const CompressedBlock*>(stream + sizeof(CompressedStreamHeader));
+
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = std::min(std::min(threadCount, COMPRESSION_MAX_THREADS), std::max(header.blockCount, 1u));
+
+	//Threads claim blocks in order until none are left
+	std::atomic<uint32_t> nextBlock{ 0 };
+	std::atomic<bool> failed{ false };
+
+	auto decodeBlocks = [&]()
+	{
+		for (uint32_t b = nextBlock.fetch_add(1); b < header.blockCount && !failed; b = nextBlock.fetch_add(1))
+		{
+			const CompressedBlock &block = blocks[b];
+			size_t rawOffset = (size_t)b * header.blockSize;
+
+			if (block.offset + block.storedSize > streamSize || rawOffset + block.rawSize > destinationSize)
+			{
+				failed = true;
+			}
+			else if (block.storedSize == block.rawSize)
+			{
+				memcpy(destination + rawOffset, stream + block.offset, block.rawSize);
+			}
+			else if (!decompressBlock(stream + block.offset, block.storedSize, destination + rawOffset, block.rawSize))
+			{
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (uint32_t i = 1; i < threadCount; i++)
+	{
+		workers.emplace_back(decodeBlocks);
+	}
+
+	decodeBlocks();
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+
+	return !failed;
+}
+
+size_t BlockCompression::compressBlock(const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t capacity)
+{
+	std::vector<uint32_t> table((size_t)1 << HASH_BITS, UINT32_MAX);
+
+	size_t output = 0;
+	size_t anchor = 0;
+	size_t position = 0;
+
+	auto emitSequence = [&](size_t literalCount, size_t offset, size_t matchLength) -> bool
+	{
+		if (output + 1 + literalCount + literalCount / 255 + 2 + matchLength / 255 + 2 > capacity)
+		{
+			return false;
+		}
+
+		uint8_t &token = destination[output++];
+		token = (uint8_t)(std::min(literalCount, (size_t)15) << 4);
+		if (literalCount >= 15)
+		{
+			output += writeLength(destination + output, literalCount - 15);
+		}
+
+		memcpy(destination + output, source + anchor, literalCount);
+		output += literalCount;
+
+		//The final sequence is literals only
+		if (matchLength == 0)
+		{
+			return true;
+		}
+
+		destination[output++] = (uint8_t)(offset & 0xFF);
+		destination[output++] = (uint8_t)(offset >> 8);
+
+		size_t matchCode = matchLength - MIN_MATCH;
+		token |= (uint8_t)std::min(matchCode, (size_t)15);
+		if (matchCode >= 15)
+		{
+			output += writeLength(destination + output, matchCode - 15);
+		}
+
+		return true;
+	};
+
+	if (sourceSize > MATCH_SEARCH_LIMIT)
+	{
+		size_t searchEnd = sourceSize - MATCH_SEARCH_LIMIT;
+		size_t matchEnd = sourceSize - LAST_LITERALS;
+
+		while (position < searchEnd)
+		{
+			uint32_t sequence = read32(source + position);
+			uint32_t hash = hashSequence(sequence);
+			uint32_t candidate = table[hash];
+			table[hash] = (uint32_t)position;
+
+			if (candidate == UINT32_MAX || position - candidate > MAX_OFFSET || read32(source + candidate) != sequence)
+			{
+				position++;
+				continue;
+			}
+
+			size_t matchLength = MIN_MATCH;
+			while (position + matchLength < matchEnd && source[candidate + matchLength] == source[position + matchLength])
+			{
+				matchLength++;
+			}
+
+			if (!emitSequence(position - anchor, position - candidate, matchLength))
+			{
+				return 0;
+			}
+
+			position += matchLength;
+			anchor = position;
+		}
+	}
+
+	if (!emitSequence(sourceSize - anchor, 0, 0))
+	{
+		return 0;
+	}
+
+	return output;
+}
+
+bool BlockCompression::decompressBlock(const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationSize)
+{
+	size_t input = 0;
+	size_t output = 0;
+
+	auto readLength = [&](size_t &length) -> bool
+	{
+		uint8_t byte;
+		do
+		{
+			if (input >= sourceSize)
+			{
+				return false;
+			}
+			byte = source[input++];
+			length += byte;
+		} while (byte == 255);
+
+		return true;
+	};
+
+	while (input < sourceSize)
+	{
+		uint8_t token = source[input++];
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !readLength(literalCount))
+		{
+			return false;
+		}
+
+		if (input + literalCount > sourceSize || output + literalCount > destinationSize)
+		{
+			return false;
+		}
+
+		memcpy(destination + output, source + input, literalCount);
+		input += literalCount;
+		output += literalCount;
+
+		//Only the last sequence ends after its literals
+		if (input == sourceSize)
+		{
+			break;
+		}
+
+		if (input + 2 > sourceSize)
+		{
+			return false;
+		}
+
+		size_t offset = source[input] | (source[input + 1] << 8);
+		input += 2;
+
+		size_t matchLength = token & 0x0F;
+		if (matchLength == 15 && !readLength(matchLength))
+		{
+			return false;
+		}
+		matchLength += MIN_MATCH;
+
+		if (offset == 0 || offset > output || output + matchLength > destinationSize)
+		{
+			return false;
+		}
+
+		//Matches may overlap their own output, copied forwards in pieces no longer than the offset when they do
+		const uint8_t *match = destination + output - offset;
+		for (size_t copied = 0; copied < matchLength; copied += offset)
+		{
+			memcpy(destination + output + copied, match + copied, std::min(offset, matchLength - copied));
+		}
+		output += matchLength;
+	}
+
+	return output == destinationSize;
+}
+
+size_t BlockCompression::writeLength(uint8_t *destination, size_t length)
+{
+	size_t written = 0;
+	while (length >= 255)
+	{
+		destination[written++] = 255;
+		length -= 255;
+	}
+	destination[written++] = (uint8_t)length;
+
+	return written;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+//Uncompressed bytes per block, blocks decode independently so a stream decodes on as many threads as it has blocks
+const uint32_t COMPRESSION_BLOCK_SIZE = 256 * 1024;
+
+//Upper bound on decompression threads per stream
+const uint32_t COMPRESSION_MAX_THREADS = 8;
+
+const uint32_t COMPRESSED_STREAM_MAGIC = 0x315A4C42; //"BLZ1"
+
+struct CompressedStreamHeader
+{
+	uint32_t magic;
+	uint32_t blockSize;
+	uint32_t blockCount;
+	uint32_t reserved;
+	uint64_t rawSize;
+};
+
+//Followed by the block table, offsets are from the start of the stream. A block stored at its raw size did not shrink
+//and is kept as is
+struct CompressedBlock
+{
+	uint64_t offset;
+	uint32_t storedSize;
+	uint32_t rawSize;
+};
+
+//In-tree LZ77 codec in the LZ4 sequence layout: a token holding the literal and match lengths, the literals, then a
+//16 bit offset back into the output. Matches are found through a hash of the next four bytes, favouring decode speed
+//over ratio
+class BlockCompression
+{
+public:
+	static std::vector<uint8_t> Compress(const uint8_t *data, size_t size);
+
+	//Returns false if the stream is malformed
+	static bool ReadHeader(const uint8_t *stream, size_t streamSize, CompressedStreamHeader &header);
+
+	//Decode every block straight into destination, which must hold the raw size. Blocks write disjoint ranges so
+	//destination can be mapped staging memory. Zero threads picks one per block up to the hardware and the limit above
+	static bool Decompress(const uint8_t *stream, size_t streamSize, uint8_t *destination, size_t destinationSize, uint32_t threadCount = 0);
+
+private:
+	static size_t compressBlock(const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t capacity);
+	static bool decompressBlock(const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationSize);
+	static size_t writeLength(uint8_t *destination, size_t length);
+};
@@ -0,0 +1,275 @@
+#include "ChunkStreamer.h"
+
+void ChunkStreamer::Initialise(const std::vector<ChunkRecord> &chunkRecords, uint32_t slotCount, SyncTimeline *timeline)
+{
+	syncTimeline = timeline;
+	records = chunkRecords;
+	slots.resize(slotCount);
+
+	Reset();
+}
+
+bool ChunkStreamer::Update(const glm::mat4 &modelViewProjection, const glm::vec3 &cameraPosition)
+{
+	frame++;
+	visibleCount = 0;
+
+	std::vector<ChunkDraw> frameDrawList;
+
+	for (uint32_t c = 0; c < chunks.size(); c++)
+	{
+		ChunkState &state = chunks[c];
+		state.wantedLod = -1;
+
+		const ChunkRecord &record = records[c];
+		if (!IsBoxVisible(glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]), glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]), modelViewProjection))
+		{
+			continue;
+		}
+
+		visibleCount++;
+		state.wantedLod = (int32_t)selectLod(record, cameraPosition);
+
+		//Whatever level is resident is drawn until the wanted one arrives, so chunks do not pop out while streaming
+		uint32_t slot = drawableSlot(state);
+		if (slot != UINT32_MAX)
+		{
+			slots[slot].lastUsedFrame = frame;
+			frameDrawList.push_back({ slot, record.lods[slots[slot].lod].indexCount });
+		}
+	}
+
+	bool changed = !(frameDrawList == drawList);
+	drawList.swap(frameDrawList);
+
+	return changed;
+}
+
+void ChunkStreamer::MarkDrawn(SyncTicket ticket)
+{
+	for (const ChunkDraw &draw : drawList)
+	{
+		slots[draw.slot].drawnTicket = ticket;
+	}
+}
+
+bool ChunkStreamer::NextLoad(uint32_t &chunk, uint32_t &lod, uint32_t &slot)
+{
+	if (loadingCount >= CHUNK_MAX_LOADS_IN_FLIGHT)
+	{
+		return false;
+	}
+
+	//Visible chunks with nothing to draw come first, then those drawn at the wrong level of detail
+	for (uint32_t pass = 0; pass < 2; pass++)
+	{
+		for (uint32_t c = 0; c < chunks.size(); c++)
+		{
+			ChunkState &state = chunks[c];
+			if (state.wantedLod < 0 || state.slots[state.wantedLod] != UINT32_MAX)
+			{
+				continue;
+			}
+
+			if (pass == 0 && drawableSlot(state) != UINT32_MAX)
+			{
+				continue;
+			}
+
+			slot = acquireSlot();
+			if (slot == UINT32_MAX)
+			{
+				return false;
+			}
+
+			chunk = c;
+			lod = (uint32_t)state.wantedLod;
+
+			slots[slot].chunk = chunk;
+			slots[slot].lod = lod;
+			slots[slot].lastUsedFrame = frame;
+			slots[slot].state = SLOT_LOADING;
+			state.slots[lod] = slot;
+			loadingCount++;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ChunkStreamer::MarkLoaded(uint32_t slot, VkDeviceSize bytes)
+{
+	if (slots[slot].state != SLOT_LOADING)
+	{
+		return;
+	}
+
+	slots[slot].state = SLOT_RESIDENT;
+	loadingCount--;
+	residentCount++;
+	loadCount++;
+	streamedBytes += bytes;
+}
+
+void ChunkStreamer::MarkLoadFailed(uint32_t slot)
+{
+	if (slots[slot].state != SLOT_LOADING)
+	{
+		return;
+	}
+
+	//Wanted again on the next update while still visible
+	chunks[slots[slot].chunk].slots[slots[slot].lod] = UINT32_MAX;
+	slots[slot].state = SLOT_FREE;
+	loadingCount--;
+}
+
+void ChunkStreamer::Reset()
+{
+	ChunkState emptyState;
+	emptyState.wantedLod = -1;
+	for (uint32_t lod = 0; lod < CHUNK_LOD_COUNT; lod++)
+	{
+		emptyState.slots[lod] = UINT32_MAX;
+	}
+	chunks.assign(records.size(), emptyState);
+
+	for (PoolSlot &slot : slots)
+	{
+		slot.chunk = UINT32_MAX;
+		slot.lod = 0;
+		slot.lastUsedFrame = 0;
+		slot.drawnTicket = 0;
+		slot.state = SLOT_FREE;
+	}
+
+	drawList.clear();
+	residentCount = 0;
+	loadingCount = 0;
+}
+
+void ChunkStreamer::ReportMetrics()
+{
+	std::cout << "Chunk streaming: " << records.size() << " chunks, " << residentCount << " of " << slots.size() << " slots resident, ";
+	std::cout << loadCount << " loads, " << evictionCount << " evictions, " << streamedBytes << " bytes streamed";
+
+	if (streamStarted)
+	{
+		double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - streamStart).count();
+		if (seconds > 0.0)
+		{
+			std::cout << ", " << streamedBytes / seconds / (1024.0 * 1024.0) << " MB/s average";
+		}
+	}
+	std::cout << ".\n";
+}
+
+uint32_t ChunkStreamer::acquireSlot()
+{
+	if (!streamStarted)
+	{
+		streamStarted = true;
+		streamStart = std::chrono::steady_clock::now();
+	}
+
+	uint32_t candidate = UINT32_MAX;
+	for (uint32_t i = 0; i < slots.size(); i++)
+	{
+		if (slots[i].state == SLOT_FREE)
+		{
+			return i;
+		}
+
+		//Slots in the current draw list are about to be recorded, and those drawn by frames still executing are read
+		if (slots[i].state == SLOT_RESIDENT && slots[i].lastUsedFrame < frame && (candidate == UINT32_MAX || slots[i].lastUsedFrame < slots[candidate].lastUsedFrame) && syncTimeline->IsComplete(slots[i].drawnTicket))
+		{
+			candidate = i;
+		}
+	}
+
+	if (candidate != UINT32_MAX)
+	{
+		chunks[slots[candidate].chunk].slots[slots[candidate].lod] = UINT32_MAX;
+		slots[candidate].state = SLOT_FREE;
+		residentCount--;
+		evictionCount++;
+	}
+
+	return candidate;
+}
+
+bool ChunkStreamer::IsBoxVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &modelViewProjection)
+{
+	//Outside when every corner of the bounds lies beyond the same clip plane, depth runs from zero to w
+	uint32_t outside[6] = {};
+
+	for (uint32_t corner = 0; corner < 8; corner++)
+	{
+		glm::vec4 position((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+		glm::vec4 clip = modelViewProjection * position;
+
+		outside[0] += clip.x < -clip.w;
+		outside[1] += clip.x > clip.w;
+		outside[2] += clip.y < -clip.w;
+		outside[3] += clip.y > clip.w;
+		outside[4] += clip.z < 0.0f;
+		outside[5] += clip.z > clip.w;
+	}
+
+	for (uint32_t plane = 0; plane < 6; plane++)
+	{
+		if (outside[plane] == 8)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint32_t ChunkStreamer::selectLod(const ChunkRecord &record, const glm::vec3 &cameraPosition) const
+{
+	glm::vec3 minimum(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]);
+	glm::vec3 maximum(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]);
+
+	float radius = glm::length(maximum - minimum) * 0.5f;
+	float distance = glm::length(cameraPosition - (minimum + maximum) * 0.5f);
+
+	uint32_t lod = 0;
+	float range = radius * CHUNK_LOD_RANGE;
+	while (lod + 1 < CHUNK_LOD_COUNT && distance > range)
+	{
+		lod++;
+		range *= CHUNK_LOD_RANGE;
+	}
+
+	return lod;
+}
+
+uint32_t ChunkStreamer::drawableSlot(const ChunkState &state) const
+{
+	//The wanted level, else the nearest resident one preferring coarser
+	int32_t wanted = state.wantedLod < 0 ? 0 : state.wantedLod;
+
+	for (int32_t step = 0; step < (int32_t)CHUNK_LOD_COUNT; step++)
+	{
+		int32_t candidates[2] = { wanted + step, wanted - step };
+		for (int32_t lod : candidates)
+		{
+			if (lod < 0 || lod >= (int32_t)CHUNK_LOD_COUNT)
+			{
+				continue;
+			}
+
+			uint32_t slot = state.slots[lod];
+			if (slot != UINT32_MAX && slots[slot].state == SLOT_RESIDENT)
+			{
+				return slot;
+			}
+		}
+	}
+
+	return UINT32_MAX;
+}
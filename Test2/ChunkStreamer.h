@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "MeshChunkFile.h"
+#include "SyncTimeline.h"
+#include "glm/glm.hpp"
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+//Slots in the device chunk pool, each holds one level of one chunk
+const uint32_t CHUNK_POOL_SLOTS = 64;
+
+//Chunk reads outstanding at once
+const uint32_t CHUNK_MAX_LOADS_IN_FLIGHT = 8;
+
+//A chunk drops a level of detail each time its distance from the camera grows by this many times its radius
+const float CHUNK_LOD_RANGE = 4.0f;
+
+//One resident chunk to draw, its vertices and indices sit at the slot's offset in the pool buffers
+struct ChunkDraw
+{
+	uint32_t slot;
+	uint32_t indexCount;
+
+	bool operator == (const ChunkDraw &other) const { return slot == other.slot && indexCount == other.indexCount; }
+};
+
+//Decides which chunks of an out-of-core mesh live in the fixed pool of device slots. Chunks outside the view frustum
+//are skipped and the rest wanted at a level of detail matched to their distance. Slots are reused least recently drawn
+//first, never while the current draw list uses them or a submission drawing them is executing. The owner performs the
+//reads and uploads
+class ChunkStreamer
+{
+public:
+	void Initialise(const std::vector<ChunkRecord> &chunkRecords, uint32_t slotCount, SyncTimeline *timeline);
+
+	//Cull and choose levels of detail for a frame, the camera position is in model space. Returns true if the draw
+	//list changed, command buffers recorded from the old list must be recorded again
+	bool Update(const glm::mat4 &modelViewProjection, const glm::vec3 &cameraPosition);
+
+	//Stamp every slot in the draw list with the submission that drew it
+	void MarkDrawn(SyncTicket ticket);
+
+	//Next chunk level to read and the slot it goes in. Returns false when nothing is wanted, too many loads are in
+	//flight or every slot is being drawn
+	bool NextLoad(uint32_t &chunk, uint32_t &lod, uint32_t &slot);
+
+	void MarkLoaded(uint32_t slot, VkDeviceSize bytes);
+	void MarkLoadFailed(uint32_t slot);
+
+	//Drop every slot, used when the pool itself is released
+	void Reset();
+
+	//False when every corner of the model space box lies beyond the same clip plane
+	static bool IsBoxVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &modelViewProjection);
+
+	const std::vector<ChunkDraw> &GetDrawList() const { return drawList; }
+	uint32_t GetResidentCount() const { return residentCount; }
+	uint32_t GetVisibleCount() const { return visibleCount; }
+	VkDeviceSize GetStreamedBytes() const { return streamedBytes; }
+
+	void ReportMetrics();
+
+private:
+	enum SlotState
+	{
+		SLOT_FREE,
+		SLOT_LOADING,
+		SLOT_RESIDENT
+	};
+
+	struct PoolSlot
+	{
+		uint32_t chunk;
+		uint32_t lod;
+		uint64_t lastUsedFrame;
+		SyncTicket drawnTicket; //Last submission that drew the slot
+		SlotState state;
+	};
+
+	struct ChunkState
+	{
+		int32_t wantedLod; //-1 while outside the frustum
+		uint32_t slots[CHUNK_LOD_COUNT]; //Slot holding or loading each level, UINT32_MAX if none
+	};
+
+	SyncTimeline *syncTimeline = nullptr;
+	std::vector<ChunkRecord> records;
+	std::vector<ChunkState> chunks;
+	std::vector<PoolSlot> slots;
+	std::vector<ChunkDraw> drawList;
+	uint64_t frame = 0;
+
+	uint32_t visibleCount = 0;
+	uint32_t residentCount = 0;
+	uint32_t loadingCount = 0;
+	uint32_t loadCount = 0;
+	uint32_t evictionCount = 0;
+	VkDeviceSize streamedBytes = 0;
+	bool streamStarted = false;
+	std::chrono::time_point<std::chrono::steady_clock> streamStart;
+
+	uint32_t acquireSlot();
+	uint32_t selectLod(const ChunkRecord &record, const glm::vec3 &cameraPosition) const;
+	uint32_t drawableSlot(const ChunkState &state) const;
+};
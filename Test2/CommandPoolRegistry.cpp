@@ -0,0 +1,177 @@
+#include "CommandPoolRegistry.h"
+
+void CommandPoolRegistry::Initialise(VkDevice device, SyncTimeline *timeline, uint32_t queueFamilyIndex)
+{
+	logicalDevice = device;
+	syncTimeline = timeline;
+	familyIndex = queueFamilyIndex;
+}
+
+VkCommandBuffer CommandPoolRegistry::Allocate(VkCommandBufferLevel level)
+{
+	ThreadPools &thread = currentThread();
+
+	if (thread.recording < 0)
+	{
+		thread.recording = (int32_t)acquirePool(thread);
+	}
+
+	TransientPool &transientPool = thread.pools[thread.recording];
+
+	bool secondary = level == VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	std::vector<VkCommandBuffer> &commandBuffers = secondary ? transientPool.secondaryBuffers : transientPool.commandBuffers;
+	uint32_t &usedCount = secondary ? transientPool.secondaryUsedCount : transientPool.usedCount;
+
+	if (usedCount == commandBuffers.size())
+	{
+		VkCommandBufferAllocateInfo allocate_info = {};
+		allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocate_info.pNext = nullptr;
+		allocate_info.level = level;
+		allocate_info.commandPool = transientPool.pool;
+		allocate_info.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		vkAllocateCommandBuffers(logicalDevice, &allocate_info, &commandBuffer);
+		commandBuffers.push_back(commandBuffer);
+	}
+
+	return commandBuffers[usedCount++];
+}
+
+void CommandPoolRegistry::EndEpoch(SyncTicket ticket)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	for (auto &entry : threads)
+	{
+		ThreadPools &thread = entry.second;
+
+		for (TransientPool &transientPool : thread.pools)
+		{
+			if (transientPool.state == POOL_RECORDING)
+			{
+				transientPool.state = POOL_IN_FLIGHT;
+				transientPool.ticket = ticket;
+			}
+
+			//One reset returns every command buffer in the pool, rather than freeing them one at a time
+			if (transientPool.state == POOL_IN_FLIGHT && syncTimeline->IsComplete(transientPool.ticket))
+			{
+				vkResetCommandPool(logicalDevice, transientPool.pool, 0);
+				transientPool.usedCount = 0;
+				transientPool.secondaryUsedCount = 0;
+				transientPool.state = POOL_FREE;
+				resetCount++;
+			}
+		}
+
+		thread.recording = -1;
+	}
+
+	//Nothing records into the pools of exited threads again, so they are destroyed rather than reset
+	for (auto transientPool = retiredPools.begin(); transientPool != retiredPools.end();)
+	{
+		if (transientPool->state == POOL_RECORDING)
+		{
+			transientPool->state = POOL_IN_FLIGHT;
+			transientPool->ticket = ticket;
+		}
+
+		if (transientPool->state == POOL_FREE || syncTimeline->IsComplete(transientPool->ticket))
+		{
+			vkDestroyCommandPool(logicalDevice, transientPool->pool, nullptr);
+			transientPool = retiredPools.erase(transientPool);
+			poolCount--;
+		}
+		else
+		{
+			transientPool++;
+		}
+	}
+}
+
+void CommandPoolRegistry::ReleaseThread()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	auto entry = threads.find(std::this_thread::get_id());
+	if (entry == threads.end())
+	{
+		return;
+	}
+
+	retiredPools.insert(retiredPools.end(), entry->second.pools.begin(), entry->second.pools.end());
+	threads.erase(entry);
+}
+
+void CommandPoolRegistry::Release()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	for (auto &entry : threads)
+	{
+		for (const TransientPool &transientPool : entry.second.pools)
+		{
+			vkDestroyCommandPool(logicalDevice, transientPool.pool, nullptr);
+		}
+	}
+
+	for (const TransientPool &transientPool : retiredPools)
+	{
+		vkDestroyCommandPool(logicalDevice, transientPool.pool, nullptr);
+	}
+
+	threads.clear();
+	retiredPools.clear();
+	poolCount = 0;
+}
+
+CommandPoolRegistry::ThreadPools &CommandPoolRegistry::currentThread()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	return threads[std::this_thread::get_id()];
+}
+
+uint32_t CommandPoolRegistry::acquirePool(ThreadPools &thread)
+{
+	for (uint32_t i = 0; i < thread.pools.size(); i++)
+	{
+		if (thread.pools[i].state == POOL_FREE)
+		{
+			thread.pools[i].state = POOL_RECORDING;
+			return i;
+		}
+	}
+
+	//Every pool of this thread is still in flight
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.pNext = nullptr;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_info.queueFamilyIndex = familyIndex;
+
+	TransientPool transientPool = {};
+	transientPool.usedCount = 0;
+	transientPool.secondaryUsedCount = 0;
+	transientPool.state = POOL_RECORDING;
+	transientPool.ticket = 0;
+
+	VkResult result = vkCreateCommandPool(logicalDevice, &pool_info, nullptr, &transientPool.pool);
+	if (result == VK_SUCCESS)
+	{
+#ifdef DEBUG
+		std::cout << "Transient command pool created successfully.\n";
+#endif // DEBUG
+	}
+
+	thread.pools.push_back(transientPool);
+
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		poolCount++;
+	}
+
+	return (uint32_t)thread.pools.size() - 1;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "SyncTimeline.h"
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+
+//Transient command pools owned per thread. Command pools are externally synchronised, so each recording thread gets
+//pools of its own and never contends with another thread. Work is grouped into epochs, a frame or a batch, and every
+//pool used during one is reset as a whole once the ticket that epoch was submitted with completes
+class CommandPoolRegistry
+{
+public:
+	void Initialise(VkDevice device, SyncTimeline *timeline, uint32_t queueFamilyIndex);
+
+	//Command buffer from the calling thread's pool for the current epoch, safe to call from any thread. Secondary buffers
+	//let several threads record draws for one render pass, each from a pool of its own
+	VkCommandBuffer Allocate(VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	//Close the current epoch, everything allocated since the last call completes with ticket. Pools whose epoch has
+	//completed are reset for reuse. Must not run while other threads are allocating
+	void EndEpoch(SyncTicket ticket);
+
+	//For a thread that is exiting, its pools are destroyed by EndEpoch once their work completes
+	void ReleaseThread();
+
+	void Release();
+
+	uint32_t GetPoolCount() const { return poolCount; }
+	uint64_t GetResetCount() const { return resetCount; }
+
+private:
+	enum PoolState
+	{
+		POOL_FREE,
+		POOL_RECORDING,
+		POOL_IN_FLIGHT
+	};
+
+	struct TransientPool
+	{
+		VkCommandPool pool;
+		std::vector<VkCommandBuffer> commandBuffers; //Allocated once and reused after every reset
+		uint32_t usedCount;
+		std::vector<VkCommandBuffer> secondaryBuffers; //As above, for the secondary level
+		uint32_t secondaryUsedCount;
+		PoolState state;
+		SyncTicket ticket; //Completes the work recorded from the pool while in flight
+	};
+
+	//Only ever touched by the owning thread, or by EndEpoch while no thread is recording
+	struct ThreadPools
+	{
+		std::vector<TransientPool> pools;
+		int32_t recording = -1;
+	};
+
+	VkDevice logicalDevice = VK_NULL_HANDLE;
+	SyncTimeline *syncTimeline = nullptr;
+	uint32_t familyIndex = UINT32_MAX;
+
+	std::mutex registryMutex;
+	std::unordered_map<std::thread::id, ThreadPools> threads; //Elements never move, so references outlive the lock
+	std::vector<TransientPool> retiredPools; //Of threads that have exited
+
+	uint32_t poolCount = 0;
+	uint64_t resetCount = 0;
+
+	ThreadPools &currentThread();
+	uint32_t acquirePool(ThreadPools &thread);
+};
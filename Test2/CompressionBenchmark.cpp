@@ -0,0 +1,148 @@
+#include "CompressionBenchmark.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <cstdio>
+
+void CompressionBenchmark::AddInput(const std::string &name, std::vector<uint8_t> data)
+{
+	inputs.push_back({ name, std::move(data) });
+}
+
+void CompressionBenchmark::Run(const std::string &csvPath)
+{
+	if (inputs.empty())
+	{
+		return;
+	}
+
+	std::ofstream csv(csvPath, std::ios::trunc);
+	csv << "asset,raw_bytes,stored_bytes,ratio,compress_ms";
+	for (uint32_t threads : COMPRESSION_BENCHMARK_THREADS)
+	{
+		csv << ",decode_gbs_" << threads;
+	}
+	csv << ",load_raw_ms,load_compressed_ms\n";
+
+	std::cout << "\n---COMPRESSION BENCHMARK---\n";
+	std::cout << "Medians of " << COMPRESSION_BENCHMARK_REPETITIONS << " runs, loads are a warm cache pack read plus decode\n";
+
+	for (BenchmarkInput &input : inputs)
+	{
+		//The same bytes cached both ways and loaded the way the renderer loads them, first so the pack writes are not
+		//logged inside the table
+		const uint32_t metadata[4] = {};
+		std::string rawPath = csvPath + "." + input.name + ".raw.pack";
+		std::string compressedPath = csvPath + "." + input.name + ".compressed.pack";
+
+		std::vector<uint8_t> decoded(input.data.size());
+
+		double rawMilliseconds = 0.0, compressedMilliseconds = 0.0;
+		bool loaded = AssetPack::Write(rawPath, metadata, input.data.data(), input.data.size(), false) &&
+			AssetPack::Write(compressedPath, metadata, input.data.data(), input.data.size(), true) &&
+			timeLoad(rawPath, decoded, 0, rawMilliseconds) &&
+			timeLoad(compressedPath, decoded, 0, compressedMilliseconds);
+
+		std::remove(rawPath.c_str());
+		std::remove(compressedPath.c_str());
+
+		auto compressStart = std::chrono::steady_clock::now();
+		std::vector<uint8_t> stream = BlockCompression::Compress(input.data.data(), input.data.size());
+		auto compressEnd = std::chrono::steady_clock::now();
+		double compressMilliseconds = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(compressEnd - compressStart).count();
+
+		double ratio = stream.empty() ? 0.0 : (double)input.data.size() / stream.size();
+
+		std::cout << std::setw(8) << input.name << " " << std::setw(10) << input.data.size() << " -> " << std::setw(10) << stream.size() << " bytes ";
+		std::cout << std::fixed << std::setprecision(2) << ratio << "x, " << compressMilliseconds << " ms to compress";
+		csv << input.name << "," << input.data.size() << "," << stream.size() << "," << ratio << "," << compressMilliseconds;
+
+		for (uint32_t threads : COMPRESSION_BENCHMARK_THREADS)
+		{
+			std::vector<double> rates;
+			bool valid = true;
+			for (uint32_t r = 0; r < COMPRESSION_BENCHMARK_REPETITIONS && valid; r++)
+			{
+				auto decodeStart = std::chrono::steady_clock::now();
+				valid = BlockCompression::Decompress(stream.data(), stream.size(), decoded.data(), decoded.size(), threads);
+				auto decodeEnd = std::chrono::steady_clock::now();
+
+				double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(decodeEnd - decodeStart).count();
+				if (seconds > 0)
+				{
+					rates.push_back(decoded.size() / seconds / 1e9);
+				}
+			}
+
+			valid = valid && decoded == input.data;
+
+			std::cout << " | " << threads << "T ";
+			if (!valid || rates.empty())
+			{
+				std::cout << (valid ? "-" : "MISMATCH");
+				csv << ",";
+				continue;
+			}
+
+			double rate = median(rates);
+			std::cout << rate << " GB/s";
+			csv << "," << rate;
+		}
+
+		if (loaded)
+		{
+			std::cout << " | load " << rawMilliseconds << " ms raw, " << compressedMilliseconds << " ms compressed";
+			csv << "," << rawMilliseconds << "," << compressedMilliseconds;
+		}
+		else
+		{
+			std::cout << " | load unavailable";
+			csv << ",,";
+		}
+
+		std::cout << std::defaultfloat << "\n";
+		csv << "\n";
+	}
+
+	std::cout << "Compression benchmark written to " << csvPath << ".\n";
+}
+
+bool CompressionBenchmark::timeLoad(const std::string &path, std::vector<uint8_t> &destination, uint32_t threadCount, double &milliseconds)
+{
+	AssetPackHeader header;
+	std::vector<uint8_t> stored;
+
+	//Untimed first read warms the file cache
+	if (!AssetPack::Read(path, header, stored) || header.rawSize != destination.size())
+	{
+		return false;
+	}
+
+	std::vector<double> times;
+	for (uint32_t r = 0; r < COMPRESSION_BENCHMARK_REPETITIONS; r++)
+	{
+		auto loadStart = std::chrono::steady_clock::now();
+		bool valid = AssetPack::Read(path, header, stored) && AssetPack::Decode(header, stored, destination.data(), threadCount);
+		auto loadEnd = std::chrono::steady_clock::now();
+
+		if (!valid)
+		{
+			return false;
+		}
+
+		times.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(loadEnd - loadStart).count());
+	}
+
+	milliseconds = median(times);
+
+	return true;
+}
+
+double CompressionBenchmark::median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+
+	size_t middle = values.size() / 2;
+
+	return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) * 0.5;
+}
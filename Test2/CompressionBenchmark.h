@@ -0,0 +1,40 @@
+#pragma once
+
+#include "BlockCompression.h"
+#include "AssetPack.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+//Decompression thread counts compared
+const uint32_t COMPRESSION_BENCHMARK_THREADS[] = { 1, 2, 4, 8 };
+
+//Timed runs per case, the median is reported. The pack files are read once before timing so loads hit a warm file cache
+const uint32_t COMPRESSION_BENCHMARK_REPETITIONS = 7;
+
+//Compares the block compressed asset caches with uncompressed ones: ratio, compression time, decompression GB/s per
+//thread count, and the end to end load time of a pack file read and decoded into memory
+class CompressionBenchmark
+{
+public:
+	//Decoded asset bytes exactly as they are cached
+	void AddInput(const std::string &name, std::vector<uint8_t> data);
+
+	//Run every case, print a table and write it to a CSV file. Temporary packs are written beside the CSV and removed
+	void Run(const std::string &csvPath);
+
+private:
+	struct BenchmarkInput
+	{
+		std::string name;
+		std::vector<uint8_t> data;
+	};
+
+	std::vector<BenchmarkInput> inputs;
+
+	bool timeLoad(const std::string &path, std::vector<uint8_t> &destination, uint32_t threadCount, double &milliseconds);
+
+	static double median(std::vector<double> values);
+};
@@ -0,0 +1,761 @@
+#include "DeviceAllocator.h"
+
+#include <algorithm>
+
+void DeviceAllocator::Initialise(VkPhysicalDevice physicalDevice, VkDevice device, SyncTimeline *timeline, uint32_t queue, uint32_t queueFamilyIndex, uint32_t waitQueue, MemoryTracker *tracker)
+{
+	logicalDevice = device;
+	syncTimeline = timeline;
+	moveQueue = queue;
+	uploadQueue = waitQueue;
+	memoryTracker = tracker;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	//Buffers and optimal images share blocks so every range is padded to the granularity rather than tracking neighbours
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	bufferImageGranularity = properties.limits.bufferImageGranularity;
+
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.pNext = nullptr;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_info.queueFamilyIndex = queueFamilyIndex;
+
+	VkResult result = vkCreateCommandPool(logicalDevice, &pool_info, nullptr, &movePool);
+	if (result == VK_SUCCESS)
+	{
+		std::cout << "Defragmentation command pool created successfully.\n";
+	}
+
+	VkCommandBufferAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocate_info.pNext = nullptr;
+	allocate_info.commandPool = movePool;
+	allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocate_info.commandBufferCount = 1;
+
+	vkAllocateCommandBuffers(logicalDevice, &allocate_info, &moveCommandBuffer);
+}
+
+uint32_t DeviceAllocator::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryUsageTag tag, AllocationSite site)
+{
+	uint32_t handle = newHandle();
+	Allocation &allocation = allocations[handle];
+
+	allocation.bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	allocation.bufferInfo.pNext = nullptr;
+	allocation.bufferInfo.flags = 0;
+	allocation.bufferInfo.size = size;
+	allocation.bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	allocation.bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	allocation.tag = tag;
+
+	VkResult result = vkCreateBuffer(logicalDevice, &allocation.bufferInfo, nullptr, &allocation.buffer);
+	if (result == VK_SUCCESS)
+	{
+		std::cout << "Buffer created successfully.\n";
+	}
+
+	vkGetBufferMemoryRequirements(logicalDevice, allocation.buffer, &allocation.memoryRequirements);
+
+	if (!bindAllocation(allocation, properties, site))
+	{
+		vkDestroyBuffer(logicalDevice, allocation.buffer, nullptr);
+		allocation = Allocation();
+		return UINT32_MAX;
+	}
+
+	vkBindBufferMemory(logicalDevice, allocation.buffer, blocks[allocation.block].memory, allocation.offset);
+
+	return handle;
+}
+
+uint32_t DeviceAllocator::CreateImage(const VkImageCreateInfo &imageInfo, VkImageAspectFlags aspect, VkMemoryPropertyFlags properties, MemoryUsageTag tag, AllocationSite site)
+{
+	uint32_t handle = newHandle();
+	Allocation &allocation = allocations[handle];
+
+	allocation.imageInfo = imageInfo;
+	allocation.imageInfo.pNext = nullptr;
+	allocation.imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	allocation.aspect = aspect;
+	allocation.layout = imageInfo.initialLayout;
+	allocation.tag = tag;
+
+	VkResult result = vkCreateImage(logicalDevice, &allocation.imageInfo, nullptr, &allocation.image);
+	if (result == VK_SUCCESS)
+	{
+		std::cout << "Image created successfully.\n";
+	}
+
+	vkGetImageMemoryRequirements(logicalDevice, allocation.image, &allocation.memoryRequirements);
+
+	if (!bindAllocation(allocation, properties, site))
+	{
+		vkDestroyImage(logicalDevice, allocation.image, nullptr);
+		allocation = Allocation();
+		return UINT32_MAX;
+	}
+
+	vkBindImageMemory(logicalDevice, allocation.image, blocks[allocation.block].memory, allocation.offset);
+
+	return handle;
+}
+
+void DeviceAllocator::Destroy(uint32_t handle)
+{
+	if (handle == UINT32_MAX)
+	{
+		return;
+	}
+
+	Allocation &allocation = allocations[handle];
+
+	if (!allocation.live)
+	{
+		return;
+	}
+
+	//A resource destroyed mid-move is still being read by the copy, its new copy is dropped once the move completes
+	for (PendingMove &move : pendingMoves)
+	{
+		if (move.handle == handle)
+		{
+			syncTimeline->Wait(moveTicket);
+			move.handle = UINT32_MAX;
+		}
+	}
+
+	vkDestroyBuffer(logicalDevice, allocation.buffer, nullptr);
+	vkDestroyImage(logicalDevice, allocation.image, nullptr);
+	freeRange(allocation.block, allocation.offset, allocation.size);
+
+	allocation = Allocation();
+
+	releaseEmptyBlocks();
+}
+
+void DeviceAllocator::Release()
+{
+	if (!pendingMoves.empty())
+	{
+		syncTimeline->Wait(moveTicket);
+
+		for (const PendingMove &move : pendingMoves)
+		{
+			vkDestroyBuffer(logicalDevice, move.buffer, nullptr);
+			vkDestroyImage(logicalDevice, move.image, nullptr);
+		}
+		pendingMoves.clear();
+	}
+
+	for (const RetiredResource &retired : retiredResources)
+	{
+		vkDestroyBuffer(logicalDevice, retired.buffer, nullptr);
+		vkDestroyImage(logicalDevice, retired.image, nullptr);
+	}
+	retiredResources.clear();
+
+	for (Allocation &allocation : allocations)
+	{
+		if (allocation.live)
+		{
+			vkDestroyBuffer(logicalDevice, allocation.buffer, nullptr);
+			vkDestroyImage(logicalDevice, allocation.image, nullptr);
+		}
+	}
+	allocations.clear();
+
+	for (MemoryBlock &block : blocks)
+	{
+		if (block.memory != VK_NULL_HANDLE)
+		{
+			memoryTracker->RecordFree(block.memory);
+			vkFreeMemory(logicalDevice, block.memory, nullptr);
+		}
+	}
+	blocks.clear();
+
+	vkDestroyCommandPool(logicalDevice, movePool, nullptr);
+}
+
+void *DeviceAllocator::GetMapped(uint32_t handle)
+{
+	const Allocation &allocation = allocations[handle];
+	MemoryBlock &block = blocks[allocation.block];
+
+	if ((memoryProperties.memoryTypes[block.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
+	{
+		return nullptr;
+	}
+
+	//A memory object can only be mapped once, so the block is mapped whole and shared by everything placed in it
+	if (block.mapped == nullptr && vkMapMemory(logicalDevice, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped) != VK_SUCCESS)
+	{
+		block.mapped = nullptr;
+		return nullptr;
+	}
+
+	return reinterpret_cast<uint8_t*>(block.mapped) + allocation.offset;
+}
+
+void DeviceAllocator::BeginWrite(uint32_t handle)
+{
+	allocations[handle].writesInFlight++;
+}
+
+void DeviceAllocator::EndWrite(uint32_t handle)
+{
+	Allocation &allocation = allocations[handle];
+
+	//Destroyed before the upload completed
+	if (allocation.live && allocation.writesInFlight > 0)
+	{
+		allocation.writesInFlight--;
+	}
+}
+
+bool DeviceAllocator::IsMoving(uint32_t handle) const
+{
+	for (const PendingMove &move : pendingMoves)
+	{
+		if (move.handle == handle)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool DeviceAllocator::Defragment(VkDeviceSize maxBytes, std::vector<uint32_t> &movedHandles)
+{
+	//The caller has not yet stopped using the resources replaced by the previous step
+	if (!retiredResources.empty())
+	{
+		return false;
+	}
+
+	if (!pendingMoves.empty())
+	{
+		if (!syncTimeline->IsComplete(moveTicket))
+		{
+			return false;
+		}
+
+		for (const PendingMove &move : pendingMoves)
+		{
+			if (move.handle == UINT32_MAX) //Destroyed while its copy was in flight
+			{
+				retiredResources.push_back({ move.buffer, move.image, move.block, move.offset, move.size });
+				continue;
+			}
+
+			Allocation &allocation = allocations[move.handle];
+
+			retiredResources.push_back({ allocation.buffer, allocation.image, allocation.block, allocation.offset, allocation.size });
+
+			allocation.buffer = move.buffer;
+			allocation.image = move.image;
+			allocation.block = move.block;
+			allocation.offset = move.offset;
+
+			movedHandles.push_back(move.handle);
+		}
+
+		pendingMoves.clear();
+
+		return true;
+	}
+
+	if (sourceBlock == UINT32_MAX)
+	{
+		sourceBlock = pickSourceBlock();
+
+		if (sourceBlock == UINT32_MAX)
+		{
+			return false;
+		}
+
+		blocks[sourceBlock].evacuating = true;
+	}
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.pNext = nullptr;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(moveCommandBuffer, &begin_info);
+
+	//Earlier submissions on the queue may still be writing the resources being copied, those on the upload queue are
+	//waited on at submission
+	VkMemoryBarrier memory_barrier = {};
+	memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memory_barrier.pNext = nullptr;
+	memory_barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	vkCmdPipelineBarrier(moveCommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+	VkDeviceSize bytesRecorded = 0;
+	bool sourceDrained = true;
+
+	for (uint32_t handle = 0; handle < allocations.size(); handle++)
+	{
+		const Allocation &allocation = allocations[handle];
+
+		if (!allocation.live || allocation.block != sourceBlock)
+		{
+			continue;
+		}
+
+		if (bytesRecorded >= maxBytes)
+		{
+			sourceDrained = false;
+			break;
+		}
+
+		//An upload recorded against the current resource would be lost in the switch, move it on a later step
+		if (allocation.writesInFlight > 0)
+		{
+			sourceDrained = false;
+			continue;
+		}
+
+		VkDeviceSize alignment = std::max(allocation.memoryRequirements.alignment, bufferImageGranularity);
+
+		uint32_t block;
+		VkDeviceSize offset;
+		if (!allocateRange(allocation.memoryTypeIndex, allocation.tag, allocation.size, alignment, false, ALLOCATION_SITE, block, offset))
+		{
+			//The other blocks filled up since this one was chosen, leave it as it is
+			blocks[sourceBlock].evacuating = false;
+			sourceBlock = UINT32_MAX;
+			sourceDrained = false;
+			break;
+		}
+
+		PendingMove move = { handle, VK_NULL_HANDLE, VK_NULL_HANDLE, block, offset, allocation.size };
+
+		if (allocation.buffer != VK_NULL_HANDLE)
+		{
+			vkCreateBuffer(logicalDevice, &allocation.bufferInfo, nullptr, &move.buffer);
+			vkBindBufferMemory(logicalDevice, move.buffer, blocks[block].memory, offset);
+		}
+		else
+		{
+			VkImageCreateInfo image_info = allocation.imageInfo;
+			image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			vkCreateImage(logicalDevice, &image_info, nullptr, &move.image);
+			vkBindImageMemory(logicalDevice, move.image, blocks[block].memory, offset);
+		}
+
+		recordMove(allocation, move.buffer, move.image);
+
+		pendingMoves.push_back(move);
+		bytesRecorded += allocation.size;
+	}
+
+	if (sourceDrained && sourceBlock != UINT32_MAX)
+	{
+		sourceBlock = UINT32_MAX; //Released along with the retired ranges
+	}
+
+	//Make the copies visible to whatever is submitted after them
+	memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	vkCmdPipelineBarrier(moveCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+	vkEndCommandBuffer(moveCommandBuffer);
+
+	bytesMovedLastStep = bytesRecorded;
+
+	if (pendingMoves.empty())
+	{
+		return false;
+	}
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext = nullptr;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &moveCommandBuffer;
+
+	moveTicket = syncTimeline->Submit(moveQueue, submit_info, syncTimeline->GetLastSubmitted(uploadQueue), VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	totalBytesMoved += bytesRecorded;
+
+	std::cout << "Defragmentation moving " << pendingMoves.size() << " resources, " << bytesRecorded << " bytes this frame.\n";
+
+	return false;
+}
+
+void DeviceAllocator::ReleaseRetired()
+{
+	if (retiredResources.empty())
+	{
+		return;
+	}
+
+	VkDeviceSize freedBefore = totalBytesFreed;
+
+	for (const RetiredResource &retired : retiredResources)
+	{
+		vkDestroyBuffer(logicalDevice, retired.buffer, nullptr);
+		vkDestroyImage(logicalDevice, retired.image, nullptr);
+		freeRange(retired.block, retired.offset, retired.size);
+	}
+	retiredResources.clear();
+
+	releaseEmptyBlocks();
+
+	std::cout << "Defragmentation step complete, " << totalBytesFreed - freedBefore << " bytes released.\n";
+}
+
+void DeviceAllocator::ReportBlocks()
+{
+	const double mb = 1024.0 * 1024.0;
+
+	std::cout << "\n---DEVICE BLOCKS---\n";
+	for (uint32_t b = 0; b < blocks.size(); b++)
+	{
+		const MemoryBlock &block = blocks[b];
+
+		if (block.memory == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		std::cout << "Block " << b << " (" << MemoryTracker::TagName(block.tag) << ", type " << block.memoryTypeIndex << "): ";
+		std::cout << block.usedBytes / mb << " of " << block.size / mb << " MB used in " << block.freeRanges.size() << " free ranges.\n";
+	}
+	std::cout << "Total moved: " << totalBytesMoved / mb << " MB, released: " << totalBytesFreed / mb << " MB in " << blocksFreed << " blocks.\n";
+	std::cout << "---END DEVICE BLOCKS---\n\n";
+}
+
+uint32_t DeviceAllocator::newHandle()
+{
+	for (uint32_t i = 0; i < allocations.size(); i++)
+	{
+		if (!allocations[i].live)
+		{
+			allocations[i].live = true;
+			return i;
+		}
+	}
+
+	allocations.push_back(Allocation());
+	allocations.back().live = true;
+
+	return (uint32_t)allocations.size() - 1;
+}
+
+bool DeviceAllocator::bindAllocation(Allocation &allocation, VkMemoryPropertyFlags properties, AllocationSite site)
+{
+	VkDeviceSize alignment = std::max(allocation.memoryRequirements.alignment, bufferImageGranularity);
+
+	allocation.memoryTypeIndex = findMemoryType(allocation.memoryRequirements.memoryTypeBits, properties);
+	allocation.size = (allocation.memoryRequirements.size + bufferImageGranularity - 1) / bufferImageGranularity * bufferImageGranularity;
+
+	if (!allocateRange(allocation.memoryTypeIndex, allocation.tag, allocation.size, alignment, true, site, allocation.block, allocation.offset))
+	{
+		std::cout << "Failed to place " << MemoryTracker::TagName(allocation.tag) << " resource of " << allocation.size << " bytes.\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool DeviceAllocator::allocateRange(uint32_t memoryTypeIndex, MemoryUsageTag tag, VkDeviceSize size, VkDeviceSize alignment, bool allowNewBlock, AllocationSite site, uint32_t &block, VkDeviceSize &offset)
+{
+	//First fit, blocks are visited in creation order so long lived resources gather in the oldest blocks
+	for (uint32_t b = 0; b < blocks.size(); b++)
+	{
+		MemoryBlock &candidate = blocks[b];
+
+		if (candidate.memory == VK_NULL_HANDLE || candidate.evacuating || candidate.memoryTypeIndex != memoryTypeIndex)
+		{
+			continue;
+		}
+
+		if (candidate.size - candidate.usedBytes < size)
+		{
+			continue;
+		}
+
+		for (uint32_t r = 0; r < candidate.freeRanges.size(); r++)
+		{
+			FreeRange range = candidate.freeRanges[r];
+			VkDeviceSize aligned = (range.offset + alignment - 1) / alignment * alignment;
+
+			if (aligned + size > range.offset + range.size)
+			{
+				continue;
+			}
+
+			//Split the range into what is left before and after the placement
+			candidate.freeRanges.erase(candidate.freeRanges.begin() + r);
+
+			if (aligned + size < range.offset + range.size)
+			{
+				candidate.freeRanges.insert(candidate.freeRanges.begin() + r, { aligned + size, range.offset + range.size - aligned - size });
+			}
+			if (aligned > range.offset)
+			{
+				candidate.freeRanges.insert(candidate.freeRanges.begin() + r, { range.offset, aligned - range.offset });
+			}
+
+			candidate.usedBytes += size;
+
+			block = b;
+			offset = aligned;
+			return true;
+		}
+	}
+
+	if (!allowNewBlock)
+	{
+		return false;
+	}
+
+	MemoryBlock newBlock = {};
+	newBlock.memoryTypeIndex = memoryTypeIndex;
+	newBlock.tag = tag;
+	newBlock.size = std::max(DEVICE_MEMORY_BLOCK_SIZE, size);
+	newBlock.usedBytes = size;
+	newBlock.evacuating = false;
+	newBlock.mapped = nullptr;
+
+	VkMemoryAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.pNext = nullptr;
+	allocate_info.allocationSize = newBlock.size;
+	allocate_info.memoryTypeIndex = memoryTypeIndex;
+
+	VkResult result = vkAllocateMemory(logicalDevice, &allocate_info, nullptr, &newBlock.memory);
+	if (result != VK_SUCCESS)
+	{
+		std::cout << "Device memory block allocation of " << newBlock.size << " bytes failed.\n";
+		return false;
+	}
+
+	memoryTracker->RecordAllocation(newBlock.memory, newBlock.size, memoryTypeIndex, tag, site);
+
+	if (newBlock.size > size)
+	{
+		newBlock.freeRanges.push_back({ size, newBlock.size - size });
+	}
+
+	//Reuse an emptied block entry if there is one
+	block = UINT32_MAX;
+	for (uint32_t b = 0; b < blocks.size(); b++)
+	{
+		if (blocks[b].memory == VK_NULL_HANDLE)
+		{
+			block = b;
+			blocks[b] = newBlock;
+			break;
+		}
+	}
+
+	if (block == UINT32_MAX)
+	{
+		block = (uint32_t)blocks.size();
+		blocks.push_back(newBlock);
+	}
+
+	offset = 0;
+	return true;
+}
+
+void DeviceAllocator::freeRange(uint32_t block, VkDeviceSize offset, VkDeviceSize size)
+{
+	MemoryBlock &owner = blocks[block];
+	owner.usedBytes -= size;
+
+	auto position = std::lower_bound(owner.freeRanges.begin(), owner.freeRanges.end(), offset, [](const FreeRange &range, VkDeviceSize value) { return range.offset < value; });
+	position = owner.freeRanges.insert(position, { offset, size });
+
+	//Merge with the following range, then the preceding one
+	auto next = position + 1;
+	if (next != owner.freeRanges.end() && position->offset + position->size == next->offset)
+	{
+		position->size += next->size;
+		owner.freeRanges.erase(next);
+	}
+
+	if (position != owner.freeRanges.begin())
+	{
+		auto previous = position - 1;
+		if (previous->offset + previous->size == position->offset)
+		{
+			previous->size += position->size;
+			owner.freeRanges.erase(position);
+		}
+	}
+}
+
+void DeviceAllocator::releaseEmptyBlocks()
+{
+	for (uint32_t b = 0; b < blocks.size(); b++)
+	{
+		MemoryBlock &block = blocks[b];
+
+		if (block.memory == VK_NULL_HANDLE || block.usedBytes > 0)
+		{
+			continue;
+		}
+
+		memoryTracker->RecordFree(block.memory);
+		vkFreeMemory(logicalDevice, block.memory, nullptr);
+
+		totalBytesFreed += block.size;
+		blocksFreed++;
+
+		if (sourceBlock == b)
+		{
+			sourceBlock = UINT32_MAX;
+		}
+
+		block = MemoryBlock();
+		block.memory = VK_NULL_HANDLE;
+	}
+}
+
+uint32_t DeviceAllocator::pickSourceBlock() const
+{
+	uint32_t best = UINT32_MAX;
+	float bestOccupancy = DEFRAGMENT_OCCUPANCY_THRESHOLD;
+
+	for (uint32_t b = 0; b < blocks.size(); b++)
+	{
+		const MemoryBlock &block = blocks[b];
+
+		//Oversized blocks hold a single resource and have nothing to gain from moving it
+		if (block.memory == VK_NULL_HANDLE || block.size > DEVICE_MEMORY_BLOCK_SIZE)
+		{
+			continue;
+		}
+
+		float occupancy = (float)block.usedBytes / (float)block.size;
+		if (occupancy >= bestOccupancy)
+		{
+			continue;
+		}
+
+		//Only worth starting if the other blocks of the same memory type could take everything
+		VkDeviceSize freeElsewhere = 0;
+		for (uint32_t o = 0; o < blocks.size(); o++)
+		{
+			const MemoryBlock &other = blocks[o];
+
+			if (o != b && other.memory != VK_NULL_HANDLE && other.memoryTypeIndex == block.memoryTypeIndex)
+			{
+				freeElsewhere += other.size - other.usedBytes;
+			}
+		}
+
+		if (freeElsewhere >= block.usedBytes)
+		{
+			best = b;
+			bestOccupancy = occupancy;
+		}
+	}
+
+	return best;
+}
+
+void DeviceAllocator::recordMove(const Allocation &allocation, VkBuffer dstBuffer, VkImage dstImage)
+{
+	if (dstBuffer != VK_NULL_HANDLE)
+	{
+		VkBufferCopy copy_region = {};
+		copy_region.srcOffset = 0;
+		copy_region.dstOffset = 0;
+		copy_region.size = allocation.bufferInfo.size;
+
+		vkCmdCopyBuffer(moveCommandBuffer, allocation.buffer, dstBuffer, 1, &copy_region);
+		return;
+	}
+
+	VkImageMemoryBarrier image_barriers[2] = {};
+	for (VkImageMemoryBarrier &image_barrier : image_barriers)
+	{
+		image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		image_barrier.pNext = nullptr;
+		image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_barrier.subresourceRange.aspectMask = allocation.aspect;
+		image_barrier.subresourceRange.baseMipLevel = 0;
+		image_barrier.subresourceRange.levelCount = allocation.imageInfo.mipLevels;
+		image_barrier.subresourceRange.baseArrayLayer = 0;
+		image_barrier.subresourceRange.layerCount = allocation.imageInfo.arrayLayers;
+	}
+
+	//An image that was never written has no contents worth carrying over
+	if (allocation.layout != VK_IMAGE_LAYOUT_UNDEFINED && allocation.layout != VK_IMAGE_LAYOUT_PREINITIALIZED)
+	{
+		image_barriers[0].image = allocation.image;
+		image_barriers[0].oldLayout = allocation.layout;
+		image_barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		image_barriers[0].srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+		image_barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		image_barriers[1].image = dstImage;
+		image_barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		image_barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_barriers[1].srcAccessMask = 0;
+		image_barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(moveCommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, image_barriers);
+
+		std::vector<VkImageCopy> copy_regions(allocation.imageInfo.mipLevels);
+		for (uint32_t level = 0; level < allocation.imageInfo.mipLevels; level++)
+		{
+			VkImageCopy &copy_region = copy_regions[level];
+			copy_region.srcSubresource.aspectMask = allocation.aspect;
+			copy_region.srcSubresource.mipLevel = level;
+			copy_region.srcSubresource.baseArrayLayer = 0;
+			copy_region.srcSubresource.layerCount = allocation.imageInfo.arrayLayers;
+			copy_region.dstSubresource = copy_region.srcSubresource;
+			copy_region.srcOffset = { 0, 0, 0 };
+			copy_region.dstOffset = { 0, 0, 0 };
+			copy_region.extent.width = std::max(allocation.imageInfo.extent.width >> level, 1u);
+			copy_region.extent.height = std::max(allocation.imageInfo.extent.height >> level, 1u);
+			copy_region.extent.depth = std::max(allocation.imageInfo.extent.depth >> level, 1u);
+		}
+
+		vkCmdCopyImage(moveCommandBuffer, allocation.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copy_regions.size(), copy_regions.data());
+
+		//Both images go back to the layout the caller expects, the old one is still used by frames already recorded
+		image_barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		image_barriers[0].newLayout = allocation.layout;
+		image_barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		image_barriers[0].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+		image_barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_barriers[1].newLayout = allocation.layout;
+		image_barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		image_barriers[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+		vkCmdPipelineBarrier(moveCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 2, image_barriers);
+	}
+}
+
+uint32_t DeviceAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		if (typeFilter & (1 << i) && ((memoryProperties.memoryTypes[i].propertyFlags & properties) == properties))
+		{
+			return i;
+		}
+	}
+
+	std::cout << "No suitable memory types found on physical device.\n";
+
+	return 0;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "MemoryTracker.h"
+#include "SyncTimeline.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+//Device local resources are placed into blocks of this size, anything larger gets a block of its own
+const VkDeviceSize DEVICE_MEMORY_BLOCK_SIZE = 64 * 1024 * 1024;
+
+//Blocks with less than this fraction of their bytes live are emptied into the others of the same memory type
+const float DEFRAGMENT_OCCUPANCY_THRESHOLD = 0.5f;
+
+//A buffer or image placed in a range of one of the allocator's blocks. Handles stay valid when the resource is moved,
+//the VkBuffer or VkImage behind them does not
+struct Allocation
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkImage image = VK_NULL_HANDLE;
+	VkBufferCreateInfo bufferInfo = {};
+	VkImageCreateInfo imageInfo = {};
+	VkImageAspectFlags aspect = 0;
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED; //Layout the image is left in between uses, a moved image is returned to it
+
+	VkMemoryRequirements memoryRequirements = {};
+	uint32_t memoryTypeIndex = UINT32_MAX;
+	MemoryUsageTag tag = MEMORY_TAG_COUNT;
+	uint32_t block = UINT32_MAX;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0; //Range taken in the block, padded to the buffer-image granularity
+
+	uint32_t writesInFlight = 0; //Uploads recorded into the resource that have not completed, it stays where it is until they have
+
+	bool live = false;
+};
+
+//Sub-allocates buffers and images from large blocks per memory type, and compacts sparsely used blocks
+//with GPU copies a few megabytes at a time so long sessions can hand memory back to the driver
+class DeviceAllocator
+{
+public:
+	//Moves are submitted on queue, a timeline queue index, ordered after everything already submitted on waitQueue
+	void Initialise(VkPhysicalDevice physicalDevice, VkDevice device, SyncTimeline *timeline, uint32_t queue, uint32_t queueFamilyIndex, uint32_t waitQueue, MemoryTracker *tracker);
+
+	//Transfer source and destination usage is always added so the resource can be moved. Returns UINT32_MAX if no memory
+	//could be found, the caller decides what to give up
+	uint32_t CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryUsageTag tag, AllocationSite site);
+	uint32_t CreateImage(const VkImageCreateInfo &imageInfo, VkImageAspectFlags aspect, VkMemoryPropertyFlags properties, MemoryUsageTag tag, AllocationSite site);
+
+	//The resource must no longer be in use by the GPU
+	void Destroy(uint32_t handle);
+
+	//Destroy every resource and free all blocks
+	void Release();
+
+	VkBuffer GetBuffer(uint32_t handle) const { return allocations[handle].buffer; }
+	VkDeviceSize GetSize(uint32_t handle) const { return allocations[handle].size; }
+	VkImage GetImage(uint32_t handle) const { return allocations[handle].image; }
+	void SetImageLayout(uint32_t handle, VkImageLayout layout) { allocations[handle].layout = layout; }
+
+	//The resource's bytes in a persistent mapping of its block, nullptr unless it was placed in host visible memory.
+	//Moves change it, so fetch it again rather than keeping it
+	void *GetMapped(uint32_t handle);
+
+	//Bracket an upload recorded into the resource, EndWrite once it has completed. A resource being moved takes no
+	//writes, they would land in the copy that is about to be replaced, so check IsMoving and try again later
+	void BeginWrite(uint32_t handle);
+	void EndWrite(uint32_t handle);
+	bool IsMoving(uint32_t handle) const;
+
+	//Advance compaction by one step, called once per frame. With nothing in flight the sparsest block is chosen and up to
+	//maxBytes of its resources without writes in flight are copied into free ranges of other blocks. Once those copies
+	//have completed the handles are switched over, the moved handles are returned and the call returns true; the caller
+	//must then stop referencing the old resources (descriptor sets, recorded command buffers) and call ReleaseRetired
+	bool Defragment(VkDeviceSize maxBytes, std::vector<uint32_t> &movedHandles);
+
+	//Destroy the resources replaced by the last completed moves and free any block left empty
+	void ReleaseRetired();
+
+	//Print the occupancy of every block and the compaction totals
+	void ReportBlocks();
+
+	VkDeviceSize GetBytesMovedLastStep() const { return bytesMovedLastStep; }
+	VkDeviceSize GetTotalBytesMoved() const { return totalBytesMoved; }
+	VkDeviceSize GetTotalBytesFreed() const { return totalBytesFreed; }
+
+	//A block is being emptied or copies are in flight, Defragment has more steps to take
+	bool IsCompacting() const { return sourceBlock != UINT32_MAX || !pendingMoves.empty() || !retiredResources.empty(); }
+
+private:
+	struct FreeRange
+	{
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory;
+		uint32_t memoryTypeIndex;
+		MemoryUsageTag tag; //Of the resource the block was created for, only reported. Any tag is placed in any block of the type
+		VkDeviceSize size;
+		VkDeviceSize usedBytes;
+		std::vector<FreeRange> freeRanges; //Sorted by offset and never adjacent
+		bool evacuating; //Source of the current compaction, nothing new is placed in it
+		void *mapped; //Whole block mapped on first use and left mapped until freed
+	};
+
+	//New home of an allocation whose copy is in flight
+	struct PendingMove
+	{
+		uint32_t handle;
+		VkBuffer buffer;
+		VkImage image;
+		uint32_t block;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	//Old resource and range of a completed move, kept until the caller has stopped using it
+	struct RetiredResource
+	{
+		VkBuffer buffer;
+		VkImage image;
+		uint32_t block;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	VkDevice logicalDevice = VK_NULL_HANDLE;
+	SyncTimeline *syncTimeline = nullptr;
+	uint32_t moveQueue = 0;
+	uint32_t uploadQueue = 0; //Where the uploads a move must follow are submitted
+	MemoryTracker *memoryTracker = nullptr;
+	VkPhysicalDeviceMemoryProperties memoryProperties = {};
+	VkDeviceSize bufferImageGranularity = 1;
+
+	std::vector<Allocation> allocations;
+	std::vector<MemoryBlock> blocks;
+
+	VkCommandPool movePool = VK_NULL_HANDLE;
+	VkCommandBuffer moveCommandBuffer = VK_NULL_HANDLE;
+	SyncTicket moveTicket = 0; //Completes the copies of pendingMoves
+	std::vector<PendingMove> pendingMoves;
+	std::vector<RetiredResource> retiredResources;
+	uint32_t sourceBlock = UINT32_MAX;
+
+	VkDeviceSize bytesMovedLastStep = 0;
+	VkDeviceSize totalBytesMoved = 0;
+	VkDeviceSize totalBytesFreed = 0;
+	uint32_t blocksFreed = 0;
+
+	uint32_t newHandle();
+	bool bindAllocation(Allocation &allocation, VkMemoryPropertyFlags properties, AllocationSite site);
+	bool allocateRange(uint32_t memoryTypeIndex, MemoryUsageTag tag, VkDeviceSize size, VkDeviceSize alignment, bool allowNewBlock, AllocationSite site, uint32_t &block, VkDeviceSize &offset);
+	void freeRange(uint32_t block, VkDeviceSize offset, VkDeviceSize size);
+	void releaseEmptyBlocks();
+	uint32_t pickSourceBlock() const;
+	void recordMove(const Allocation &allocation, VkBuffer dstBuffer, VkImage dstImage);
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+};
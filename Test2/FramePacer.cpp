@@ -0,0 +1,164 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+void FramePacer::Initialise(double targetFrameTime)
+{
+	SetTargetFrameTime(targetFrameTime);
+}
+
+void FramePacer::SetTargetFrameTime(double targetFrameTime)
+{
+	this->targetFrameTime = std::max(targetFrameTime, 0.0);
+
+	//The next wait starts a fresh cadence rather than measuring against the old target
+	started = false;
+
+	if (this->targetFrameTime > 0)
+	{
+		std::cout << "Frame pacing to " << this->targetFrameTime << " milliseconds per frame.\n";
+	}
+	else
+	{
+		std::cout << "Frame pacing off, frames run uncapped.\n";
+	}
+}
+
+void FramePacer::Wait()
+{
+	Clock::time_point now = Clock::now();
+	double cpuTime = threadCpuTime();
+	if (!started)
+	{
+		deadline = now;
+		lastWaitEnd = now;
+		lastCpuTime = cpuTime;
+		started = true;
+		return;
+	}
+
+	double sleepTime = 0.0, spinTime = 0.0;
+	bool paced = targetFrameTime > 0;
+
+	if (paced)
+	{
+		Clock::duration target = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(targetFrameTime));
+		deadline += target;
+
+		if (now > deadline)
+		{
+			missedCount++;
+
+			//More than a frame behind, waiting for the old cadence would only shorten the frames that follow
+			if (now > deadline + target)
+			{
+				deadline = now;
+			}
+		}
+
+		Clock::time_point wakeTarget = deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(leadTime));
+		if (wakeTarget > now)
+		{
+			std::this_thread::sleep_until(wakeTarget);
+			Clock::time_point woken = Clock::now();
+
+			double oversleep = std::max(milliseconds(woken - wakeTarget), 0.0);
+			leadTime += (oversleep * PACING_LEAD_MARGIN - leadTime) * PACING_LEAD_SMOOTHING;
+			leadTime = std::min(std::max(leadTime, PACING_MIN_LEAD), PACING_MAX_LEAD);
+
+			sleepTime = milliseconds(woken - now);
+			now = woken;
+		}
+
+		Clock::time_point spinStart = now;
+		while (now < deadline)
+		{
+			std::this_thread::yield();
+			now = Clock::now();
+		}
+		spinTime = milliseconds(now - spinStart);
+	}
+
+	double interval = milliseconds(now - lastWaitEnd);
+	lastWaitEnd = now;
+
+	double waitEndCpuTime = threadCpuTime();
+	cpuTimeSum += waitEndCpuTime - lastCpuTime;
+	waitCpuTimeSum += waitEndCpuTime - cpuTime;
+	lastCpuTime = waitEndCpuTime;
+
+	frameCount++;
+	intervalSum += interval;
+	sleepSum += sleepTime;
+	spinSum += spinTime;
+
+	if (paced)
+	{
+		double pacingError = std::abs(interval - targetFrameTime);
+		pacingErrorSum += pacingError;
+		maxPacingError = std::max(maxPacingError, pacingError);
+		pacedCount++;
+	}
+}
+
+void FramePacer::ReportMetrics()
+{
+	if (frameCount == 0)
+	{
+		return;
+	}
+
+	double averageInterval = intervalSum / frameCount;
+	double utilisation = intervalSum > 0 ? cpuTimeSum / intervalSum * 100.0 : 0.0;
+	double waitUtilisation = intervalSum > 0 ? waitCpuTimeSum / intervalSum * 100.0 : 0.0;
+
+	std::cout << "Frame pacing: " << frameCount << " frames, " << averageInterval << " milliseconds average interval, ";
+	std::cout << utilisation << "% CPU utilisation on the paced thread (" << waitUtilisation << "% waiting)";
+	if (pacedCount > 0)
+	{
+		std::cout << ", " << pacingErrorSum / pacedCount << " milliseconds average pacing error, " << maxPacingError << " worst, ";
+		std::cout << missedCount << " frames over the target, " << sleepSum / pacedCount << " milliseconds average sleep, ";
+		std::cout << spinSum / pacedCount << " milliseconds average spin, ";
+		std::cout << leadTime << " millisecond lead";
+	}
+	std::cout << ".\n";
+}
+
+double FramePacer::milliseconds(Clock::duration duration)
+{
+	return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(duration).count();
+}
+
+double FramePacer::threadCpuTime()
+{
+#ifdef _WIN32
+	//Kernel and user times in 100 nanosecond units
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+	{
+		return 0.0;
+	}
+
+	uint64_t kernelTicks = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+	uint64_t userTicks = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+
+	return (kernelTicks + userTicks) / 10000.0;
+#else
+	timespec time;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+	{
+		return 0.0;
+	}
+
+	return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+#endif
+}
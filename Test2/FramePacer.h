@@ -0,0 +1,62 @@
+#pragma once
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+
+//Lead time in milliseconds the first waits wake ahead of their deadline, before any oversleep has been measured
+const double PACING_INITIAL_LEAD = 2.0;
+
+//Bounds on the learned lead time. Below the minimum the spin is too short to absorb a late wake up, above the maximum
+//it burns most of a short frame
+const double PACING_MIN_LEAD = 0.25;
+const double PACING_MAX_LEAD = 4.0;
+
+//Lead kept as a multiple of the measured oversleep, and the weight of each new measurement in that estimate
+const double PACING_LEAD_MARGIN = 1.5;
+const double PACING_LEAD_SMOOTHING = 0.1;
+
+//Holds the main loop to a target frame time. Each wait sleeps until a lead time before the deadline and spins the
+//rest, the lead following how far sleeps overrun so the spin stays short. Deadlines advance by the target rather than
+//from the end of the last wait, so frames keep an even cadence, and restart from the present after a long stall
+//instead of running frames back to back to catch up
+class FramePacer
+{
+public:
+	//Milliseconds, 0 leaves the loop uncapped
+	void Initialise(double targetFrameTime);
+	void SetTargetFrameTime(double targetFrameTime);
+	double GetTargetFrameTime() const { return targetFrameTime; }
+
+	//Block until the next frame is due, called once per frame
+	void Wait();
+
+	//Pacing error is the distance of each frame interval from the target. CPU utilisation is the thread's CPU time from
+	//the OS over the wall time, so blocking inside the frame is not counted and the spin is
+	void ReportMetrics();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	double targetFrameTime = 0.0;
+	double leadTime = PACING_INITIAL_LEAD;
+	bool started = false;
+	Clock::time_point deadline;
+	Clock::time_point lastWaitEnd;
+	double lastCpuTime = 0;
+
+	uint32_t frameCount = 0;
+	uint32_t pacedCount = 0;
+	uint32_t missedCount = 0; //Frames whose work alone overran the target
+	double intervalSum = 0;
+	double sleepSum = 0;
+	double spinSum = 0;
+	double cpuTimeSum = 0; //Thread CPU time between the ends of successive waits
+	double waitCpuTimeSum = 0; //Of that, spent inside the waits
+	double pacingErrorSum = 0;
+	double maxPacingError = 0;
+
+	static double milliseconds(Clock::duration duration);
+	static double threadCpuTime(); //Milliseconds of CPU time the calling thread has used
+};
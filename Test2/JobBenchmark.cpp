@@ -0,0 +1,155 @@
+#include "JobBenchmark.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <atomic>
+
+namespace
+{
+	//A few dozen dependent instructions, the result is kept so the work cannot be optimised away
+	uint32_t benchmarkItem(uint32_t item)
+	{
+		uint32_t value = item;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			value = value * 1664525u + 1013904223u;
+			value ^= value >> 13;
+		}
+		return value;
+	}
+
+	std::atomic<uint32_t> benchmarkSink{ 0 };
+}
+
+void JobBenchmark::Run(JobSystem &jobSystem, const std::string &csvPath)
+{
+	uint32_t originalWorkers = jobSystem.GetWorkerCount();
+
+	std::ofstream csv(csvPath, std::ios::trunc);
+	csv << "test,threads,grain,milliseconds,nanoseconds_per_job,speedup,efficiency\n";
+
+	std::cout << "\n---JOB SYSTEM BENCHMARK---\n";
+	std::cout << "Medians of " << JOB_BENCHMARK_REPETITIONS << " runs\n";
+
+	//Spawn overhead with every worker running, against calling the same function directly
+	std::function<void()> empty = []() {};
+	auto callStart = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < JOB_BENCHMARK_BATCH; i++)
+	{
+		empty();
+	}
+	auto callEnd = std::chrono::steady_clock::now();
+	double callNanoseconds = std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(callEnd - callStart).count() / JOB_BENCHMARK_BATCH;
+
+	double spawnNanoseconds = timeSpawn(jobSystem);
+	double parallelNanoseconds = timeParallelSpawn(jobSystem);
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Spawn overhead on " << jobSystem.GetWorkerCount() << " workers: " << spawnNanoseconds << " ns per empty job, " << parallelNanoseconds << " ns per single item parallel_for range, ";
+	std::cout << callNanoseconds << " ns per direct call\n";
+	csv << "spawn," << jobSystem.GetWorkerCount() + 1 << ",1,," << spawnNanoseconds << ",,\n";
+	csv << "parallel_for_spawn," << jobSystem.GetWorkerCount() + 1 << ",1,," << parallelNanoseconds << ",,\n";
+	csv << "direct_call,1,1,," << callNanoseconds << ",,\n";
+
+	//Scaling, each thread count on a freshly started job system
+	for (uint32_t grainSize : JOB_BENCHMARK_GRAINS)
+	{
+		double singleThreadMilliseconds = 0.0;
+
+		for (uint32_t threads : JOB_BENCHMARK_THREADS)
+		{
+			jobSystem.Release();
+			jobSystem.Initialise(threads - 1);
+
+			double milliseconds = timeScaling(jobSystem, grainSize);
+			if (threads == 1)
+			{
+				singleThreadMilliseconds = milliseconds;
+			}
+
+			double speedup = milliseconds > 0 ? singleThreadMilliseconds / milliseconds : 0.0;
+			double efficiency = speedup / threads * 100.0;
+
+			std::cout << "Grain " << std::setw(5) << grainSize << ", " << threads << " threads: " << std::setw(8) << milliseconds << " ms, ";
+			std::cout << std::setprecision(2) << speedup << "x, " << std::setprecision(1) << efficiency << "% efficiency\n";
+			csv << "scaling," << threads << "," << grainSize << "," << milliseconds << ",," << speedup << "," << efficiency << "\n";
+		}
+	}
+	std::cout << std::defaultfloat;
+
+	jobSystem.Release();
+	jobSystem.Initialise(originalWorkers);
+
+	std::cout << "Job system benchmark written to " << csvPath << ".\n";
+}
+
+double JobBenchmark::timeSpawn(JobSystem &jobSystem)
+{
+	std::vector<double> times;
+	for (uint32_t r = 0; r < JOB_BENCHMARK_REPETITIONS; r++)
+	{
+		auto spawnStart = std::chrono::steady_clock::now();
+
+		Job *root = jobSystem.Create([]() {});
+		for (uint32_t i = 0; i < JOB_BENCHMARK_BATCH; i++)
+		{
+			jobSystem.Run(jobSystem.Create([]() {}, root));
+		}
+		jobSystem.Run(root);
+		jobSystem.Wait(root);
+
+		auto spawnEnd = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(spawnEnd - spawnStart).count() / JOB_BENCHMARK_BATCH);
+	}
+
+	return median(times);
+}
+
+double JobBenchmark::timeParallelSpawn(JobSystem &jobSystem)
+{
+	std::vector<double> times;
+	for (uint32_t r = 0; r < JOB_BENCHMARK_REPETITIONS; r++)
+	{
+		auto spawnStart = std::chrono::steady_clock::now();
+
+		jobSystem.Wait(jobSystem.ParallelFor(0, JOB_BENCHMARK_BATCH, 1, [](uint32_t, uint32_t) {}));
+
+		auto spawnEnd = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(spawnEnd - spawnStart).count() / JOB_BENCHMARK_BATCH);
+	}
+
+	return median(times);
+}
+
+double JobBenchmark::timeScaling(JobSystem &jobSystem, uint32_t grainSize)
+{
+	std::vector<double> times;
+	for (uint32_t r = 0; r < JOB_BENCHMARK_REPETITIONS; r++)
+	{
+		auto runStart = std::chrono::steady_clock::now();
+
+		jobSystem.Wait(jobSystem.ParallelFor(0, JOB_BENCHMARK_ITEMS, grainSize, [](uint32_t first, uint32_t last)
+		{
+			uint32_t sum = 0;
+			for (uint32_t i = first; i < last; i++)
+			{
+				sum += benchmarkItem(i);
+			}
+			benchmarkSink.fetch_add(sum, std::memory_order_relaxed);
+		}));
+
+		auto runEnd = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(runEnd - runStart).count());
+	}
+
+	return median(times);
+}
+
+double JobBenchmark::median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+
+	size_t middle = values.size() / 2;
+
+	return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) * 0.5;
+}
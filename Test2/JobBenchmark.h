@@ -0,0 +1,38 @@
+#pragma once
+
+#include "JobSystem.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+//Threads compared for scaling, the waiting caller counts as one so a single thread runs with no workers
+const uint32_t JOB_BENCHMARK_THREADS[] = { 1, 2, 4, 8 };
+
+//Items per range job in the scaling runs, both fine enough that scheduling cost shows
+const uint32_t JOB_BENCHMARK_GRAINS[] = { 64, 1024 };
+
+//Items in each scaling run and jobs in each spawn batch
+const uint32_t JOB_BENCHMARK_ITEMS = 1 << 22;
+const uint32_t JOB_BENCHMARK_BATCH = 1024;
+
+//Timed runs per case, the median is reported
+const uint32_t JOB_BENCHMARK_REPETITIONS = 5;
+
+//Measures what the job system costs per job and how well fine-grained work scales across threads. Spawn overhead is
+//the time to create, run and wait for empty jobs against a direct call, scaling the speedup of a parallel_for over a
+//few dozen instructions per item
+class JobBenchmark
+{
+public:
+	//Restarts the job system at each thread count and leaves it with the workers it had before
+	void Run(JobSystem &jobSystem, const std::string &csvPath);
+
+private:
+	double timeSpawn(JobSystem &jobSystem);
+	double timeParallelSpawn(JobSystem &jobSystem);
+	double timeScaling(JobSystem &jobSystem, uint32_t grainSize);
+
+	static double median(std::vector<double> values);
+};
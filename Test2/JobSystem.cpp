@@ -0,0 +1,436 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+
+static_assert((JOB_POOL_SIZE & (JOB_POOL_SIZE - 1)) == 0, "JOB_POOL_SIZE must be a power of two");
+
+struct Job
+{
+	JobSystem::JobFunction function;
+	Job *parent;
+	std::atomic<int32_t> unfinished; //This job and its children still to run
+	std::atomic<int32_t> pendingDependencies; //Predecessors still to complete, plus one until Run
+	std::atomic<bool> completed; //Set once the continuations have been taken, the slot may be reused after it
+	std::atomic_flag continuationLock;
+	uint32_t continuationCount; //Guarded by continuationLock
+	Job *continuations[JOB_MAX_CONTINUATIONS];
+	bool onMainThread;
+
+	Job() : parent(nullptr), unfinished(0), pendingDependencies(0), completed(true), continuationCount(0), onMainThread(false)
+	{
+		continuationLock.clear();
+	}
+};
+
+namespace
+{
+	//Ring of jobs owned by one thread, allocation never takes a lock
+	struct JobPool
+	{
+		Job jobs[JOB_POOL_SIZE];
+		uint32_t next = 0;
+	};
+
+	thread_local std::unique_ptr<JobPool> threadPool;
+
+	//Set on worker threads, a job scheduled from a worker goes on that worker's own deque
+	thread_local JobSystem *workerSystem = nullptr;
+	thread_local uint32_t workerIndex = UINT32_MAX;
+
+	//Where threads that are not workers start looking for a deque to steal from
+	thread_local uint32_t stealStart = 0;
+
+	void lockContinuations(Job *job)
+	{
+		while (job->continuationLock.test_and_set(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void unlockContinuations(Job *job)
+	{
+		job->continuationLock.clear(std::memory_order_release);
+	}
+}
+
+void JobSystem::Initialise(uint32_t workerCount)
+{
+	mainThread = std::this_thread::get_id();
+	stopping = false;
+
+	workerCount = std::min(workerCount, JOB_SYSTEM_MAX_WORKERS);
+
+	//The last deque belongs to the main thread, so jobs it spawns while waiting are run newest first as on a worker
+	queues.resize(workerCount + 1);
+	for (std::unique_ptr<JobQueue> &queue : queues)
+	{
+		queue.reset(new JobQueue());
+	}
+	executedCounts.assign(workerCount, 0);
+	createdCount = 0;
+	stealCount = 0;
+	externalExecutedCount = 0;
+
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+
+	std::cout << "Job system started with " << workerCount << " worker threads.\n";
+}
+
+void JobSystem::Release()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	jobQueued.notify_all();
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+	queues.clear();
+}
+
+Job *JobSystem::Create(JobFunction function, Job *parent)
+{
+	return allocate(std::move(function), parent, false);
+}
+
+Job *JobSystem::CreateMainThread(JobFunction function, Job *parent)
+{
+	return allocate(std::move(function), parent, true);
+}
+
+bool JobSystem::AddDependency(Job *job, Job *predecessor)
+{
+	lockContinuations(predecessor);
+
+	//Already done, nothing to wait for
+	if (predecessor->completed.load(std::memory_order_relaxed))
+	{
+		unlockContinuations(predecessor);
+		return true;
+	}
+
+	if (predecessor->continuationCount == JOB_MAX_CONTINUATIONS)
+	{
+		unlockContinuations(predecessor);
+		return false;
+	}
+
+	job->pendingDependencies.fetch_add(1, std::memory_order_relaxed);
+	predecessor->continuations[predecessor->continuationCount++] = job;
+
+	unlockContinuations(predecessor);
+
+	return true;
+}
+
+void JobSystem::Run(Job *job)
+{
+	//Drops the hold taken at creation, the last predecessor to complete schedules it otherwise
+	if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		schedule(job);
+	}
+}
+
+bool JobSystem::IsComplete(const Job *job) const
+{
+	return job->completed.load(std::memory_order_acquire);
+}
+
+void JobSystem::Wait(const Job *job)
+{
+	while (!IsComplete(job))
+	{
+		if (!runOne())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+Job *JobSystem::ParallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, RangeFunction function, Job *parent)
+{
+	Job *root = Create([]() {}, parent);
+
+	if (end > begin)
+	{
+		Run(createRange(root, begin, end, std::max(grainSize, 1u), std::make_shared<RangeFunction>(std::move(function))));
+	}
+	Run(root);
+
+	return root;
+}
+
+void JobSystem::RunMainThreadJobs()
+{
+	Job *job;
+	while (mainThreadJobs.Pop(job))
+	{
+		execute(job);
+	}
+}
+
+void JobSystem::ReportMetrics()
+{
+	uint64_t executed = externalExecutedCount.load();
+	for (uint64_t count : executedCounts)
+	{
+		executed += count;
+	}
+
+	if (executed == 0)
+	{
+		return;
+	}
+
+	std::cout << "Job system: " << createdCount.load() << " jobs created, " << executed << " run, " << stealCount.load() << " stolen. Share per worker:";
+	for (uint64_t count : executedCounts)
+	{
+		std::cout << " " << count * 100.0 / executed << "%";
+	}
+	std::cout << ", waiting threads " << externalExecutedCount.load() * 100.0 / executed << "%.\n";
+}
+
+Job *JobSystem::allocate(JobFunction &&function, Job *parent, bool onMainThread)
+{
+	if (!threadPool)
+	{
+		threadPool.reset(new JobPool());
+	}
+
+	//The ring may come back round to a job still in flight, such as a parent this thread is running children of. Those
+	//are skipped, and only when every slot is in flight does the thread help run jobs until one frees up
+	Job *job = nullptr;
+	while (!job)
+	{
+		for (uint32_t i = 0; i < JOB_POOL_SIZE && !job; i++)
+		{
+			Job *candidate = &threadPool->jobs[threadPool->next++ & (JOB_POOL_SIZE - 1)];
+			if (candidate->completed.load(std::memory_order_acquire))
+			{
+				job = candidate;
+			}
+		}
+
+		if (!job && !runOne())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	job->function = std::move(function);
+	job->parent = parent;
+	job->unfinished.store(1, std::memory_order_relaxed);
+	job->pendingDependencies.store(1, std::memory_order_relaxed);
+	job->continuationCount = 0;
+	job->onMainThread = onMainThread;
+	job->completed.store(false, std::memory_order_release);
+
+	if (parent)
+	{
+		parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	createdCount.fetch_add(1, std::memory_order_relaxed);
+
+	return job;
+}
+
+void JobSystem::schedule(Job *job)
+{
+	if (job->onMainThread)
+	{
+		Job *queued = job;
+		while (!mainThreadJobs.Push(std::move(queued)))
+		{
+			std::this_thread::yield();
+		}
+		return;
+	}
+
+	uint32_t own = ownQueue();
+	if (own != UINT32_MAX)
+	{
+		//A full deque means this thread is far ahead of the others, running the job now is as good as any
+		if (!queues[own]->Push(job))
+		{
+			execute(job);
+			return;
+		}
+	}
+	else
+	{
+		Job *queued = job;
+		while (!injected.Push(std::move(queued)))
+		{
+			if (!runOne())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	queuedJobs.fetch_add(1, std::memory_order_release);
+	if (sleepingWorkers.load(std::memory_order_acquire) > 0)
+	{
+		jobQueued.notify_one();
+	}
+}
+
+bool JobSystem::runOne()
+{
+	Job *job = nullptr;
+
+	if (std::this_thread::get_id() == mainThread && mainThreadJobs.Pop(job))
+	{
+		execute(job);
+		return true;
+	}
+
+	uint32_t own = ownQueue();
+	bool found = (own != UINT32_MAX && queues[own]->Pop(job)) || injected.Pop(job);
+
+	//Nothing local, take the oldest job from another deque
+	uint32_t queueCount = (uint32_t)queues.size();
+	uint32_t start = own != UINT32_MAX ? own + 1 : stealStart++;
+	for (uint32_t i = 0; i < queueCount && !found; i++)
+	{
+		uint32_t victim = (start + i) % queueCount;
+		if (victim == own)
+		{
+			continue;
+		}
+
+		found = queues[victim]->Steal(job);
+		if (found)
+		{
+			stealCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	if (!found)
+	{
+		return false;
+	}
+
+	queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	execute(job);
+
+	return true;
+}
+
+void JobSystem::execute(Job *job)
+{
+	job->function();
+	job->function = nullptr; //Release whatever it captured now rather than when the slot is reused
+
+	if (workerSystem == this)
+	{
+		executedCounts[workerIndex]++;
+	}
+	else
+	{
+		externalExecutedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	finish(job);
+}
+
+void JobSystem::finish(Job *job)
+{
+	if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+
+	//Everything needed from the job is copied out before it is marked complete, its slot may be reused after that
+	Job *parent = job->parent;
+	Job *released[JOB_MAX_CONTINUATIONS];
+
+	lockContinuations(job);
+	uint32_t releasedCount = job->continuationCount;
+	std::copy(job->continuations, job->continuations + releasedCount, released);
+	job->completed.store(true, std::memory_order_release);
+	unlockContinuations(job);
+
+	for (uint32_t i = 0; i < releasedCount; i++)
+	{
+		if (released[i]->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			schedule(released[i]);
+		}
+	}
+
+	if (parent)
+	{
+		finish(parent);
+	}
+}
+
+uint32_t JobSystem::ownQueue() const
+{
+	if (workerSystem == this)
+	{
+		return workerIndex;
+	}
+
+	return std::this_thread::get_id() == mainThread ? (uint32_t)queues.size() - 1 : UINT32_MAX;
+}
+
+void JobSystem::workerLoop(uint32_t index)
+{
+	workerSystem = this;
+	workerIndex = index;
+
+	while (!stopping.load(std::memory_order_acquire))
+	{
+		if (runOne())
+		{
+			continue;
+		}
+
+		//Nothing to run or steal, sleep until a job is queued. The timeout covers a job queued between the check and
+		//the wait
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers.fetch_add(1, std::memory_order_acq_rel);
+		jobQueued.wait_for(lock, std::chrono::milliseconds(1), [this]()
+		{
+			return stopping.load(std::memory_order_acquire) || queuedJobs.load(std::memory_order_acquire) > 0;
+		});
+		sleepingWorkers.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	if (workerExit)
+	{
+		workerExit();
+	}
+
+	workerSystem = nullptr;
+	workerIndex = UINT32_MAX;
+}
+
+Job *JobSystem::createRange(Job *root, uint32_t begin, uint32_t end, uint32_t grainSize, std::shared_ptr<RangeFunction> function)
+{
+	//Upper halves are split off as jobs until the rest fits the grain, so thieves take the largest ranges left
+	return Create([this, root, begin, end, grainSize, function]()
+	{
+		uint32_t last = end;
+		while (last - begin > grainSize)
+		{
+			uint32_t middle = begin + (last - begin) / 2;
+			Run(createRange(root, middle, last, grainSize, function));
+			last = middle;
+		}
+
+		(*function)(begin, last);
+	}, root);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "WorkStealingQueue.h"
+#include "LockFreeQueue.h"
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+//Upper bound on worker threads
+const uint32_t JOB_SYSTEM_MAX_WORKERS = 16;
+
+//Jobs each thread allocates from a ring of this size. A slot is only reused once the job in it has completed, so a
+//handle stays valid until its thread has created this many newer jobs
+const uint32_t JOB_POOL_SIZE = 4096;
+
+//Capacity of each worker's deque and of the queue jobs from other threads are injected through
+const size_t JOB_QUEUE_SIZE = 4096;
+
+//Jobs waiting on each job to complete, more dependents should wait on a shared empty job instead
+const uint32_t JOB_MAX_CONTINUATIONS = 16;
+
+//Opaque handle, see JOB_POOL_SIZE for how long it lasts
+struct Job;
+
+//Work-stealing scheduler for frame and loading tasks. Every worker owns a deque it pushes and pops at one end while idle
+//workers steal from the other, so spawning is contention free and the oldest, largest pieces of work are the ones that
+//move. A job completes once it and its children have run, then releases the jobs that depend on it. Jobs created for
+//the main thread are only ever run there, for GLFW and anything else with thread affinity
+class JobSystem
+{
+public:
+	typedef std::function<void()> JobFunction;
+	typedef std::function<void(uint32_t first, uint32_t last)> RangeFunction;
+
+	//Worker threads to start, zero leaves every job to threads waiting on one. The calling thread becomes the main thread
+	void Initialise(uint32_t workerCount);
+
+	//Joins the workers, jobs not yet run are dropped
+	void Release();
+
+	//Run by every worker as it stops, for state kept per thread such as command pools. Kept across restarts
+	void SetWorkerExit(JobFunction function) { workerExit = std::move(function); }
+
+	//Nothing runs until Run is called. A parent does not complete, nor release its dependents, before its children have
+	Job *Create(JobFunction function, Job *parent = nullptr);
+	Job *CreateMainThread(JobFunction function, Job *parent = nullptr);
+
+	//The job will not start before the predecessor has completed. Both must have been created and the job not yet run.
+	//Returns false if the predecessor has no room for another dependent
+	bool AddDependency(Job *job, Job *predecessor);
+
+	//Queue the job once its dependencies have completed, on this thread's deque when called from a worker
+	void Run(Job *job);
+
+	bool IsComplete(const Job *job) const;
+
+	//Runs other jobs until the job has completed, so it never blocks a worker
+	void Wait(const Job *job);
+
+	//Split [begin, end) into jobs of at most grainSize items. Returns the running job the ranges are children of
+	Job *ParallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, RangeFunction function, Job *parent = nullptr);
+
+	//Main thread only, runs the jobs created for it that are ready
+	void RunMainThreadJobs();
+
+	uint32_t GetWorkerCount() const { return (uint32_t)workers.size(); }
+
+	void ReportMetrics();
+
+private:
+	typedef WorkStealingQueue<Job*, JOB_QUEUE_SIZE> JobQueue;
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<JobQueue>> queues; //One per worker, same index, then the main thread's
+	std::vector<uint64_t> executedCounts; //Per worker, only written by that worker
+	std::thread::id mainThread;
+	JobFunction workerExit;
+
+	LockFreeQueue<Job*, JOB_QUEUE_SIZE> injected; //Ready jobs scheduled from threads that are not workers
+	LockFreeQueue<Job*, 256> mainThreadJobs;
+
+	std::atomic<bool> stopping{ false };
+	std::atomic<int32_t> queuedJobs{ 0 };
+	std::atomic<uint32_t> sleepingWorkers{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable jobQueued;
+
+	std::atomic<uint64_t> createdCount{ 0 };
+	std::atomic<uint64_t> stealCount{ 0 };
+	std::atomic<uint64_t> externalExecutedCount{ 0 }; //Run by threads waiting on a job
+
+	Job *allocate(JobFunction &&function, Job *parent, bool onMainThread);
+	void schedule(Job *job);
+	bool runOne();
+	uint32_t ownQueue() const; //Deque the calling thread owns, UINT32_MAX for threads that inject instead
+	void execute(Job *job);
+	void finish(Job *job);
+	void workerLoop(uint32_t index);
+	Job *createRange(Job *root, uint32_t begin, uint32_t end, uint32_t grainSize, std::shared_ptr<RangeFunction> function);
+};
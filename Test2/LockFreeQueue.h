@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+//Bounded multi-producer multi-consumer queue without locks. Every cell carries a sequence number telling producers and
+//consumers whose turn it is, so a push or pop only ever contends on one position counter. Capacity must be a power of two
+template<typename T, size_t Capacity>
+class LockFreeQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "LockFreeQueue capacity must be a power of two");
+
+public:
+	LockFreeQueue()
+	{
+		for (size_t i = 0; i < Capacity; i++)
+		{
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	LockFreeQueue(const LockFreeQueue&) = delete;
+	LockFreeQueue &operator=(const LockFreeQueue&) = delete;
+
+	//Returns false when the queue is full, the value is only moved from on success
+	bool Push(T &&value)
+	{
+		Cell *cell;
+		size_t position = enqueuePosition.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			cell = &cells[position & (Capacity - 1)];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+			if (difference == 0)
+			{
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->value = std::move(value);
+		cell->sequence.store(position + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	//Returns false when the queue is empty
+	bool Pop(T &value)
+	{
+		Cell *cell;
+		size_t position = dequeuePosition.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			cell = &cells[position & (Capacity - 1)];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+			if (difference == 0)
+			{
+				if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = dequeuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		value = std::move(cell->value);
+		cell->value = T();
+		cell->sequence.store(position + Capacity, std::memory_order_release);
+
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	//Producers and consumers each get their own cache line
+	Cell cells[Capacity];
+	alignas(64) std::atomic<size_t> enqueuePosition{ 0 };
+	alignas(64) std::atomic<size_t> dequeuePosition{ 0 };
+};
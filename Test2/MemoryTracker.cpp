@@ -0,0 +1,233 @@
+#include "MemoryTracker.h"
+
+void MemoryTracker::Initialise(VkInstance instance, VkPhysicalDevice device, bool budgetExtensionEnabled)
+{
+	physicalDevice = device;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	heapTotals.assign(memoryProperties.memoryHeapCount, HeapTotals{ 0, 0, 0 });
+
+#ifdef VK_EXT_memory_budget
+	if (budgetExtensionEnabled)
+	{
+		getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+		budgetSupported = getMemoryProperties2 != nullptr;
+	}
+#endif
+
+	std::cout << "Memory tracking initialised, budget extension " << (budgetSupported ? "available" : "unavailable") << ".\n";
+}
+
+void MemoryTracker::RecordAllocation(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, MemoryUsageTag tag, AllocationSite site)
+{
+	AllocationRecord record = {};
+	record.size = size;
+	record.memoryTypeIndex = memoryTypeIndex;
+	record.heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	record.tag = tag;
+	record.site = site;
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	allocations[memory] = record;
+
+	HeapTotals &heap = heapTotals[record.heapIndex];
+	heap.allocated += size;
+	heap.allocationCount++;
+	if (heap.allocated > heap.peak)
+	{
+		heap.peak = heap.allocated;
+	}
+
+	tagTotals[tag] += size;
+}
+
+void MemoryTracker::RecordFree(VkDeviceMemory memory)
+{
+	if (memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	auto found = allocations.find(memory);
+	if (found == allocations.end())
+	{
+		std::cout << "Freed device memory that was never recorded.\n";
+		return;
+	}
+
+	const AllocationRecord &record = found->second;
+
+	HeapTotals &heap = heapTotals[record.heapIndex];
+	heap.allocated -= record.size;
+	heap.allocationCount--;
+
+	tagTotals[record.tag] -= record.size;
+
+	allocations.erase(found);
+}
+
+void MemoryTracker::ReportHeaps()
+{
+	std::vector<VkDeviceSize> heapBudget, heapUsage;
+	bool haveBudget = queryBudget(heapBudget, heapUsage);
+
+	const double mb = 1024.0 * 1024.0;
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	std::cout << "\n---DEVICE MEMORY---\n";
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		const HeapTotals &heap = heapTotals[i];
+
+		std::cout << "Heap " << i << ((memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : " (host)");
+		std::cout << ": " << heap.allocated / mb << " MB in " << heap.allocationCount << " allocations, peak " << heap.peak / mb << " MB";
+
+		if (haveBudget)
+		{
+			std::cout << ", process usage " << heapUsage[i] / mb << " MB of " << heapBudget[i] / mb << " MB budget";
+		}
+		else
+		{
+			std::cout << ", heap size " << memoryProperties.memoryHeaps[i].size / mb << " MB";
+		}
+		std::cout << '\n';
+	}
+
+	for (uint32_t tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+	{
+		std::cout << TagName((MemoryUsageTag)tag) << ": " << tagTotals[tag] / mb << " MB\n";
+	}
+	std::cout << "---END DEVICE MEMORY---\n\n";
+}
+
+void MemoryTracker::WriteSnapshot(const std::string &path)
+{
+	std::vector<VkDeviceSize> heapBudget, heapUsage;
+	bool haveBudget = queryBudget(heapBudget, heapUsage);
+
+	std::ofstream file(path, std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		std::cout << "Failed to open memory snapshot file.\n";
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	file << "{\n";
+	file << "  \"snapshot\": " << snapshotCount++ << ",\n";
+	file << "  \"budgetExtension\": " << (haveBudget ? "true" : "false") << ",\n";
+
+	file << "  \"heaps\": [\n";
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		const HeapTotals &heap = heapTotals[i];
+
+		file << "    { \"index\": " << i;
+		file << ", \"size\": " << memoryProperties.memoryHeaps[i].size;
+		file << ", \"deviceLocal\": " << ((memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false");
+		file << ", \"allocated\": " << heap.allocated;
+		file << ", \"allocationCount\": " << heap.allocationCount;
+		file << ", \"peak\": " << heap.peak;
+		if (haveBudget)
+		{
+			file << ", \"budget\": " << heapBudget[i] << ", \"usage\": " << heapUsage[i];
+		}
+		file << " }" << (i + 1 < memoryProperties.memoryHeapCount ? ",\n" : "\n");
+	}
+	file << "  ],\n";
+
+	file << "  \"tags\": {\n";
+	for (uint32_t tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+	{
+		file << "    \"" << TagName((MemoryUsageTag)tag) << "\": " << tagTotals[tag] << (tag + 1 < MEMORY_TAG_COUNT ? ",\n" : "\n");
+	}
+	file << "  },\n";
+
+	file << "  \"allocations\": [\n";
+	size_t written = 0;
+	for (const auto &entry : allocations)
+	{
+		const AllocationRecord &record = entry.second;
+
+		file << "    { \"handle\": \"" << (const void *)entry.first << "\"";
+		file << ", \"size\": " << record.size;
+		file << ", \"memoryType\": " << record.memoryTypeIndex;
+		file << ", \"heap\": " << record.heapIndex;
+		file << ", \"tag\": \"" << TagName(record.tag) << "\"";
+		file << ", \"function\": \"" << record.site.function << "\"";
+		file << ", \"line\": " << record.site.line;
+		file << " }" << (++written < allocations.size() ? ",\n" : "\n");
+	}
+	file << "  ]\n";
+	file << "}\n";
+
+	std::cout << "Memory snapshot written to " << path << ".\n";
+}
+
+void MemoryTracker::GetHeapBudget(uint32_t heapIndex, VkDeviceSize &budget, VkDeviceSize &usage)
+{
+	std::vector<VkDeviceSize> heapBudget, heapUsage;
+	if (queryBudget(heapBudget, heapUsage))
+	{
+		budget = heapBudget[heapIndex];
+		usage = heapUsage[heapIndex];
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	budget = (VkDeviceSize)(memoryProperties.memoryHeaps[heapIndex].size * DEFAULT_HEAP_BUDGET_FRACTION);
+	usage = heapTotals[heapIndex].allocated;
+}
+
+const char *MemoryTracker::TagName(MemoryUsageTag tag)
+{
+	switch (tag)
+	{
+	case MEMORY_TAG_VERTEX:
+		return "vertex";
+	case MEMORY_TAG_INDEX:
+		return "index";
+	case MEMORY_TAG_UNIFORM:
+		return "uniform";
+	case MEMORY_TAG_STAGING:
+		return "staging";
+	case MEMORY_TAG_TEXTURE:
+		return "texture";
+	case MEMORY_TAG_ATTACHMENT:
+		return "attachment";
+	default:
+		return "unknown";
+	}
+}
+
+bool MemoryTracker::queryBudget(std::vector<VkDeviceSize> &heapBudget, std::vector<VkDeviceSize> &heapUsage)
+{
+#ifdef VK_EXT_memory_budget
+	if (budgetSupported)
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {};
+		budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		budget_properties.pNext = nullptr;
+
+		VkPhysicalDeviceMemoryProperties2KHR memory_properties = {};
+		memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+		memory_properties.pNext = &budget_properties;
+
+		getMemoryProperties2(physicalDevice, &memory_properties);
+
+		heapBudget.assign(budget_properties.heapBudget, budget_properties.heapBudget + memoryProperties.memoryHeapCount);
+		heapUsage.assign(budget_properties.heapUsage, budget_properties.heapUsage + memoryProperties.memoryHeapCount);
+
+		return true;
+	}
+#endif
+
+	return false;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+//What a block of device memory is used for, reported per tag in the snapshot
+enum MemoryUsageTag
+{
+	MEMORY_TAG_VERTEX,
+	MEMORY_TAG_INDEX,
+	MEMORY_TAG_UNIFORM,
+	MEMORY_TAG_STAGING,
+	MEMORY_TAG_TEXTURE,
+	MEMORY_TAG_ATTACHMENT,
+	MEMORY_TAG_COUNT
+};
+
+//Where an allocation was requested from, both strings are literals so recording one costs no copies
+struct AllocationSite
+{
+	const char *function;
+	int line;
+};
+
+#define ALLOCATION_SITE AllocationSite{ __FUNCTION__, __LINE__ }
+
+//Share of a heap assumed to be ours when VK_EXT_memory_budget cannot say
+const float DEFAULT_HEAP_BUDGET_FRACTION = 0.8f;
+
+struct AllocationRecord
+{
+	VkDeviceSize size;
+	uint32_t memoryTypeIndex;
+	uint32_t heapIndex;
+	MemoryUsageTag tag;
+	AllocationSite site;
+};
+
+//Registry of every live VkDeviceMemory. Recording is a hash insert and a few counter updates so it can stay on for benchmarks
+class MemoryTracker
+{
+public:
+	void Initialise(VkInstance instance, VkPhysicalDevice physicalDevice, bool budgetExtensionEnabled);
+
+	void RecordAllocation(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, MemoryUsageTag tag, AllocationSite site);
+	void RecordFree(VkDeviceMemory memory);
+
+	//Print per-heap totals, against VK_EXT_memory_budget figures when the extension is enabled
+	void ReportHeaps();
+
+	//Write every live allocation and the heap totals as JSON
+	void WriteSnapshot(const std::string &path);
+
+	//Budget and current usage of a heap, from the extension when enabled, otherwise our tracked total against a fixed share
+	//of the heap size
+	void GetHeapBudget(uint32_t heapIndex, VkDeviceSize &budget, VkDeviceSize &usage);
+	uint32_t GetHeapIndex(uint32_t memoryTypeIndex) const { return memoryProperties.memoryTypes[memoryTypeIndex].heapIndex; }
+
+	static const char *TagName(MemoryUsageTag tag);
+
+private:
+	struct HeapTotals
+	{
+		VkDeviceSize allocated;
+		uint32_t allocationCount;
+		VkDeviceSize peak;
+	};
+
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties = {};
+
+	bool budgetSupported = false;
+#ifdef VK_EXT_memory_budget
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+#endif
+
+	std::mutex registryMutex;
+	std::unordered_map<VkDeviceMemory, AllocationRecord> allocations;
+	std::vector<HeapTotals> heapTotals;
+	VkDeviceSize tagTotals[MEMORY_TAG_COUNT] = {};
+
+	uint32_t snapshotCount = 0;
+
+	//Fills budget and usage per heap, returns false if the extension is unavailable
+	bool queryBudget(std::vector<VkDeviceSize> &heapBudget, std::vector<VkDeviceSize> &heapUsage);
+};
@@ -0,0 +1,305 @@
+#include "MeshChunkFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+
+bool MeshChunkFile::Build(const std::string &path, const std::string &sourcePath, const float *vertexData, uint32_t vertexCount, uint32_t componentCount, const uint32_t *indexData, uint32_t indexCount, bool compress)
+{
+	uint32_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || componentCount < 3)
+	{
+		return false;
+	}
+
+	//A malformed model could index past its vertices
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		if (indexData[i] >= vertexCount)
+		{
+			std::cout << "Chunk file " << path << " not built, index " << indexData[i] << " is past the " << vertexCount << " vertices.\n";
+			return false;
+		}
+	}
+
+	std::vector<float> centroids((size_t)triangleCount * 3);
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			float sum = 0.0f;
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				sum += vertexData[(size_t)indexData[t * 3 + corner] * componentCount + axis];
+			}
+			centroids[(size_t)t * 3 + axis] = sum / 3.0f;
+		}
+	}
+
+	std::vector<uint32_t> triangles(triangleCount);
+	std::iota(triangles.begin(), triangles.end(), 0);
+
+	//Median splits along the longest axis of the centroid bounds until every range fits in a chunk
+	std::vector<std::pair<uint32_t, uint32_t>> ranges;
+	std::vector<std::pair<uint32_t, uint32_t>> pending = { { 0, triangleCount } };
+	while (!pending.empty())
+	{
+		std::pair<uint32_t, uint32_t> range = pending.back();
+		pending.pop_back();
+
+		if (range.second - range.first <= CHUNK_MAX_TRIANGLES)
+		{
+			ranges.push_back(range);
+			continue;
+		}
+
+		float minimum[3], maximum[3];
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			minimum[axis] = maximum[axis] = centroids[(size_t)triangles[range.first] * 3 + axis];
+		}
+		for (uint32_t i = range.first; i < range.second; i++)
+		{
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				minimum[axis] = std::min(minimum[axis], centroids[(size_t)triangles[i] * 3 + axis]);
+				maximum[axis] = std::max(maximum[axis], centroids[(size_t)triangles[i] * 3 + axis]);
+			}
+		}
+
+		uint32_t splitAxis = 0;
+		for (uint32_t axis = 1; axis < 3; axis++)
+		{
+			if (maximum[axis] - minimum[axis] > maximum[splitAxis] - minimum[splitAxis])
+			{
+				splitAxis = axis;
+			}
+		}
+
+		uint32_t middle = range.first + (range.second - range.first) / 2;
+		std::nth_element(triangles.begin() + range.first, triangles.begin() + middle, triangles.begin() + range.second, [&](uint32_t a, uint32_t b)
+		{
+			return centroids[(size_t)a * 3 + splitAxis] < centroids[(size_t)b * 3 + splitAxis];
+		});
+
+		pending.push_back({ range.first, middle });
+		pending.push_back({ middle, range.second });
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Failed to create chunk file " << path << ".\n";
+		return false;
+	}
+
+	ChunkFileHeader fileHeader = {};
+	fileHeader.magic = CHUNK_FILE_MAGIC;
+	fileHeader.version = CHUNK_FILE_VERSION;
+	fileHeader.componentCount = componentCount;
+	fileHeader.chunkCount = (uint32_t)ranges.size();
+	AssetPack::GetSourceStamp(sourcePath, fileHeader.source);
+
+	//Records are written once every payload offset is known
+	std::vector<ChunkRecord> records(ranges.size());
+	uint64_t offset = sizeof(ChunkFileHeader) + records.size() * sizeof(ChunkRecord);
+	uint64_t rawBytes = 0;
+	file.seekp(offset);
+
+	for (size_t c = 0; c < ranges.size(); c++)
+	{
+		//Chunk local vertices in first use order
+		std::unordered_map<uint32_t, uint32_t> localIndex;
+		std::vector<uint32_t> chunkVertices;
+		std::vector<uint32_t> chunkIndices;
+
+		for (uint32_t i = ranges[c].first; i < ranges[c].second; i++)
+		{
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t vertex = indexData[triangles[i] * 3 + corner];
+				auto inserted = localIndex.insert({ vertex, (uint32_t)chunkVertices.size() });
+				if (inserted.second)
+				{
+					chunkVertices.push_back(vertex);
+				}
+				chunkIndices.push_back(inserted.first->second);
+			}
+		}
+
+		ChunkRecord &record = records[c];
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			record.boundsMin[axis] = record.boundsMax[axis] = vertexData[(size_t)chunkVertices[0] * componentCount + axis];
+		}
+		for (uint32_t vertex : chunkVertices)
+		{
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				record.boundsMin[axis] = std::min(record.boundsMin[axis], vertexData[(size_t)vertex * componentCount + axis]);
+				record.boundsMax[axis] = std::max(record.boundsMax[axis], vertexData[(size_t)vertex * componentCount + axis]);
+			}
+		}
+
+		for (uint32_t lod = 0; lod < CHUNK_LOD_COUNT; lod++)
+		{
+			std::vector<float> lodVertices;
+			std::vector<uint32_t> lodIndices;
+			buildLod(vertexData, componentCount, chunkVertices, chunkIndices, record, CHUNK_LOD_RESOLUTIONS[lod], lodVertices, lodIndices);
+
+			std::vector<uint8_t> payload(lodVertices.size() * sizeof(float) + lodIndices.size() * sizeof(uint32_t));
+			memcpy(payload.data(), lodVertices.data(), lodVertices.size() * sizeof(float));
+			memcpy(payload.data() + lodVertices.size() * sizeof(float), lodIndices.data(), lodIndices.size() * sizeof(uint32_t));
+			rawBytes += payload.size();
+
+			if (compress)
+			{
+				payload = BlockCompression::Compress(payload.data(), payload.size());
+			}
+
+			record.lods[lod].offset = offset;
+			record.lods[lod].vertexCount = (uint32_t)(lodVertices.size() / componentCount);
+			record.lods[lod].indexCount = (uint32_t)lodIndices.size();
+			record.lods[lod].storedSize = (uint32_t)payload.size();
+			record.lods[lod].compressed = compress ? 1 : 0;
+
+			file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+			offset += payload.size();
+
+			fileHeader.maxVertexCount = std::max(fileHeader.maxVertexCount, record.lods[lod].vertexCount);
+			fileHeader.maxIndexCount = std::max(fileHeader.maxIndexCount, record.lods[lod].indexCount);
+		}
+	}
+
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+	file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(ChunkRecord));
+
+	if (!file.good())
+	{
+		std::cout << "Failed to write chunk file " << path << ".\n";
+		return false;
+	}
+
+	std::cout << "Chunk file written: " << records.size() << " chunks, " << rawBytes << " bytes of levels stored in " << offset << " bytes.\n";
+
+	return true;
+}
+
+bool MeshChunkFile::Open(const std::string &path, const std::string &sourcePath)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	ChunkFileHeader fileHeader;
+	file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
+	if (!file.good() || fileHeader.magic != CHUNK_FILE_MAGIC || fileHeader.version != CHUNK_FILE_VERSION || fileHeader.chunkCount == 0)
+	{
+		std::cout << "Chunk file " << path << " is not valid.\n";
+		return false;
+	}
+
+	SourceStamp source;
+	if (AssetPack::GetSourceStamp(sourcePath, source) && (source.size != fileHeader.source.size || source.modifiedTime != fileHeader.source.modifiedTime))
+	{
+		std::cout << "Chunk file " << path << " is older than " << sourcePath << ", rebuilding it.\n";
+		return false;
+	}
+
+	std::vector<ChunkRecord> records(fileHeader.chunkCount);
+	file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(ChunkRecord));
+	if (!file.good())
+	{
+		std::cout << "Chunk file " << path << " is truncated.\n";
+		return false;
+	}
+
+	filePath = path;
+	header = fileHeader;
+	chunks.swap(records);
+
+	return true;
+}
+
+bool MeshChunkFile::ReadLod(uint32_t chunk, uint32_t lod, std::vector<uint8_t> &data) const
+{
+	if (chunk >= chunks.size() || lod >= CHUNK_LOD_COUNT)
+	{
+		return false;
+	}
+
+	const ChunkLod &chunkLod = chunks[chunk].lods[lod];
+	data.resize((size_t)chunkLod.vertexCount * header.componentCount * sizeof(float) + (size_t)chunkLod.indexCount * sizeof(uint32_t));
+	if (data.empty())
+	{
+		return true;
+	}
+
+	std::vector<uint8_t> stored;
+	std::vector<uint8_t> &target = chunkLod.compressed ? stored : data;
+	target.resize(chunkLod.storedSize);
+
+	//A stream per read, so loader threads never share a file position
+	std::ifstream file(filePath, std::ios::binary);
+	file.seekg(chunkLod.offset);
+	file.read(reinterpret_cast<char*>(target.data()), target.size());
+	if (!file.good())
+	{
+		return false;
+	}
+
+	//Several loader threads already read chunks side by side, so each level decodes on its own thread
+	return !chunkLod.compressed || BlockCompression::Decompress(stored.data(), stored.size(), data.data(), data.size(), 1);
+}
+
+void MeshChunkFile::buildLod(const float *vertexData, uint32_t componentCount, const std::vector<uint32_t> &chunkVertices, const std::vector<uint32_t> &chunkIndices,
+	const ChunkRecord &record, uint32_t resolution, std::vector<float> &lodVertices, std::vector<uint32_t> &lodIndices)
+{
+	//Vertices are clustered by grid cell, the first vertex of a cell stands in for the rest so its attributes stay valid
+	std::vector<uint32_t> remap(chunkVertices.size());
+	std::unordered_map<uint64_t, uint32_t> cells;
+
+	for (uint32_t v = 0; v < chunkVertices.size(); v++)
+	{
+		const float *vertex = vertexData + (size_t)chunkVertices[v] * componentCount;
+
+		uint64_t key = v;
+		if (resolution > 0)
+		{
+			key = 0;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				float extent = record.boundsMax[axis] - record.boundsMin[axis];
+				uint32_t cell = extent > 0.0f ? (uint32_t)((vertex[axis] - record.boundsMin[axis]) / extent * resolution) : 0;
+				key = key * resolution + std::min(cell, resolution - 1);
+			}
+		}
+
+		auto inserted = cells.insert({ key, (uint32_t)(lodVertices.size() / componentCount) });
+		if (inserted.second)
+		{
+			lodVertices.insert(lodVertices.end(), vertex, vertex + componentCount);
+		}
+		remap[v] = inserted.first->second;
+	}
+
+	//Triangles collapsed into a cell are dropped
+	for (size_t i = 0; i + 2 < chunkIndices.size(); i += 3)
+	{
+		uint32_t a = remap[chunkIndices[i]];
+		uint32_t b = remap[chunkIndices[i + 1]];
+		uint32_t c = remap[chunkIndices[i + 2]];
+
+		if (a != b && b != c && a != c)
+		{
+			lodIndices.push_back(a);
+			lodIndices.push_back(b);
+			lodIndices.push_back(c);
+		}
+	}
+}
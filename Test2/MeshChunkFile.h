@@ -0,0 +1,81 @@
+#pragma once
+
+#include "BlockCompression.h"
+#include "AssetPack.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//Chunks are split until they hold no more triangles than this, which bounds the size of a pool slot
+const uint32_t CHUNK_MAX_TRIANGLES = 16384;
+
+//Levels of detail stored per chunk. Level 0 is the full mesh, coarser levels merge the vertices falling in one cell of
+//a grid over the chunk bounds with this many cells per axis
+const uint32_t CHUNK_LOD_COUNT = 3;
+const uint32_t CHUNK_LOD_RESOLUTIONS[CHUNK_LOD_COUNT] = { 0, 32, 8 };
+
+const uint32_t CHUNK_FILE_MAGIC = 0x4B48434D; //"MCHK"
+const uint32_t CHUNK_FILE_VERSION = 3;
+
+//Vertices followed by indices local to the chunk, at offset bytes into the file. Compressed levels are stored as a
+//BlockCompression stream of storedSize bytes
+struct ChunkLod
+{
+	uint64_t offset;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t storedSize;
+	uint32_t compressed;
+};
+
+struct ChunkRecord
+{
+	float boundsMin[3];
+	float boundsMax[3];
+	ChunkLod lods[CHUNK_LOD_COUNT];
+};
+
+//Start of a chunk file, followed by the chunk records and their payloads
+struct ChunkFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t componentCount; //Floats per vertex, the first three are the position
+	uint32_t chunkCount;
+	uint32_t maxVertexCount; //Largest level of any chunk, the size of a pool slot
+	uint32_t maxIndexCount;
+	SourceStamp source; //Of the model the chunks were built from
+};
+
+//On disk cache of a mesh partitioned into spatial chunks, so a mesh larger than device memory can be streamed a chunk
+//at a time. Triangles are split at the median of their centroids along the longest axis until each chunk is small
+//enough, then every chunk is written at each level of detail
+class MeshChunkFile
+{
+public:
+	static bool Build(const std::string &path, const std::string &sourcePath, const float *vertexData, uint32_t vertexCount, uint32_t componentCount, const uint32_t *indexData, uint32_t indexCount, bool compress);
+
+	//Read the header and chunk records, the payloads stay on disk. Fails if the file was built from an older version of
+	//sourcePath so the caller builds it again
+	bool Open(const std::string &path, const std::string &sourcePath);
+	bool IsOpen() const { return !chunks.empty(); }
+
+	//Read one level of a chunk, vertices then indices, decompressed if stored compressed. Safe to call from several
+	//threads at once
+	bool ReadLod(uint32_t chunk, uint32_t lod, std::vector<uint8_t> &data) const;
+
+	const std::vector<ChunkRecord> &GetChunks() const { return chunks; }
+	uint32_t GetComponentCount() const { return header.componentCount; }
+	uint32_t GetMaxVertexCount() const { return header.maxVertexCount; }
+	uint32_t GetMaxIndexCount() const { return header.maxIndexCount; }
+
+private:
+	std::string filePath;
+	ChunkFileHeader header = {};
+	std::vector<ChunkRecord> chunks;
+
+	static void buildLod(const float *vertexData, uint32_t componentCount, const std::vector<uint32_t> &chunkVertices, const std::vector<uint32_t> &chunkIndices,
+		const ChunkRecord &record, uint32_t resolution, std::vector<float> &lodVertices, std::vector<uint32_t> &lodIndices);
+};
@@ -0,0 +1,208 @@
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+std::vector<uint8_t> MeshCodec::Encode(const float *vertexData, uint32_t vertexCount, uint32_t componentCount, const uint32_t *indexData, uint32_t indexCount)
+{
+	MeshStreamHeader header = {};
+	header.magic = MESH_CODEC_MAGIC;
+	header.version = MESH_CODEC_VERSION;
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.componentCount = std::min(componentCount, MESH_CODEC_MAX_COMPONENTS);
+	header.blockSize = MESH_CODEC_BLOCK_SIZE;
+	header.vertexBlockCount = (vertexCount + MESH_CODEC_BLOCK_SIZE - 1) / MESH_CODEC_BLOCK_SIZE;
+	header.indexBlockCount = (indexCount + MESH_CODEC_BLOCK_SIZE - 1) / MESH_CODEC_BLOCK_SIZE;
+
+	//Quantisation range of each component over the whole mesh
+	for (uint32_t c = 0; c < header.componentCount; c++)
+	{
+		float minimum = vertexCount > 0 ? vertexData[c] : 0.0f;
+		float maximum = minimum;
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			minimum = std::min(minimum, vertexData[v * componentCount + c]);
+			maximum = std::max(maximum, vertexData[v * componentCount + c]);
+		}
+
+		header.componentMin[c] = minimum;
+		header.componentScale[c] = (maximum - minimum) / 65535.0f;
+	}
+
+	std::vector<uint32_t> blockOffsets;
+	std::vector<uint8_t> payload;
+
+	for (uint32_t block = 0; block < header.vertexBlockCount; block++)
+	{
+		blockOffsets.push_back((uint32_t)payload.size());
+
+		uint32_t previous[MESH_CODEC_MAX_COMPONENTS] = {};
+		uint32_t last = std::min((block + 1) * MESH_CODEC_BLOCK_SIZE, vertexCount);
+
+		for (uint32_t v = block * MESH_CODEC_BLOCK_SIZE; v < last; v++)
+		{
+			for (uint32_t c = 0; c < header.componentCount; c++)
+			{
+				uint32_t quantised = quantise(vertexData[v * componentCount + c], header.componentMin[c], header.componentScale[c]);
+				writeVarint(payload, zigzag((int32_t)quantised - (int32_t)previous[c]));
+				previous[c] = quantised;
+			}
+		}
+	}
+
+	for (uint32_t block = 0; block < header.indexBlockCount; block++)
+	{
+		blockOffsets.push_back((uint32_t)payload.size());
+
+		//Wrapping arithmetic keeps every 32 bit index exact
+		uint32_t previous = 0;
+		uint32_t last = std::min((block + 1) * MESH_CODEC_BLOCK_SIZE, indexCount);
+
+		for (uint32_t i = block * MESH_CODEC_BLOCK_SIZE; i < last; i++)
+		{
+			writeVarint(payload, zigzag((int32_t)(indexData[i] - previous)));
+			previous = indexData[i];
+		}
+	}
+
+	header.payloadOffset = (uint32_t)(sizeof(MeshStreamHeader) + blockOffsets.size() * sizeof(uint32_t));
+
+	//Padded to whole words, the shader reads the payload a word at a time
+	size_t streamSize = header.payloadOffset + payload.size();
+	std::vector<uint8_t> stream((streamSize + 3) / 4 * 4, 0);
+
+	memcpy(stream.data(), &header, sizeof(header));
+	if (!blockOffsets.empty())
+	{
+		memcpy(stream.data() + sizeof(header), blockOffsets.data(), blockOffsets.size() * sizeof(uint32_t));
+	}
+	if (!payload.empty())
+	{
+		memcpy(stream.data() + header.payloadOffset, payload.data(), payload.size());
+	}
+
+	return stream;
+}
+
+bool MeshCodec::Decode(const std::vector<uint8_t> &stream, std::vector<float> &vertexData, std::vector<uint32_t> &indexData)
+{
+	MeshStreamHeader header;
+	if (!ReadHeader(stream, header))
+	{
+		return false;
+	}
+
+	const uint32_t *blockOffsets = reinterpret_cast<const uint32_t*>(stream.data() + sizeof(MeshStreamHeader));
+
+	vertexData.assign((size_t)header.vertexCount * header.componentCount, 0.0f);
+	indexData.assign(header.indexCount, 0);
+
+	for (uint32_t block = 0; block < header.vertexBlockCount; block++)
+	{
+		size_t offset = header.payloadOffset + blockOffsets[block];
+
+		uint32_t previous[MESH_CODEC_MAX_COMPONENTS] = {};
+		uint32_t last = std::min((block + 1) * header.blockSize, header.vertexCount);
+
+		for (uint32_t v = block * header.blockSize; v < last; v++)
+		{
+			for (uint32_t c = 0; c < header.componentCount; c++)
+			{
+				uint32_t delta;
+				if (!readVarint(stream, offset, delta))
+				{
+					return false;
+				}
+
+				previous[c] = (uint32_t)((int32_t)previous[c] + unzigzag(delta));
+				vertexData[(size_t)v * header.componentCount + c] = header.componentMin[c] + previous[c] * header.componentScale[c];
+			}
+		}
+	}
+
+	for (uint32_t block = 0; block < header.indexBlockCount; block++)
+	{
+		size_t offset = header.payloadOffset + blockOffsets[header.vertexBlockCount + block];
+
+		uint32_t previous = 0;
+		uint32_t last = std::min((block + 1) * header.blockSize, header.indexCount);
+
+		for (uint32_t i = block * header.blockSize; i < last; i++)
+		{
+			uint32_t delta;
+			if (!readVarint(stream, offset, delta))
+			{
+				return false;
+			}
+
+			previous += (uint32_t)unzigzag(delta);
+			indexData[i] = previous;
+		}
+	}
+
+	return true;
+}
+
+bool MeshCodec::ReadHeader(const std::vector<uint8_t> &stream, MeshStreamHeader &header)
+{
+	if (stream.size() < sizeof(MeshStreamHeader))
+	{
+		return false;
+	}
+
+	memcpy(&header, stream.data(), sizeof(MeshStreamHeader));
+
+	if (header.magic != MESH_CODEC_MAGIC || header.version != MESH_CODEC_VERSION || header.componentCount > MESH_CODEC_MAX_COMPONENTS || header.blockSize == 0)
+	{
+		return false;
+	}
+
+	size_t tableSize = ((size_t)header.vertexBlockCount + header.indexBlockCount) * sizeof(uint32_t);
+	return header.payloadOffset == sizeof(MeshStreamHeader) + tableSize && header.payloadOffset <= stream.size();
+}
+
+uint32_t MeshCodec::quantise(float value, float minimum, float scale)
+{
+	if (scale <= 0.0f)
+	{
+		return 0;
+	}
+
+	float quantised = std::round((value - minimum) / scale);
+	return (uint32_t)std::min(std::max(quantised, 0.0f), 65535.0f);
+}
+
+void MeshCodec::writeVarint(std::vector<uint8_t> &bytes, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		bytes.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((uint8_t)value);
+}
+
+bool MeshCodec::readVarint(const std::vector<uint8_t> &bytes, size_t &offset, uint32_t &value)
+{
+	value = 0;
+
+	for (uint32_t shift = 0; shift < 35; shift += 7)
+	{
+		if (offset >= bytes.size())
+		{
+			return false;
+		}
+
+		uint8_t byte = bytes[offset++];
+		value |= (uint32_t)(byte & 0x7F) << shift;
+
+		if ((byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+//Elements per independently decodable block, the decode shader runs one invocation per block
+const uint32_t MESH_CODEC_BLOCK_SIZE = 256;
+const uint32_t MESH_CODEC_MAX_COMPONENTS = 16;
+const uint32_t MESH_CODEC_MAGIC = 0x4348534D; //"MSHC"
+const uint32_t MESH_CODEC_VERSION = 1;
+
+//Start of an encoded mesh stream, followed by the vertex then index block offset tables and the payload. The decode
+//shader reads this layout directly, keep it in step with meshdecode.comp
+struct MeshStreamHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t componentCount; //Floats per vertex
+	uint32_t blockSize;
+	uint32_t vertexBlockCount;
+	uint32_t indexBlockCount;
+	uint32_t payloadOffset; //Bytes from the start of the stream, block offsets are relative to it
+	float componentMin[MESH_CODEC_MAX_COMPONENTS];
+	float componentScale[MESH_CODEC_MAX_COMPONENTS]; //Decoded value is min + quantised * scale
+};
+
+static_assert(sizeof(MeshStreamHeader) == (9 + 2 * MESH_CODEC_MAX_COMPONENTS) * sizeof(uint32_t), "MeshStreamHeader must match the shader layout");
+
+//Compact mesh encoding decoded on the GPU, with the CPU decoder kept as the reference. Indices are delta coded against
+//the previous index of their block and zigzag varint packed. Vertex components are quantised to 16 bits over their
+//range, delta coded against the previous vertex of the block and packed the same way. Deltas restart every block
+class MeshCodec
+{
+public:
+	static std::vector<uint8_t> Encode(const float *vertexData, uint32_t vertexCount, uint32_t componentCount, const uint32_t *indexData, uint32_t indexCount);
+
+	//Returns false if the stream is malformed
+	static bool Decode(const std::vector<uint8_t> &stream, std::vector<float> &vertexData, std::vector<uint32_t> &indexData);
+
+	static bool ReadHeader(const std::vector<uint8_t> &stream, MeshStreamHeader &header);
+
+	//Blocks in the stream, one decode invocation each
+	static uint32_t GetBlockCount(const MeshStreamHeader &header) { return header.vertexBlockCount + header.indexBlockCount; }
+
+private:
+	static uint32_t quantise(float value, float minimum, float scale);
+	static void writeVarint(std::vector<uint8_t> &bytes, uint32_t value);
+	static bool readVarint(const std::vector<uint8_t> &bytes, size_t &offset, uint32_t &value);
+	static uint32_t zigzag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+	static int32_t unzigzag(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+};
@@ -0,0 +1,247 @@
+#include "MeshDecoder.h"
+
+bool MeshDecoder::Initialise(VkDevice device, const std::string &shaderPath, bool timestamps, double timestampPeriod)
+{
+	logicalDevice = device;
+	this->timestampPeriod = timestampPeriod;
+
+	//The shader is built separately from meshdecode.comp, a missing binary only disables the GPU path
+	std::ifstream shaderFile(shaderPath, std::ios::ate | std::ios::binary);
+	if (!shaderFile.is_open() || shaderFile.tellg() <= 0)
+	{
+		std::cout << "Mesh decode shader " << shaderPath << " not found, meshes are decoded on the CPU.\n";
+		return false;
+	}
+
+	std::vector<char> shaderCode((size_t)shaderFile.tellg());
+	shaderFile.seekg(0);
+	shaderFile.read(shaderCode.data(), shaderCode.size());
+	shaderFile.close();
+
+	VkShaderModuleCreateInfo module_info = {};
+	module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	module_info.pNext = nullptr;
+	module_info.flags = 0;
+	module_info.codeSize = shaderCode.size();
+	module_info.pCode = (uint32_t *)shaderCode.data();
+
+	VkResult result = vkCreateShaderModule(logicalDevice, &module_info, nullptr, &shaderModule);
+	if (result != VK_SUCCESS)
+	{
+		std::cout << "Mesh decode shader module could not be created, meshes are decoded on the CPU.\n";
+		return false;
+	}
+
+	//Encoded stream, decoded vertices, decoded indices
+	VkDescriptorSetLayoutBinding bindings[3] = {};
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[i].pImmutableSamplers = nullptr;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layout_info = {};
+	layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_info.pNext = nullptr;
+	layout_info.flags = 0;
+	layout_info.bindingCount = 3;
+	layout_info.pBindings = bindings;
+
+	vkCreateDescriptorSetLayout(logicalDevice, &layout_info, nullptr, &descriptorSetLayout);
+
+	VkDescriptorPoolSize pool_size = {};
+	pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	pool_size.descriptorCount = 3 * MESH_DECODER_SLOTS;
+
+	VkDescriptorPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_info.pNext = nullptr;
+	pool_info.flags = 0;
+	pool_info.maxSets = MESH_DECODER_SLOTS;
+	pool_info.poolSizeCount = 1;
+	pool_info.pPoolSizes = &pool_size;
+
+	vkCreateDescriptorPool(logicalDevice, &pool_info, nullptr, &descriptorPool);
+
+	//One set per slot allocated up front, a slot's set is rewritten each time it is recorded
+	VkDescriptorSetLayout setLayouts[MESH_DECODER_SLOTS];
+	for (uint32_t i = 0; i < MESH_DECODER_SLOTS; i++)
+	{
+		setLayouts[i] = descriptorSetLayout;
+	}
+
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.pNext = nullptr;
+	allocate_info.descriptorPool = descriptorPool;
+	allocate_info.descriptorSetCount = MESH_DECODER_SLOTS;
+	allocate_info.pSetLayouts = setLayouts;
+
+	vkAllocateDescriptorSets(logicalDevice, &allocate_info, descriptorSets);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+	pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_info.pNext = nullptr;
+	pipeline_layout_info.flags = 0;
+	pipeline_layout_info.setLayoutCount = 1;
+	pipeline_layout_info.pSetLayouts = &descriptorSetLayout;
+	pipeline_layout_info.pushConstantRangeCount = 0;
+	pipeline_layout_info.pPushConstantRanges = nullptr;
+
+	vkCreatePipelineLayout(logicalDevice, &pipeline_layout_info, nullptr, &pipelineLayout);
+
+	VkPipelineShaderStageCreateInfo stage_info = {};
+	stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stage_info.pNext = nullptr;
+	stage_info.flags = 0;
+	stage_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	stage_info.module = shaderModule;
+	stage_info.pName = "main";
+	stage_info.pSpecializationInfo = nullptr;
+
+	VkComputePipelineCreateInfo pipeline_info = {};
+	pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipeline_info.pNext = nullptr;
+	pipeline_info.flags = 0;
+	pipeline_info.stage = stage_info;
+	pipeline_info.layout = pipelineLayout;
+	pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+	pipeline_info.basePipelineIndex = -1;
+
+	result = vkCreateComputePipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline);
+	if (result == VK_SUCCESS)
+	{
+		std::cout << "Mesh decode pipeline created successfully.\n";
+	}
+	else
+	{
+		pipeline = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (timestamps)
+	{
+		VkQueryPoolCreateInfo query_pool_info = {};
+		query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		query_pool_info.pNext = nullptr;
+		query_pool_info.flags = 0;
+		query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		query_pool_info.queryCount = MESH_DECODER_SLOTS * 2;
+		query_pool_info.pipelineStatistics = 0;
+
+		vkCreateQueryPool(logicalDevice, &query_pool_info, nullptr, &timestampQueryPool);
+	}
+
+	return true;
+}
+
+uint32_t MeshDecoder::AcquireSlot()
+{
+	if (!IsAvailable())
+	{
+		return UINT32_MAX;
+	}
+
+	for (uint32_t i = 0; i < MESH_DECODER_SLOTS; i++)
+	{
+		if (!slotInUse[i])
+		{
+			slotInUse[i] = true;
+			return i;
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+void MeshDecoder::Record(VkCommandBuffer commandBuffer, uint32_t slot, VkBuffer encodedBuffer, VkBuffer vertexBuffer, VkBuffer indexBuffer, uint32_t blockCount)
+{
+	VkDescriptorBufferInfo buffer_infos[3] = {};
+	buffer_infos[0].buffer = encodedBuffer;
+	buffer_infos[1].buffer = vertexBuffer;
+	buffer_infos[2].buffer = indexBuffer;
+
+	VkWriteDescriptorSet descriptor_writes[3] = {};
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		buffer_infos[i].offset = 0;
+		buffer_infos[i].range = VK_WHOLE_SIZE;
+
+		descriptor_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptor_writes[i].pNext = nullptr;
+		descriptor_writes[i].dstSet = descriptorSets[slot];
+		descriptor_writes[i].dstBinding = i;
+		descriptor_writes[i].dstArrayElement = 0;
+		descriptor_writes[i].descriptorCount = 1;
+		descriptor_writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptor_writes[i].pBufferInfo = &buffer_infos[i];
+	}
+
+	vkUpdateDescriptorSets(logicalDevice, 3, descriptor_writes, 0, nullptr);
+
+	if (timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(commandBuffer, timestampQueryPool, slot * 2, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, slot * 2);
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[slot], 0, nullptr);
+	vkCmdDispatch(commandBuffer, (blockCount + MESH_DECODER_GROUP_SIZE - 1) / MESH_DECODER_GROUP_SIZE, 1, 1);
+
+	if (timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool, slot * 2 + 1);
+	}
+
+	//Decoded vertices and indices are read by every later draw on this queue
+	VkMemoryBarrier memory_barrier = {};
+	memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memory_barrier.pNext = nullptr;
+	memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+}
+
+void MeshDecoder::ReleaseSlot(uint32_t slot, double &gpuMilliseconds)
+{
+	gpuMilliseconds = -1.0;
+
+	if (slot >= MESH_DECODER_SLOTS)
+	{
+		return;
+	}
+
+	if (timestampQueryPool != VK_NULL_HANDLE)
+	{
+		uint64_t timestamps[2];
+		VkResult result = vkGetQueryPoolResults(logicalDevice, timestampQueryPool, slot * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result == VK_SUCCESS)
+		{
+			gpuMilliseconds = (timestamps[1] - timestamps[0]) * timestampPeriod / 1000000.0;
+		}
+	}
+
+	slotInUse[slot] = false;
+}
+
+void MeshDecoder::Release()
+{
+	vkDestroyQueryPool(logicalDevice, timestampQueryPool, nullptr);
+	vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+	vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+	vkDestroyShaderModule(logicalDevice, shaderModule, nullptr);
+
+	timestampQueryPool = VK_NULL_HANDLE;
+	pipeline = VK_NULL_HANDLE;
+	pipelineLayout = VK_NULL_HANDLE;
+	descriptorPool = VK_NULL_HANDLE;
+	descriptorSetLayout = VK_NULL_HANDLE;
+	shaderModule = VK_NULL_HANDLE;
+}
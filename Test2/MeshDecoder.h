@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "MeshCodec.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+
+//Decodes that can be recorded or in flight at once, each slot owns a descriptor set and a timestamp pair
+const uint32_t MESH_DECODER_SLOTS = 8;
+
+//Invocations per workgroup, must match local_size_x in meshdecode.comp
+const uint32_t MESH_DECODER_GROUP_SIZE = 64;
+
+//Expands meshes uploaded in the MeshCodec encoding into vertex and index buffers with a compute dispatch on the
+//graphics queue, so only the encoded bytes cross the bus
+class MeshDecoder
+{
+public:
+	//Returns false if the decode shader could not be loaded, meshes are then decoded with MeshCodec on the CPU
+	bool Initialise(VkDevice device, const std::string &shaderPath, bool timestamps, double timestampPeriod);
+
+	//Returns a free slot or UINT32_MAX if every slot is in flight
+	uint32_t AcquireSlot();
+
+	//Decode encodedBuffer into the vertex and index buffers, which must have storage usage, and make the results
+	//visible to vertex input. The encoded buffer must already be readable by compute on this queue
+	void Record(VkCommandBuffer commandBuffer, uint32_t slot, VkBuffer encodedBuffer, VkBuffer vertexBuffer, VkBuffer indexBuffer, uint32_t blockCount);
+
+	//Return a slot once the command buffer it was recorded into has completed, gpuMilliseconds is negative when the
+	//decode was not timed
+	void ReleaseSlot(uint32_t slot, double &gpuMilliseconds);
+
+	void Release();
+
+	bool IsAvailable() const { return pipeline != VK_NULL_HANDLE; }
+
+private:
+	VkDevice logicalDevice = VK_NULL_HANDLE;
+	double timestampPeriod = 1.0;
+
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+
+	VkDescriptorSet descriptorSets[MESH_DECODER_SLOTS] = {};
+	bool slotInUse[MESH_DECODER_SLOTS] = {};
+};
@@ -0,0 +1,711 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+namespace
+{
+	const VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	//Stage masks may not be empty, nothing to wait on is the top of the pipe
+	VkPipelineStageFlags nonEmpty(VkPipelineStageFlags stages)
+	{
+		return stages ? stages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+}
+
+void RenderGraph::Initialise(VkDevice device)
+{
+	logicalDevice = device;
+}
+
+void RenderGraph::Release()
+{
+	for (Pass &pass : passes)
+	{
+		for (VkFramebuffer framebuffer : pass.framebuffers)
+		{
+			vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+		}
+
+		if (pass.renderPass != VK_NULL_HANDLE)
+		{
+			vkDestroyRenderPass(logicalDevice, pass.renderPass, nullptr);
+		}
+	}
+
+	images.clear();
+	passes.clear();
+	executionOrder.clear();
+	finalBarriers.clear();
+	finalSourceStages = 0;
+	finalDestinationStages = 0;
+	variantCount = 1;
+	dependencyCount = 0;
+}
+
+uint32_t RenderGraph::CreateImage(const char *name, VkFormat format, VkSampleCountFlagBits samples)
+{
+	Image image = {};
+	image.name = name;
+	image.format = format;
+	image.samples = samples;
+	image.imported = false;
+	image.target = UINT32_MAX;
+
+	images.push_back(image);
+
+	return (uint32_t)images.size() - 1;
+}
+
+uint32_t RenderGraph::ImportImage(const char *name, VkFormat format, VkSampleCountFlagBits samples, RenderGraphState before, RenderGraphState after)
+{
+	uint32_t handle = CreateImage(name, format, samples);
+	images[handle].imported = true;
+	images[handle].before = before;
+	images[handle].after = after;
+
+	return handle;
+}
+
+uint32_t RenderGraph::AddPass(const char *name, bool sideEffects)
+{
+	Pass pass = {};
+	pass.name = name;
+	pass.sideEffects = sideEffects;
+	pass.culled = false;
+	pass.renderPass = VK_NULL_HANDLE;
+	pass.contents = VK_SUBPASS_CONTENTS_INLINE;
+
+	passes.push_back(pass);
+
+	return (uint32_t)passes.size() - 1;
+}
+
+void RenderGraph::Use(uint32_t pass, uint32_t image, RenderGraphUsage usage)
+{
+	ImageUse use = {};
+	use.image = image;
+	use.usage = usage;
+	use.clear = false;
+
+	passes[pass].uses.push_back(use);
+}
+
+void RenderGraph::Clear(uint32_t pass, uint32_t image, RenderGraphUsage usage, VkClearValue clearValue)
+{
+	Use(pass, image, usage);
+	passes[pass].uses.back().clear = true;
+	passes[pass].uses.back().clearValue = clearValue;
+}
+
+void RenderGraph::Compile()
+{
+	cull();
+	placeImages();
+	synchronise();
+}
+
+void RenderGraph::RequestTargets(RenderTargetPool &pool, VkExtent2D extent)
+{
+	for (Image &image : images)
+	{
+		if (image.imported || image.firstPass == UINT32_MAX)
+		{
+			continue;
+		}
+
+		image.target = pool.RequestTarget(extent.width, extent.height, image.format, image.usage, formatAspect(image.format), image.samples, image.firstPass, image.lastPass);
+	}
+}
+
+void RenderGraph::SetImportedImages(uint32_t image, const std::vector<VkImage> &handles, const std::vector<VkImageView> &views)
+{
+	images[image].physicalImages = handles;
+	images[image].physicalViews = views;
+}
+
+void RenderGraph::CreateFramebuffers(const RenderTargetPool &pool, VkExtent2D extent)
+{
+	framebufferExtent = extent;
+	variantCount = 1;
+
+	for (Image &image : images)
+	{
+		if (!image.imported && image.target != UINT32_MAX)
+		{
+			image.physicalImages.assign(1, pool.GetImage(image.target));
+			image.physicalViews.assign(1, pool.GetImageView(image.target));
+		}
+
+		if (image.firstPass != UINT32_MAX)
+		{
+			variantCount = std::max(variantCount, (uint32_t)image.physicalViews.size());
+		}
+	}
+
+	for (uint32_t passIndex : executionOrder)
+	{
+		Pass &pass = passes[passIndex];
+		if (pass.renderPass == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		pass.framebuffers.resize(variantCount);
+		for (uint32_t variant = 0; variant < variantCount; variant++)
+		{
+			std::vector<VkImageView> attachmentViews;
+			for (uint32_t image : pass.attachments)
+			{
+				attachmentViews.push_back(getView(image, variant));
+			}
+
+			VkFramebufferCreateInfo framebuffer_info = {};
+			framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebuffer_info.pNext = nullptr;
+			framebuffer_info.flags = 0;
+			framebuffer_info.renderPass = pass.renderPass;
+			framebuffer_info.attachmentCount = (uint32_t)attachmentViews.size();
+			framebuffer_info.pAttachments = attachmentViews.data();
+			framebuffer_info.width = extent.width;
+			framebuffer_info.height = extent.height;
+			framebuffer_info.layers = 1;
+
+			VkResult result = vkCreateFramebuffer(logicalDevice, &framebuffer_info, nullptr, &pass.framebuffers[variant]);
+			if (result == VK_SUCCESS)
+			{
+				std::cout << pass.name << " framebuffer " << variant << " created successfully.\n";
+			}
+		}
+	}
+}
+
+std::vector<VkFramebuffer> RenderGraph::TakeFramebuffers()
+{
+	std::vector<VkFramebuffer> taken;
+
+	for (Pass &pass : passes)
+	{
+		taken.insert(taken.end(), pass.framebuffers.begin(), pass.framebuffers.end());
+		pass.framebuffers.clear();
+	}
+
+	return taken;
+}
+
+void RenderGraph::SetRecorder(uint32_t pass, VkSubpassContents contents, PassRecorder recorder)
+{
+	passes[pass].contents = contents;
+	passes[pass].recorder = std::move(recorder);
+}
+
+void RenderGraph::Execute(VkCommandBuffer commandBuffer, uint32_t variant)
+{
+	for (uint32_t passIndex : executionOrder)
+	{
+		Pass &pass = passes[passIndex];
+
+		issueBarriers(commandBuffer, pass.barriers, pass.barrierSourceStages, pass.barrierDestinationStages, variant);
+
+		if (pass.renderPass == VK_NULL_HANDLE)
+		{
+			if (pass.recorder)
+			{
+				pass.recorder(commandBuffer);
+			}
+			continue;
+		}
+
+		VkRenderPassBeginInfo renderPass_begin_info = {};
+		renderPass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPass_begin_info.pNext = nullptr;
+		renderPass_begin_info.renderPass = pass.renderPass;
+		renderPass_begin_info.framebuffer = pass.framebuffers[variant % pass.framebuffers.size()];
+		renderPass_begin_info.renderArea.offset = { 0, 0 };
+		renderPass_begin_info.renderArea.extent = framebufferExtent;
+		renderPass_begin_info.clearValueCount = (uint32_t)pass.clearValues.size();
+		renderPass_begin_info.pClearValues = pass.clearValues.data();
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPass_begin_info, pass.contents);
+
+		if (pass.recorder)
+		{
+			pass.recorder(commandBuffer);
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	issueBarriers(commandBuffer, finalBarriers, finalSourceStages, finalDestinationStages, variant);
+
+	executeCount++;
+}
+
+void RenderGraph::ReportMetrics()
+{
+	if (executeCount == 0)
+	{
+		return;
+	}
+
+	uint32_t transientCount = 0;
+	for (const Image &image : images)
+	{
+		if (!image.imported && image.target != UINT32_MAX)
+		{
+			transientCount++;
+		}
+	}
+
+	std::cout << "Render graph: " << executionOrder.size() << " passes run, " << passes.size() - executionOrder.size() << " culled, ";
+	std::cout << transientCount << " transient images, " << dependencyCount << " subpass dependencies, ";
+	std::cout << (double)barrierCount / executeCount << " image barriers in " << (double)barrierCallCount / executeCount << " calls per recorded frame.\n";
+}
+
+void RenderGraph::cull()
+{
+	//Walked backwards from the outputs, a pass is kept if it writes something a later kept pass or the frame needs
+	std::vector<bool> needed(images.size(), false);
+	for (uint32_t i = 0; i < images.size(); i++)
+	{
+		needed[i] = images[i].imported && images[i].after.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+
+	for (uint32_t p = (uint32_t)passes.size(); p-- > 0;)
+	{
+		Pass &pass = passes[p];
+
+		bool keep = pass.sideEffects;
+		for (const ImageUse &use : pass.uses)
+		{
+			keep = keep || (isWrite(use.usage) && needed[use.image]);
+		}
+
+		pass.culled = !keep;
+		if (pass.culled)
+		{
+			continue;
+		}
+
+		for (ImageUse &use : pass.uses)
+		{
+			use.contentsNeeded = needed[use.image];
+		}
+
+		//Earlier contents are needed unless the pass replaces all of them. A cleared attachment or a resolve does, a
+		//copy may only cover part of the image
+		for (const ImageUse &use : pass.uses)
+		{
+			needed[use.image] = !(use.clear || use.usage == GRAPH_RESOLVE_ATTACHMENT);
+		}
+	}
+
+	executionOrder.clear();
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		if (!passes[p].culled)
+		{
+			executionOrder.push_back(p);
+		}
+	}
+}
+
+void RenderGraph::placeImages()
+{
+	for (Image &image : images)
+	{
+		image.usage = 0;
+		image.firstPass = UINT32_MAX;
+		image.lastPass = 0;
+	}
+
+	std::vector<bool> attachmentOnly(images.size(), true);
+
+	for (uint32_t position = 0; position < executionOrder.size(); position++)
+	{
+		for (const ImageUse &use : passes[executionOrder[position]].uses)
+		{
+			Image &image = images[use.image];
+			image.firstPass = std::min(image.firstPass, position);
+			image.lastPass = position;
+			attachmentOnly[use.image] = attachmentOnly[use.image] && isAttachment(use.usage);
+
+			switch (use.usage)
+			{
+			case GRAPH_COLOUR_ATTACHMENT:
+			case GRAPH_RESOLVE_ATTACHMENT:
+				image.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+				break;
+			case GRAPH_DEPTH_ATTACHMENT:
+				image.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+				break;
+			case GRAPH_SAMPLED:
+				image.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+				break;
+			case GRAPH_TRANSFER_SOURCE:
+				image.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+				break;
+			case GRAPH_TRANSFER_DESTINATION:
+				image.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+				break;
+			}
+		}
+	}
+
+	//Contents that never leave a single render pass are neither loaded nor stored, so the memory can be lazily allocated
+	for (uint32_t i = 0; i < images.size(); i++)
+	{
+		if (!images[i].imported && images[i].firstPass != UINT32_MAX && images[i].firstPass == images[i].lastPass && attachmentOnly[i])
+		{
+			images[i].usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+	}
+}
+
+void RenderGraph::synchronise()
+{
+	//Transient images may share memory with each other and are reused by the next frame, so the first use of any of them
+	//waits on every stage transient images are used in
+	VkPipelineStageFlags transientStages = 0;
+	VkAccessFlags transientWrites = 0;
+	for (uint32_t passIndex : executionOrder)
+	{
+		for (const ImageUse &use : passes[passIndex].uses)
+		{
+			if (!images[use.image].imported)
+			{
+				RenderGraphState state = usageState(use.usage);
+				transientStages |= state.stages;
+				transientWrites |= state.access & WRITE_ACCESS;
+			}
+		}
+	}
+
+	std::vector<Tracked> tracked(images.size());
+	for (uint32_t i = 0; i < images.size(); i++)
+	{
+		const Image &image = images[i];
+		Tracked &state = tracked[i];
+
+		state.layout = image.imported ? image.before.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+		state.writeStages = image.imported ? image.before.stages : transientStages;
+		state.writeAccess = image.imported ? image.before.access : transientWrites;
+		state.readStages = 0;
+		state.visibleStages = 0;
+		state.contentsValid = state.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+
+	dependencyCount = 0;
+
+	for (uint32_t position = 0; position < executionOrder.size(); position++)
+	{
+		Pass &pass = passes[executionOrder[position]];
+		pass.barriers.clear();
+		pass.barrierSourceStages = 0;
+		pass.barrierDestinationStages = 0;
+
+		bool hasAttachments = false;
+		for (const ImageUse &use : pass.uses)
+		{
+			if (isAttachment(use.usage))
+			{
+				hasAttachments = true;
+				continue;
+			}
+
+			RenderGraphState state = usageState(use.usage);
+			Tracked &from = tracked[use.image];
+			bool write = isWrite(use.usage);
+
+			//Reads already made visible in the same layout need nothing more
+			if (from.layout != state.layout || (from.writeStages && (write || (state.stages & ~from.visibleStages))) || (write && from.readStages))
+			{
+				addBarrier(pass.barriers, pass.barrierSourceStages, pass.barrierDestinationStages, use.image, from, state, write);
+			}
+
+			if (write)
+			{
+				from.writeStages = state.stages;
+				from.writeAccess = state.access & WRITE_ACCESS;
+				from.readStages = 0;
+				from.visibleStages = 0;
+				from.contentsValid = true;
+			}
+			else
+			{
+				from.readStages |= state.stages;
+				from.visibleStages |= state.stages;
+			}
+			from.layout = state.layout;
+		}
+
+		if (hasAttachments)
+		{
+			createRenderPass(pass, position, tracked);
+		}
+	}
+
+	//Imported images last used outside a render pass are returned to where their owner expects them
+	finalBarriers.clear();
+	finalSourceStages = 0;
+	finalDestinationStages = 0;
+	for (uint32_t i = 0; i < images.size(); i++)
+	{
+		const Image &image = images[i];
+		if (!image.imported || image.after.layout == VK_IMAGE_LAYOUT_UNDEFINED || image.firstPass == UINT32_MAX)
+		{
+			continue;
+		}
+
+		if (tracked[i].layout != image.after.layout || tracked[i].writeStages)
+		{
+			addBarrier(finalBarriers, finalSourceStages, finalDestinationStages, i, tracked[i], image.after, false);
+		}
+	}
+}
+
+void RenderGraph::createRenderPass(Pass &pass, uint32_t position, std::vector<Tracked> &tracked)
+{
+	std::vector<VkAttachmentDescription> attachments;
+	std::vector<VkAttachmentReference> colourReferences;
+	std::vector<VkAttachmentReference> resolveReferences;
+	VkAttachmentReference depthReference = { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED };
+
+	VkSubpassDependency entry_dependency = {};
+	entry_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	entry_dependency.dstSubpass = 0;
+
+	VkSubpassDependency exit_dependency = {};
+	exit_dependency.srcSubpass = 0;
+	exit_dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+
+	pass.attachments.clear();
+	pass.clearValues.clear();
+
+	for (const ImageUse &use : pass.uses)
+	{
+		if (!isAttachment(use.usage))
+		{
+			continue;
+		}
+
+		const Image &image = images[use.image];
+		RenderGraphState state = usageState(use.usage);
+		Tracked &from = tracked[use.image];
+
+		VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		if (use.clear)
+		{
+			loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		}
+		else if (use.usage != GRAPH_RESOLVE_ATTACHMENT && from.contentsValid)
+		{
+			loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		}
+
+		//The last use of an output leaves it in the layout its owner expects
+		bool exported = image.imported && image.after.layout != VK_IMAGE_LAYOUT_UNDEFINED && image.lastPass == position;
+
+		VkAttachmentDescription attachment = {};
+		attachment.flags = 0;
+		attachment.format = image.format;
+		attachment.samples = image.samples;
+		attachment.loadOp = loadOp;
+		attachment.storeOp = use.contentsNeeded ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.initialLayout = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? from.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+		attachment.finalLayout = exported ? image.after.layout : state.layout;
+
+		VkAttachmentReference reference = {};
+		reference.attachment = (uint32_t)attachments.size();
+		reference.layout = state.layout;
+
+		switch (use.usage)
+		{
+		case GRAPH_COLOUR_ATTACHMENT:
+			colourReferences.push_back(reference);
+			break;
+		case GRAPH_RESOLVE_ATTACHMENT:
+			resolveReferences.push_back(reference);
+			break;
+		default:
+			depthReference = reference;
+			break;
+		}
+
+		//Everything since the previous write, and any reads of it, must finish before the pass touches the attachment
+		entry_dependency.srcStageMask |= from.writeStages | from.readStages;
+		entry_dependency.srcAccessMask |= from.writeAccess;
+		entry_dependency.dstStageMask |= state.stages;
+		entry_dependency.dstAccessMask |= state.access;
+
+		if (exported)
+		{
+			exit_dependency.srcStageMask |= state.stages;
+			exit_dependency.srcAccessMask |= state.access & WRITE_ACCESS;
+			exit_dependency.dstStageMask |= image.after.stages;
+			exit_dependency.dstAccessMask |= image.after.access;
+		}
+
+		attachments.push_back(attachment);
+		pass.attachments.push_back(use.image);
+		pass.clearValues.push_back(use.clear ? use.clearValue : VkClearValue{});
+
+		//An exported image is handed over by the exit dependency, nothing after the pass needs to wait on it again
+		from.layout = attachment.finalLayout;
+		from.writeStages = exported ? 0 : state.stages;
+		from.writeAccess = exported ? 0 : state.access & WRITE_ACCESS;
+		from.readStages = 0;
+		from.visibleStages = 0;
+		from.contentsValid = attachment.storeOp == VK_ATTACHMENT_STORE_OP_STORE;
+	}
+
+	VkSubpassDescription subpass = {};
+	subpass.flags = 0;
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.inputAttachmentCount = 0;
+	subpass.pInputAttachments = nullptr;
+	subpass.colorAttachmentCount = (uint32_t)colourReferences.size();
+	subpass.pColorAttachments = colourReferences.data();
+	subpass.pResolveAttachments = resolveReferences.empty() ? nullptr : resolveReferences.data();
+	subpass.pDepthStencilAttachment = depthReference.attachment != VK_ATTACHMENT_UNUSED ? &depthReference : nullptr;
+	subpass.preserveAttachmentCount = 0;
+	subpass.pPreserveAttachments = nullptr;
+
+	entry_dependency.srcStageMask = nonEmpty(entry_dependency.srcStageMask);
+
+	std::vector<VkSubpassDependency> dependencies = { entry_dependency };
+	if (exit_dependency.srcStageMask)
+	{
+		exit_dependency.dstStageMask = nonEmpty(exit_dependency.dstStageMask);
+		dependencies.push_back(exit_dependency);
+	}
+	dependencyCount += (uint32_t)dependencies.size();
+
+	VkRenderPassCreateInfo renderPass_info = {};
+	renderPass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPass_info.pNext = nullptr;
+	renderPass_info.flags = 0;
+	renderPass_info.attachmentCount = (uint32_t)attachments.size();
+	renderPass_info.pAttachments = attachments.data();
+	renderPass_info.subpassCount = 1;
+	renderPass_info.pSubpasses = &subpass;
+	renderPass_info.dependencyCount = (uint32_t)dependencies.size();
+	renderPass_info.pDependencies = dependencies.data();
+
+	VkResult result = vkCreateRenderPass(logicalDevice, &renderPass_info, nullptr, &pass.renderPass);
+	if (result == VK_SUCCESS)
+	{
+		std::cout << pass.name << " Render Pass created successfully.\n";
+	}
+}
+
+void RenderGraph::addBarrier(std::vector<PassBarrier> &barriers, VkPipelineStageFlags &sourceStages, VkPipelineStageFlags &destinationStages, uint32_t image, const Tracked &from, RenderGraphState to, bool write)
+{
+	PassBarrier passBarrier = {};
+	passBarrier.image = image;
+
+	VkImageMemoryBarrier &barrier = passBarrier.barrier;
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.pNext = nullptr;
+	barrier.srcAccessMask = from.writeAccess;
+	barrier.dstAccessMask = to.access;
+	barrier.oldLayout = from.contentsValid ? from.layout : VK_IMAGE_LAYOUT_UNDEFINED; //Nothing worth keeping, let the driver discard it
+	barrier.newLayout = to.layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = VK_NULL_HANDLE;
+	barrier.subresourceRange.aspectMask = formatAspect(images[image].format);
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	//A layout change is a write, so like any write it waits on the reads before it
+	bool layoutChange = from.layout != to.layout;
+	sourceStages |= from.writeStages | (write || layoutChange ? from.readStages : 0);
+	destinationStages |= to.stages;
+
+	barriers.push_back(passBarrier);
+}
+
+void RenderGraph::issueBarriers(VkCommandBuffer commandBuffer, const std::vector<PassBarrier> &barriers, VkPipelineStageFlags sourceStages, VkPipelineStageFlags destinationStages, uint32_t variant)
+{
+	if (barriers.empty())
+	{
+		return;
+	}
+
+	barrierScratch.clear();
+	for (const PassBarrier &passBarrier : barriers)
+	{
+		barrierScratch.push_back(passBarrier.barrier);
+		barrierScratch.back().image = getImage(passBarrier.image, variant);
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, nonEmpty(sourceStages), nonEmpty(destinationStages), 0, 0, nullptr, 0, nullptr, (uint32_t)barrierScratch.size(), barrierScratch.data());
+
+	barrierCallCount++;
+	barrierCount += barrierScratch.size();
+}
+
+VkImage RenderGraph::getImage(uint32_t image, uint32_t variant) const
+{
+	const std::vector<VkImage> &handles = images[image].physicalImages;
+
+	return handles[variant % handles.size()];
+}
+
+VkImageView RenderGraph::getView(uint32_t image, uint32_t variant) const
+{
+	const std::vector<VkImageView> &views = images[image].physicalViews;
+
+	return views[variant % views.size()];
+}
+
+bool RenderGraph::isWrite(RenderGraphUsage usage)
+{
+	return (usageState(usage).access & WRITE_ACCESS) != 0;
+}
+
+bool RenderGraph::isAttachment(RenderGraphUsage usage)
+{
+	return usage == GRAPH_COLOUR_ATTACHMENT || usage == GRAPH_DEPTH_ATTACHMENT || usage == GRAPH_RESOLVE_ATTACHMENT;
+}
+
+RenderGraphState RenderGraph::usageState(RenderGraphUsage usage)
+{
+	switch (usage)
+	{
+	case GRAPH_COLOUR_ATTACHMENT:
+		return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+	case GRAPH_DEPTH_ATTACHMENT:
+		return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+	case GRAPH_RESOLVE_ATTACHMENT:
+		return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+	case GRAPH_SAMPLED:
+		return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+	case GRAPH_TRANSFER_SOURCE:
+		return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+	default:
+		return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT };
+	}
+}
+
+VkImageAspectFlags RenderGraph::formatAspect(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
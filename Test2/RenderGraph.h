@@ -0,0 +1,176 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "RenderTargetPool.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <functional>
+
+//How a pass uses an image. Each implies the layout, pipeline stages and access the graph synchronises against
+enum RenderGraphUsage
+{
+	GRAPH_COLOUR_ATTACHMENT,
+	GRAPH_DEPTH_ATTACHMENT,
+	GRAPH_RESOLVE_ATTACHMENT, //Resolves the pass's colour attachment declared in the same order
+	GRAPH_SAMPLED, //Read by fragment shaders
+	GRAPH_TRANSFER_SOURCE,
+	GRAPH_TRANSFER_DESTINATION
+};
+
+//Where an imported image is before the frame's first use and must be left after its last
+struct RenderGraphState
+{
+	VkImageLayout layout;
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+};
+
+//Passes declare the images they read and write by handle and the graph works out the rest. Passes contributing nothing
+//to an imported image are culled, load and store ops and layouts follow from the uses before and after, every
+//attachment pass gets a render pass with its dependencies, and the barriers other uses need are merged into one call
+//per pass. Images created by the graph are transient, requested from the render target pool with the span of passes
+//they live for so images whose spans do not overlap share memory
+class RenderGraph
+{
+public:
+	typedef std::function<void(VkCommandBuffer commandBuffer)> PassRecorder;
+
+	void Initialise(VkDevice device);
+
+	//Destroys the render passes and framebuffers and forgets every pass and image, ready to declare the graph again
+	void Release();
+
+	uint32_t CreateImage(const char *name, VkFormat format, VkSampleCountFlagBits samples);
+
+	//An image owned elsewhere, such as the swapchain's. Its contents are kept from before the frame unless the initial
+	//layout is undefined, and it is counted as an output unless the final layout is
+	uint32_t ImportImage(const char *name, VkFormat format, VkSampleCountFlagBits samples, RenderGraphState before, RenderGraphState after);
+
+	//Passes run in the order they are added. One with side effects is never culled
+	uint32_t AddPass(const char *name, bool sideEffects = false);
+	void Use(uint32_t pass, uint32_t image, RenderGraphUsage usage);
+	void Clear(uint32_t pass, uint32_t image, RenderGraphUsage usage, VkClearValue clearValue); //Attachment cleared as the pass begins
+
+	//Cull, place and synchronise the declared passes and create their render passes
+	void Compile();
+
+	//Request every transient image used by a pass that survived culling
+	void RequestTargets(RenderTargetPool &pool, VkExtent2D extent);
+
+	//One image and view per variant, a framebuffer is created for each. Set before CreateFramebuffers
+	void SetImportedImages(uint32_t image, const std::vector<VkImage> &images, const std::vector<VkImageView> &views);
+
+	//Framebuffers of every attachment pass for each variant of the imported images, once the pool has allocated
+	void CreateFramebuffers(const RenderTargetPool &pool, VkExtent2D extent);
+
+	//Hand over the current framebuffers to be destroyed once the frames using them complete
+	std::vector<VkFramebuffer> TakeFramebuffers();
+
+	//Set each frame, the recorder is called between the pass's barriers and the end of its render pass
+	void SetRecorder(uint32_t pass, VkSubpassContents contents, PassRecorder recorder);
+
+	//Record every pass that survived culling, drawing to the given variant of the imported images
+	void Execute(VkCommandBuffer commandBuffer, uint32_t variant);
+
+	VkRenderPass GetRenderPass(uint32_t pass) const { return passes[pass].renderPass; }
+	VkFramebuffer GetFramebuffer(uint32_t pass, uint32_t variant) const { return passes[pass].framebuffers[variant]; }
+	bool IsCulled(uint32_t pass) const { return passes[pass].culled; }
+
+	void ReportMetrics();
+
+private:
+	struct Image
+	{
+		std::string name;
+		VkFormat format;
+		VkSampleCountFlagBits samples;
+		bool imported;
+		RenderGraphState before;
+		RenderGraphState after;
+		std::vector<VkImage> physicalImages; //One per variant for an imported image, the pool's for a transient one
+		std::vector<VkImageView> physicalViews;
+
+		//Filled by Compile
+		VkImageUsageFlags usage;
+		uint32_t firstPass; //Execution order positions, UINT32_MAX while no surviving pass uses the image
+		uint32_t lastPass;
+		uint32_t target; //Render target pool handle of a transient image
+	};
+
+	struct ImageUse
+	{
+		uint32_t image;
+		RenderGraphUsage usage;
+		bool clear;
+		VkClearValue clearValue;
+		bool contentsNeeded; //Something after the pass reads what it leaves in the image, set by Compile
+	};
+
+	//Barrier for an image, its handle is filled in for the variant being recorded
+	struct PassBarrier
+	{
+		uint32_t image;
+		VkImageMemoryBarrier barrier;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		std::vector<ImageUse> uses;
+		bool sideEffects;
+		bool culled;
+
+		VkRenderPass renderPass; //Only for passes with attachments
+		std::vector<uint32_t> attachments; //Image of each attachment index
+		std::vector<VkClearValue> clearValues;
+		std::vector<VkFramebuffer> framebuffers; //Per variant
+
+		std::vector<PassBarrier> barriers; //Issued in one call before the pass
+		VkPipelineStageFlags barrierSourceStages;
+		VkPipelineStageFlags barrierDestinationStages;
+
+		VkSubpassContents contents;
+		PassRecorder recorder;
+	};
+
+	//What the frame has done to an image so far
+	struct Tracked
+	{
+		VkImageLayout layout;
+		VkPipelineStageFlags writeStages;
+		VkAccessFlags writeAccess;
+		VkPipelineStageFlags readStages; //Readers since the last write, a write or layout change waits on them
+		VkPipelineStageFlags visibleStages; //Stages the last write has already been made visible to
+		bool contentsValid;
+	};
+
+	VkDevice logicalDevice = VK_NULL_HANDLE;
+	std::vector<Image> images;
+	std::vector<Pass> passes;
+	std::vector<uint32_t> executionOrder; //Surviving passes
+	std::vector<PassBarrier> finalBarriers; //Imported images returned to their final layout after the last pass
+	VkPipelineStageFlags finalSourceStages = 0;
+	VkPipelineStageFlags finalDestinationStages = 0;
+	VkExtent2D framebufferExtent = {};
+	uint32_t variantCount = 1;
+	std::vector<VkImageMemoryBarrier> barrierScratch;
+
+	uint32_t dependencyCount = 0;
+	uint64_t barrierCallCount = 0;
+	uint64_t barrierCount = 0;
+	uint64_t executeCount = 0;
+
+	void cull();
+	void placeImages();
+	void synchronise();
+	void createRenderPass(Pass &pass, uint32_t position, std::vector<Tracked> &tracked);
+	void addBarrier(std::vector<PassBarrier> &barriers, VkPipelineStageFlags &sourceStages, VkPipelineStageFlags &destinationStages, uint32_t image, const Tracked &from, RenderGraphState to, bool write);
+	void issueBarriers(VkCommandBuffer commandBuffer, const std::vector<PassBarrier> &barriers, VkPipelineStageFlags sourceStages, VkPipelineStageFlags destinationStages, uint32_t variant);
+	VkImage getImage(uint32_t image, uint32_t variant) const;
+	VkImageView getView(uint32_t image, uint32_t variant) const;
+	static bool isWrite(RenderGraphUsage usage);
+	static bool isAttachment(RenderGraphUsage usage);
+	static RenderGraphState usageState(RenderGraphUsage usage);
+	static VkImageAspectFlags formatAspect(VkFormat format);
+};
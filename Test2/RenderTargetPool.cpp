@@ -0,0 +1,428 @@
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+
+void RenderTargetPool::Initialise(VkPhysicalDevice physicalDevice, VkDevice device, MemoryTracker *tracker)
+{
+	logicalDevice = device;
+	memoryTracker = tracker;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	maxImageDimension = properties.limits.maxImageDimension2D;
+}
+
+void RenderTargetPool::BeginRebuild()
+{
+	for (RenderTarget &target : targets)
+	{
+		target.inUse = false;
+	}
+
+	reusedCount = 0;
+	createdCount = 0;
+}
+
+uint32_t RenderTargetPool::RequestTarget(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkSampleCountFlagBits samples, uint32_t firstPass, uint32_t lastPass)
+{
+	//Reuse the smallest free target that fits, a shrinking window keeps its images and only renders to a smaller area
+	uint32_t bestHandle = UINT32_MAX;
+	bool outgrown = false;
+
+	for (uint32_t i = 0; i < targets.size(); i++)
+	{
+		const RenderTarget &target = targets[i];
+
+		if (target.image == VK_NULL_HANDLE || target.inUse)
+		{
+			continue;
+		}
+
+		//The lifetime is part of the key as aliasing partners were chosen against it
+		if (target.format != format || target.usage != usage || target.samples != samples || target.firstPass != firstPass || target.lastPass != lastPass)
+		{
+			continue;
+		}
+
+		if (target.width < width || target.height < height)
+		{
+			outgrown = true;
+			continue;
+		}
+
+		if (bestHandle == UINT32_MAX || target.width * target.height < targets[bestHandle].width * targets[bestHandle].height)
+		{
+			bestHandle = i;
+		}
+	}
+
+	if (bestHandle != UINT32_MAX)
+	{
+		targets[bestHandle].inUse = true;
+		reusedCount++;
+		return bestHandle;
+	}
+
+	//A window that has grown once is likely to keep growing, so only its replacement is given room to spare
+	RenderTarget target = {};
+	target.width = outgrown ? roundToSizeClass(width) : width;
+	target.height = outgrown ? roundToSizeClass(height) : height;
+	target.format = format;
+	target.usage = usage;
+	target.aspect = aspect;
+	target.samples = samples;
+	target.firstPass = firstPass;
+	target.lastPass = lastPass;
+	target.inUse = true;
+
+	//Fill a slot left by a destroyed target so handles held elsewhere stay valid
+	for (uint32_t i = 0; i < targets.size(); i++)
+	{
+		if (targets[i].image == VK_NULL_HANDLE && !targets[i].inUse)
+		{
+			targets[i] = target;
+			return i;
+		}
+	}
+
+	targets.push_back(target);
+
+	return (uint32_t)targets.size() - 1;
+}
+
+bool RenderTargetPool::HasExpiringTargets() const
+{
+	for (const RenderTarget &target : targets)
+	{
+		if (target.image != VK_NULL_HANDLE && !target.inUse && target.idleRebuilds + 1 >= RENDER_TARGET_IDLE_REBUILDS)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void RenderTargetPool::Allocate()
+{
+	//Free targets idle for too long before allocating so their memory is handed back first
+	for (uint32_t i = 0; i < targets.size(); i++)
+	{
+		RenderTarget &target = targets[i];
+
+		if (target.image == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		target.idleRebuilds = target.inUse ? 0 : target.idleRebuilds + 1;
+		if (target.idleRebuilds >= RENDER_TARGET_IDLE_REBUILDS)
+		{
+			destroyTarget(i);
+		}
+	}
+
+	std::vector<uint32_t> pending;
+
+	for (uint32_t i = 0; i < targets.size(); i++)
+	{
+		RenderTarget &target = targets[i];
+
+		if (!target.inUse || target.image != VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		VkImageCreateInfo image_info = {};
+		image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image_info.pNext = nullptr;
+		image_info.flags = 0;
+		image_info.imageType = VK_IMAGE_TYPE_2D;
+		image_info.extent.width = target.width;
+		image_info.extent.height = target.height;
+		image_info.extent.depth = 1;
+		image_info.mipLevels = 1;
+		image_info.arrayLayers = 1;
+		image_info.format = target.format;
+		image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; //Aliased contents are never valid when a lifetime begins
+		image_info.usage = target.usage;
+		image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		image_info.samples = target.samples;
+
+		VkResult result = vkCreateImage(logicalDevice, &image_info, nullptr, &target.image);
+		if (result == VK_SUCCESS)
+		{
+			std::cout << "Render target image created successfully.\n";
+		}
+
+		vkGetImageMemoryRequirements(logicalDevice, target.image, &target.memoryRequirements);
+
+		//Transient attachments never leave tile memory on tilers so ask for memory that is only committed when touched
+		VkMemoryPropertyFlags preferred = (target.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0;
+		target.memoryTypeIndex = findMemoryType(target.memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, preferred);
+
+		pending.push_back(i);
+		createdCount++;
+	}
+
+	std::cout << "Render targets: " << reusedCount << " reused, " << createdCount << " created.\n";
+
+	if (pending.empty())
+	{
+		return;
+	}
+
+	//Place the largest targets first so smaller ones can share their slots
+	std::sort(pending.begin(), pending.end(), [this](uint32_t a, uint32_t b) { return targets[a].memoryRequirements.size > targets[b].memoryRequirements.size; });
+
+	std::vector<AliasSlot> slots;
+	std::vector<VkDeviceSize> blockEnd(memoryProperties.memoryTypeCount, 0);
+
+	for (uint32_t index : pending)
+	{
+		RenderTarget &target = targets[index];
+		target.slot = UINT32_MAX;
+
+		for (uint32_t s = 0; s < slots.size() && target.slot == UINT32_MAX; s++)
+		{
+			AliasSlot &slot = slots[s];
+
+			if (slot.memoryTypeIndex != target.memoryTypeIndex || slot.size < target.memoryRequirements.size || slot.offset % target.memoryRequirements.alignment != 0)
+			{
+				continue;
+			}
+
+			bool overlaps = false;
+			for (uint32_t occupant : slot.occupants)
+			{
+				if (lifetimesOverlap(targets[occupant], target))
+				{
+					overlaps = true;
+					break;
+				}
+			}
+
+			if (!overlaps)
+			{
+				slot.occupants.push_back(index);
+				target.slot = s;
+			}
+		}
+
+		if (target.slot == UINT32_MAX) //No compatible slot so extend the block for this memory type
+		{
+			VkDeviceSize alignment = target.memoryRequirements.alignment;
+
+			AliasSlot slot = {};
+			slot.memoryTypeIndex = target.memoryTypeIndex;
+			slot.offset = (blockEnd[target.memoryTypeIndex] + alignment - 1) / alignment * alignment;
+			slot.size = target.memoryRequirements.size;
+			slot.occupants.push_back(index);
+
+			blockEnd[target.memoryTypeIndex] = slot.offset + slot.size;
+
+			target.slot = (uint32_t)slots.size();
+			slots.push_back(slot);
+		}
+	}
+
+	//One allocation per memory type used by this batch
+	std::vector<uint32_t> blockForType(memoryProperties.memoryTypeCount, UINT32_MAX);
+
+	for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++)
+	{
+		if (blockEnd[type] == 0)
+		{
+			continue;
+		}
+
+		MemoryBlock block = {};
+		block.memoryTypeIndex = type;
+		block.size = blockEnd[type];
+		block.lazilyAllocated = (memoryProperties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+		block.liveTargets = 0;
+
+		VkMemoryAllocateInfo allocate_info = {};
+		allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocate_info.pNext = nullptr;
+		allocate_info.allocationSize = block.size;
+		allocate_info.memoryTypeIndex = type;
+
+		VkResult result = vkAllocateMemory(logicalDevice, &allocate_info, nullptr, &block.memory);
+		if (result == VK_SUCCESS)
+		{
+			memoryTracker->RecordAllocation(block.memory, block.size, type, MEMORY_TAG_ATTACHMENT, ALLOCATION_SITE);
+			std::cout << "Render target memory allocated successfully" << (block.lazilyAllocated ? " (lazily allocated).\n" : ".\n");
+		}
+
+		//Reuse an emptied block entry if there is one
+		uint32_t blockIndex = UINT32_MAX;
+		for (uint32_t b = 0; b < blocks.size(); b++)
+		{
+			if (blocks[b].memory == VK_NULL_HANDLE)
+			{
+				blockIndex = b;
+				break;
+			}
+		}
+
+		if (blockIndex == UINT32_MAX)
+		{
+			blockIndex = (uint32_t)blocks.size();
+			blocks.push_back(block);
+		}
+		else
+		{
+			blocks[blockIndex] = block;
+		}
+
+		blockForType[type] = blockIndex;
+	}
+
+	for (uint32_t index : pending)
+	{
+		RenderTarget &target = targets[index];
+		MemoryBlock &block = blocks[blockForType[target.memoryTypeIndex]];
+
+		target.block = blockForType[target.memoryTypeIndex];
+		block.liveTargets++;
+
+		vkBindImageMemory(logicalDevice, target.image, block.memory, slots[target.slot].offset);
+
+		VkImageViewCreateInfo image_view_info = {};
+		image_view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		image_view_info.pNext = nullptr;
+		image_view_info.flags = 0;
+		image_view_info.image = target.image;
+		image_view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		image_view_info.format = target.format;
+		image_view_info.subresourceRange.aspectMask = target.aspect;
+		image_view_info.subresourceRange.baseMipLevel = 0;
+		image_view_info.subresourceRange.levelCount = 1;
+		image_view_info.subresourceRange.baseArrayLayer = 0;
+		image_view_info.subresourceRange.layerCount = 1;
+		image_view_info.components.r = VK_COMPONENT_SWIZZLE_R;
+		image_view_info.components.g = VK_COMPONENT_SWIZZLE_G;
+		image_view_info.components.b = VK_COMPONENT_SWIZZLE_B;
+		image_view_info.components.a = VK_COMPONENT_SWIZZLE_A;
+
+		VkResult result = vkCreateImageView(logicalDevice, &image_view_info, nullptr, &target.imageView);
+		if (result == VK_SUCCESS)
+		{
+			std::cout << "Render target view created successfully.\n";
+		}
+	}
+}
+
+void RenderTargetPool::Release()
+{
+	for (uint32_t i = 0; i < targets.size(); i++)
+	{
+		if (targets[i].image != VK_NULL_HANDLE)
+		{
+			destroyTarget(i);
+		}
+	}
+
+	targets.clear();
+	blocks.clear();
+}
+
+void RenderTargetPool::ReportCommitment()
+{
+	VkDeviceSize unaliasedSize = 0;
+	VkDeviceSize allocatedSize = 0;
+	VkDeviceSize committedSize = 0;
+	uint32_t liveTargets = 0;
+
+	for (const RenderTarget &target : targets)
+	{
+		if (target.image != VK_NULL_HANDLE)
+		{
+			unaliasedSize += target.memoryRequirements.size;
+			liveTargets++;
+		}
+	}
+
+	for (const MemoryBlock &block : blocks)
+	{
+		if (block.memory == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		allocatedSize += block.size;
+
+		if (block.lazilyAllocated)
+		{
+			VkDeviceSize committed = 0;
+			vkGetDeviceMemoryCommitment(logicalDevice, block.memory, &committed);
+			committedSize += committed;
+		}
+		else
+		{
+			committedSize += block.size;
+		}
+	}
+
+	const double mb = 1024.0 * 1024.0;
+	std::cout << "Render target memory: " << liveTargets << " targets, " << unaliasedSize / mb << " MB unaliased, ";
+	std::cout << allocatedSize / mb << " MB allocated after aliasing, " << committedSize / mb << " MB committed.\n";
+}
+
+void RenderTargetPool::destroyTarget(uint32_t handle)
+{
+	RenderTarget &target = targets[handle];
+
+	vkDestroyImageView(logicalDevice, target.imageView, nullptr);
+	vkDestroyImage(logicalDevice, target.image, nullptr);
+
+	target.imageView = VK_NULL_HANDLE;
+	target.image = VK_NULL_HANDLE;
+
+	//The block goes once the last target aliasing into it is gone
+	MemoryBlock &block = blocks[target.block];
+	block.liveTargets--;
+	if (block.liveTargets == 0)
+	{
+		memoryTracker->RecordFree(block.memory);
+		vkFreeMemory(logicalDevice, block.memory, nullptr);
+		block.memory = VK_NULL_HANDLE;
+	}
+
+	target.block = UINT32_MAX;
+}
+
+uint32_t RenderTargetPool::roundToSizeClass(uint32_t size) const
+{
+	uint32_t rounded = (size + RENDER_TARGET_SIZE_STEP - 1) / RENDER_TARGET_SIZE_STEP * RENDER_TARGET_SIZE_STEP;
+
+	return std::min(rounded, maxImageDimension);
+}
+
+uint32_t RenderTargetPool::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferred)
+{
+	//First pass looks for the preferred properties as well, the second settles for only the required ones
+	VkMemoryPropertyFlags wanted[2] = { properties | preferred, properties };
+
+	for (VkMemoryPropertyFlags flags : wanted)
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			if (typeFilter & (1 << i) && ((memoryProperties.memoryTypes[i].propertyFlags & flags) == flags))
+			{
+				return i;
+			}
+		}
+	}
+
+	std::cout << "No suitable memory types found for render target.\n";
+	return 0;
+}
+
+bool RenderTargetPool::lifetimesOverlap(const RenderTarget &a, const RenderTarget &b) const
+{
+	return !(a.lastPass < b.firstPass || b.lastPass < a.firstPass);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "MemoryTracker.h"
+#include <iostream>
+#include <vector>
+
+//Targets are created at the exact size first. One outgrown by a resize is replaced by a target rounded up to a multiple
+//of this, so further small growth reuses it
+const uint32_t RENDER_TARGET_SIZE_STEP = 256;
+
+//Targets not requested by this many rebuilds in a row are destroyed, so a window resized back and forth keeps its images
+const uint32_t RENDER_TARGET_IDLE_REBUILDS = 3;
+
+//A single image owned by the pool, lifetimes are given as an inclusive range of pass indices within a frame
+struct RenderTarget
+{
+	VkImage image = VK_NULL_HANDLE;
+	VkImageView imageView = VK_NULL_HANDLE;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkImageUsageFlags usage = 0;
+	VkImageAspectFlags aspect = 0;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	uint32_t width = 0; //Size the image was created at, at least as large as any extent it is handed out for
+	uint32_t height = 0;
+	uint32_t firstPass = 0;
+	uint32_t lastPass = 0;
+
+	VkMemoryRequirements memoryRequirements = {};
+	uint32_t memoryTypeIndex = UINT32_MAX;
+	uint32_t slot = UINT32_MAX;
+	uint32_t block = UINT32_MAX;
+
+	bool inUse = false; //Requested since the last BeginRebuild
+	uint32_t idleRebuilds = 0; //Rebuilds in a row that did not request the target
+};
+
+//Owns the attachments of a frame, keeps them alive across swapchain recreation and places every target whose lifetime
+//does not overlap another's into the same memory
+class RenderTargetPool
+{
+public:
+	void Initialise(VkPhysicalDevice physicalDevice, VkDevice device, MemoryTracker *tracker);
+
+	//Mark every target as unused ahead of a new set of requests
+	void BeginRebuild();
+
+	//Hand out an existing target of the same format, usage, sample count and lifetime that is at least as large, or register
+	//a new one to be created on Allocate. The new one is the exact size unless it replaces a target the extent has
+	//outgrown, then it is rounded up to the next size class. Returns a handle used to retrieve the image and view
+	uint32_t RequestTarget(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkSampleCountFlagBits samples, uint32_t firstPass, uint32_t lastPass);
+
+	//True if Allocate would destroy targets that have gone unrequested for RENDER_TARGET_IDLE_REBUILDS rebuilds
+	bool HasExpiringTargets() const;
+
+	//Destroy targets that have gone unrequested for RENDER_TARGET_IDLE_REBUILDS rebuilds, then create the new ones,
+	//aliasing their memory where possible
+	void Allocate();
+
+	//Destroy all targets and free their memory
+	void Release();
+
+	//Print the memory the targets would need unaliased in DEVICE_LOCAL memory against what is actually committed
+	void ReportCommitment();
+
+	VkImage GetImage(uint32_t handle) const { return targets[handle].image; }
+	VkImageView GetImageView(uint32_t handle) const { return targets[handle].imageView; }
+
+private:
+	//A region of a memory block shared by targets with disjoint lifetimes
+	struct AliasSlot
+	{
+		uint32_t memoryTypeIndex;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		std::vector<uint32_t> occupants;
+	};
+
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory;
+		uint32_t memoryTypeIndex;
+		VkDeviceSize size;
+		bool lazilyAllocated;
+		uint32_t liveTargets;
+	};
+
+	VkDevice logicalDevice = VK_NULL_HANDLE;
+	MemoryTracker *memoryTracker = nullptr;
+	VkPhysicalDeviceMemoryProperties memoryProperties = {};
+	uint32_t maxImageDimension = 0;
+
+	std::vector<RenderTarget> targets;
+	std::vector<MemoryBlock> blocks;
+
+	uint32_t reusedCount = 0;
+	uint32_t createdCount = 0;
+
+	void destroyTarget(uint32_t handle);
+	uint32_t roundToSizeClass(uint32_t size) const;
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferred);
+	bool lifetimesOverlap(const RenderTarget &a, const RenderTarget &b) const;
+};
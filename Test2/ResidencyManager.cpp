@@ -0,0 +1,126 @@
+#include "ResidencyManager.h"
+
+uint32_t ResidencyManager::RegisterAsset(ResidentAssetType type, const char *name)
+{
+	ResidentAsset asset = {};
+	asset.type = type;
+	asset.name = name;
+	asset.lastUsedFrame = frame;
+
+	assets.push_back(asset);
+
+	return (uint32_t)assets.size() - 1;
+}
+
+bool ResidencyManager::Touch(uint32_t asset)
+{
+	ResidentAsset &entry = assets[asset];
+	entry.lastUsedFrame = frame;
+
+	if (entry.resident)
+	{
+		return true;
+	}
+
+	if (!entry.uploadQueued && !entry.loading && !entry.loadFailed)
+	{
+		entry.uploadQueued = true;
+		uploadQueue.push_back(asset);
+	}
+
+	return false;
+}
+
+void ResidencyManager::MarkResident(uint32_t asset, VkDeviceSize deviceBytes)
+{
+	ResidentAsset &entry = assets[asset];
+
+	if (entry.resident)
+	{
+		return;
+	}
+
+	if (entry.evictedBefore)
+	{
+		reuploadCount++;
+		reuploadedBytes += deviceBytes;
+	}
+
+	entry.resident = true;
+	entry.loading = false;
+	entry.deviceBytes = deviceBytes;
+	residentBytes += deviceBytes;
+}
+
+void ResidencyManager::MarkLoadFailed(uint32_t asset, bool permanent)
+{
+	ResidentAsset &entry = assets[asset];
+	entry.loading = false;
+	entry.loadFailed = permanent;
+
+	std::cout << "Failed to load " << entry.name << (permanent ? ", drawing its placeholder from now on.\n" : ", retrying when next drawn.\n");
+}
+
+void ResidencyManager::MarkEvicted(uint32_t asset)
+{
+	ResidentAsset &entry = assets[asset];
+
+	if (!entry.resident)
+	{
+		return;
+	}
+
+	entry.resident = false;
+	entry.evictedBefore = true;
+	residentBytes -= entry.deviceBytes;
+
+	evictionCount++;
+	evictedBytes += entry.deviceBytes;
+
+	std::cout << "Evicted " << entry.name << ", " << entry.deviceBytes << " bytes, last used " << frame - entry.lastUsedFrame << " frames ago.\n";
+}
+
+uint32_t ResidencyManager::EvictionCandidate() const
+{
+	uint32_t candidate = UINT32_MAX;
+
+	for (uint32_t i = 0; i < assets.size(); i++)
+	{
+		const ResidentAsset &entry = assets[i];
+
+		//Anything touched this frame is referenced by work about to be submitted
+		if (!entry.resident || entry.lastUsedFrame == frame)
+		{
+			continue;
+		}
+
+		if (candidate == UINT32_MAX || entry.lastUsedFrame < assets[candidate].lastUsedFrame)
+		{
+			candidate = i;
+		}
+	}
+
+	return candidate;
+}
+
+bool ResidencyManager::NextUpload(uint32_t &asset)
+{
+	if (uploadQueue.empty())
+	{
+		return false;
+	}
+
+	asset = uploadQueue.front();
+	uploadQueue.pop_front();
+	assets[asset].uploadQueued = false;
+
+	return true;
+}
+
+void ResidencyManager::ReportMetrics()
+{
+	const double mb = 1024.0 * 1024.0;
+
+	std::cout << "Residency: " << residentBytes / mb << " MB resident, " << evictionCount << " evictions (" << evictedBytes / mb << " MB), ";
+	std::cout << reuploadCount << " re-uploads (" << reuploadedBytes / mb << " MB), " << uploadQueue.size() << " uploads waiting.\n";
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <iostream>
+#include <vector>
+#include <deque>
+
+enum ResidentAssetType
+{
+	RESIDENT_TEXTURE,
+	RESIDENT_MESH
+};
+
+//Bookkeeping for one texture or mesh whose device copy can be dropped and rebuilt from its CPU or disk cache
+struct ResidentAsset
+{
+	ResidentAssetType type;
+	const char *name;
+	VkDeviceSize deviceBytes; //Size of the device copy while resident, or of the last one while evicted
+	uint64_t lastUsedFrame;
+	bool resident;
+	bool uploadQueued;
+	bool loading; //Requested from the asset loader and not resident yet
+	bool loadFailed; //The source could not be decoded, never queued again
+	bool evictedBefore;
+};
+
+//Decides which assets live in device memory. The owner reports uses and residency changes and performs the actual
+//evictions and uploads, the manager keeps the LRU order, the upload queue and the metrics
+class ResidencyManager
+{
+public:
+	uint32_t RegisterAsset(ResidentAssetType type, const char *name);
+
+	//Advance the frame counter assets are stamped with
+	void BeginFrame() { frame++; }
+
+	//Stamp an asset as used by the frame being built. Returns false if it is not resident, in which case it is queued
+	//for upload and the caller should draw its placeholder
+	bool Touch(uint32_t asset);
+
+	void MarkLoading(uint32_t asset) { assets[asset].loading = true; }
+	void MarkResident(uint32_t asset, VkDeviceSize deviceBytes);
+
+	//A permanent failure stops the asset being queued again, otherwise it is retried the next time it is drawn
+	void MarkLoadFailed(uint32_t asset, bool permanent);
+	void MarkEvicted(uint32_t asset);
+
+	//Least recently used resident asset not needed by the current frame, UINT32_MAX if there is none
+	uint32_t EvictionCandidate() const;
+
+	//Pop the next asset waiting to be uploaded, returns false when the queue is empty
+	bool NextUpload(uint32_t &asset);
+	bool HasQueuedUploads() const { return !uploadQueue.empty(); }
+
+	bool IsResident(uint32_t asset) const { return assets[asset].resident; }
+	VkDeviceSize GetResidentBytes() const { return residentBytes; }
+
+	void ReportMetrics();
+
+private:
+	std::vector<ResidentAsset> assets;
+	std::deque<uint32_t> uploadQueue;
+	uint64_t frame = 0;
+
+	VkDeviceSize residentBytes = 0;
+	uint32_t evictionCount = 0;
+	VkDeviceSize evictedBytes = 0;
+	uint32_t reuploadCount = 0;
+	VkDeviceSize reuploadedBytes = 0;
+};
@@ -4,18 +4,33 @@ int main()
 {
 	VulkanBase &vulkan = VulkanBase::getSingleton();
 
-	//Loop continuously until we ask the glfw window to close
-	while (!glfwWindowShouldClose(vulkan.window)) 
+	if (threadedFrameLoop)
 	{
-		glfwPollEvents();
+		//Simulation and rendering run on their own threads, this one only polls the window as GLFW requires
+		vulkan.StartFrameThreads();
 
-		vulkan.AcquireSubmitPresent();
+		while (!glfwWindowShouldClose(vulkan.window))
+		{
+			glfwWaitEventsTimeout(WINDOW_EVENT_TIMEOUT);
 
-		vulkan.UpdateUniformBuffer();
+			vulkan.RunMainThreadJobs();
+		}
 
-		vulkan.showFPS(vulkan.window);
+		vulkan.StopFrameThreads();
+	}
+	else
+	{
+		//Loop continuously until we ask the glfw window to close
+		while (!glfwWindowShouldClose(vulkan.window))
+		{
+			glfwPollEvents();
+
+			vulkan.UpdateSimulation();
+
+			vulkan.RenderFrame();
 
-		vulkan.windowTimer();
+			vulkan.RunMainThreadJobs();
+		}
 	}
 
 	vulkan.showAverages();
@@ -0,0 +1,363 @@
+#include "SyncTimeline.h"
+
+void SyncTimeline::Initialise(VkDevice device, bool timelineEnabled)
+{
+	logicalDevice = device;
+
+#ifdef VK_KHR_timeline_semaphore
+	if (timelineEnabled)
+	{
+		waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(logicalDevice, "vkWaitSemaphoresKHR");
+		getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(logicalDevice, "vkGetSemaphoreCounterValueKHR");
+		timelineSupported = waitSemaphores != nullptr && getSemaphoreCounterValue != nullptr;
+	}
+#endif
+
+	std::cout << "Submission tracking initialised with " << (timelineSupported ? "timeline semaphores" : "fences") << ".\n";
+}
+
+uint32_t SyncTimeline::RegisterQueue(VkQueue queue)
+{
+	QueueTimeline timeline = {};
+	timeline.queue = queue;
+	timeline.semaphore = VK_NULL_HANDLE;
+	timeline.lastSubmitted = 0;
+
+#ifdef VK_KHR_timeline_semaphore
+	if (timelineSupported)
+	{
+		VkSemaphoreTypeCreateInfoKHR semaphore_type_info = {};
+		semaphore_type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		semaphore_type_info.pNext = nullptr;
+		semaphore_type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		semaphore_type_info.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphore_info = {};
+		semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphore_info.pNext = &semaphore_type_info;
+		semaphore_info.flags = 0;
+
+		VkResult result = vkCreateSemaphore(logicalDevice, &semaphore_info, nullptr, &timeline.semaphore);
+		if (result == VK_SUCCESS)
+		{
+			std::cout << "Timeline Semaphore created successfully.\n";
+		}
+	}
+#endif
+
+	queues.push_back(timeline);
+
+	return (uint32_t)queues.size() - 1;
+}
+
+SyncTicket SyncTimeline::Submit(uint32_t queue, const VkSubmitInfo &submitInfo, SyncTicket waitTicket, VkPipelineStageFlags waitStage)
+{
+	return Submit(queue, &submitInfo, 1, waitTicket, waitStage);
+}
+
+SyncTicket SyncTimeline::Submit(uint32_t queue, const VkSubmitInfo *submitInfos, uint32_t submitInfoCount, SyncTicket waitTicket, VkPipelineStageFlags waitStage)
+{
+	QueueTimeline &timeline = queues[queue];
+	SyncTicket ticket = nextTicket++;
+
+	PendingSubmission submission = {};
+	submission.ticket = ticket;
+	submission.queue = queue;
+	submission.fence = VK_NULL_HANDLE;
+	submission.complete = false;
+
+	//A ticket from the same queue is already ordered by submission, only other queues need a wait
+	PendingSubmission *waitFor = findPending(waitTicket);
+	if (waitFor != nullptr && (waitFor->queue == queue || poll(*waitFor)))
+	{
+		waitFor = nullptr;
+	}
+
+	VkResult result;
+
+#ifdef VK_KHR_timeline_semaphore
+	if (timelineSupported)
+	{
+		//Binary semaphores from the caller keep their place, the timeline values for them are ignored. Storage is
+		//sized up front so the pointers handed to the driver stay valid
+		std::vector<VkSubmitInfo> submits(submitInfos, submitInfos + submitInfoCount);
+		std::vector<VkTimelineSemaphoreSubmitInfoKHR> timelineInfos(submitInfoCount);
+		std::vector<std::vector<VkSemaphore>> waits(submitInfoCount);
+		std::vector<std::vector<VkPipelineStageFlags>> waitStages(submitInfoCount);
+		std::vector<std::vector<uint64_t>> waitValues(submitInfoCount);
+		std::vector<std::vector<VkSemaphore>> signals(submitInfoCount);
+		std::vector<std::vector<uint64_t>> signalValues(submitInfoCount);
+
+		for (uint32_t i = 0; i < submitInfoCount; i++)
+		{
+			const VkSubmitInfo &submitInfo = submitInfos[i];
+
+			waits[i].assign(submitInfo.pWaitSemaphores, submitInfo.pWaitSemaphores + submitInfo.waitSemaphoreCount);
+			waitStages[i].assign(submitInfo.pWaitDstStageMask, submitInfo.pWaitDstStageMask + submitInfo.waitSemaphoreCount);
+			waitValues[i].assign(submitInfo.waitSemaphoreCount, 0);
+			if (i == 0 && waitFor != nullptr)
+			{
+				waits[i].push_back(queues[waitFor->queue].semaphore);
+				waitStages[i].push_back(waitStage);
+				waitValues[i].push_back(waitTicket);
+			}
+
+			//Signalling after the last batch covers every batch before it in submission order
+			signals[i].assign(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+			signalValues[i].assign(submitInfo.signalSemaphoreCount, 0);
+			if (i == submitInfoCount - 1)
+			{
+				signals[i].push_back(timeline.semaphore);
+				signalValues[i].push_back(ticket);
+			}
+
+			VkTimelineSemaphoreSubmitInfoKHR &timeline_info = timelineInfos[i];
+			timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+			timeline_info.pNext = submitInfo.pNext;
+			timeline_info.waitSemaphoreValueCount = (uint32_t)waitValues[i].size();
+			timeline_info.pWaitSemaphoreValues = waitValues[i].data();
+			timeline_info.signalSemaphoreValueCount = (uint32_t)signalValues[i].size();
+			timeline_info.pSignalSemaphoreValues = signalValues[i].data();
+
+			VkSubmitInfo &submit_info = submits[i];
+			submit_info.pNext = &timeline_info;
+			submit_info.waitSemaphoreCount = (uint32_t)waits[i].size();
+			submit_info.pWaitSemaphores = waits[i].data();
+			submit_info.pWaitDstStageMask = waitStages[i].data();
+			submit_info.signalSemaphoreCount = (uint32_t)signals[i].size();
+			submit_info.pSignalSemaphores = signals[i].data();
+		}
+
+		result = vkQueueSubmit(timeline.queue, submitInfoCount, submits.data(), VK_NULL_HANDLE);
+	}
+	else
+#endif
+	{
+		//Fences cannot be waited on by the GPU, cross queue dependencies are resolved here instead
+		if (waitFor != nullptr)
+		{
+			Wait(waitTicket);
+		}
+
+		submission.fence = acquireFence();
+		result = vkQueueSubmit(timeline.queue, submitInfoCount, submitInfos, submission.fence);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		std::cout << "Queue submission failed.\n";
+	}
+
+	timeline.lastSubmitted = ticket;
+	pendingSubmissions.push_back(submission);
+	submitCount++;
+
+	return ticket;
+}
+
+bool SyncTimeline::IsComplete(SyncTicket ticket)
+{
+	if (ticket < completedBelow)
+	{
+		return true;
+	}
+
+	PendingSubmission *submission = findPending(ticket);
+	bool complete = submission == nullptr || poll(*submission);
+
+	retireCompleted();
+
+	return complete;
+}
+
+void SyncTimeline::Wait(SyncTicket ticket)
+{
+	PendingSubmission *submission = findPending(ticket);
+	if (submission == nullptr || poll(*submission))
+	{
+		retireCompleted();
+		return;
+	}
+
+	auto waitStart = std::chrono::steady_clock::now();
+
+#ifdef VK_KHR_timeline_semaphore
+	if (timelineSupported)
+	{
+		VkSemaphoreWaitInfoKHR wait_info = {};
+		wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		wait_info.pNext = nullptr;
+		wait_info.flags = 0;
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores = &queues[submission->queue].semaphore;
+		wait_info.pValues = &ticket;
+
+		waitSemaphores(logicalDevice, &wait_info, UINT64_MAX);
+	}
+	else
+#endif
+	{
+		vkWaitForFences(logicalDevice, 1, &submission->fence, VK_TRUE, UINT64_MAX);
+	}
+
+	auto waitEnd = std::chrono::steady_clock::now();
+	waitTimeSum += std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(waitEnd - waitStart).count();
+	waitCount++;
+
+	poll(*submission);
+	retireCompleted();
+}
+
+void SyncTimeline::WaitAll()
+{
+	for (const QueueTimeline &timeline : queues)
+	{
+		Wait(timeline.lastSubmitted);
+	}
+}
+
+void SyncTimeline::Defer(SyncTicket ticket, std::function<void()> destroy)
+{
+	if (IsComplete(ticket))
+	{
+		destroy();
+		return;
+	}
+
+	deferredDestroys.push_back({ ticket, destroy });
+}
+
+void SyncTimeline::Collect()
+{
+	//Destroy callbacks may defer more work, so run them from a copy
+	std::vector<DeferredDestroy> ready;
+	for (uint32_t i = 0; i < deferredDestroys.size();)
+	{
+		if (IsComplete(deferredDestroys[i].ticket))
+		{
+			ready.push_back(deferredDestroys[i]);
+			deferredDestroys[i] = deferredDestroys.back();
+			deferredDestroys.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	for (const DeferredDestroy &deferred : ready)
+	{
+		deferred.destroy();
+	}
+}
+
+void SyncTimeline::ReportMetrics()
+{
+	std::cout << "Submissions tracked: " << submitCount << ", " << waitCount << " blocking waits";
+	if (waitCount > 0)
+	{
+		std::cout << " averaging " << waitTimeSum / waitCount << " milliseconds";
+	}
+	std::cout << ", " << pendingSubmissions.size() << " still pending.\n";
+}
+
+void SyncTimeline::Release()
+{
+	WaitAll();
+	Collect();
+
+	for (const PendingSubmission &submission : pendingSubmissions)
+	{
+		vkDestroyFence(logicalDevice, submission.fence, nullptr);
+	}
+	pendingSubmissions.clear();
+
+	for (VkFence fence : freeFences)
+	{
+		vkDestroyFence(logicalDevice, fence, nullptr);
+	}
+	freeFences.clear();
+
+	for (const QueueTimeline &timeline : queues)
+	{
+		vkDestroySemaphore(logicalDevice, timeline.semaphore, nullptr);
+	}
+	queues.clear();
+}
+
+SyncTimeline::PendingSubmission *SyncTimeline::findPending(SyncTicket ticket)
+{
+	if (ticket < completedBelow || pendingSubmissions.empty())
+	{
+		return nullptr;
+	}
+
+	//Tickets are handed out in order so the offset from the front locates the submission directly
+	SyncTicket offset = ticket - pendingSubmissions.front().ticket;
+	if (offset >= pendingSubmissions.size())
+	{
+		return nullptr;
+	}
+
+	return &pendingSubmissions[(size_t)offset];
+}
+
+bool SyncTimeline::poll(PendingSubmission &submission)
+{
+	if (submission.complete)
+	{
+		return true;
+	}
+
+#ifdef VK_KHR_timeline_semaphore
+	if (timelineSupported)
+	{
+		uint64_t value = 0;
+		getSemaphoreCounterValue(logicalDevice, queues[submission.queue].semaphore, &value);
+		submission.complete = value >= submission.ticket;
+	}
+	else
+#endif
+	{
+		submission.complete = vkGetFenceStatus(logicalDevice, submission.fence) == VK_SUCCESS;
+	}
+
+	return submission.complete;
+}
+
+void SyncTimeline::retireCompleted()
+{
+	while (!pendingSubmissions.empty() && poll(pendingSubmissions.front()))
+	{
+		PendingSubmission &submission = pendingSubmissions.front();
+
+		if (submission.fence != VK_NULL_HANDLE)
+		{
+			vkResetFences(logicalDevice, 1, &submission.fence);
+			freeFences.push_back(submission.fence);
+		}
+
+		completedBelow = submission.ticket + 1;
+		pendingSubmissions.pop_front();
+	}
+}
+
+VkFence SyncTimeline::acquireFence()
+{
+	if (!freeFences.empty())
+	{
+		VkFence fence = freeFences.back();
+		freeFences.pop_back();
+		return fence;
+	}
+
+	VkFenceCreateInfo fence_info = {};
+	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fence_info.pNext = nullptr;
+	fence_info.flags = 0;
+
+	VkFence fence;
+	vkCreateFence(logicalDevice, &fence_info, nullptr, &fence);
+
+	return fence;
+}
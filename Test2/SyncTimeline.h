@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <functional>
+
+//Identifies one queue submission. Tickets increase monotonically across every queue and zero is always complete
+typedef uint64_t SyncTicket;
+
+//Tracks the completion of queue submissions by ticket so the CPU only ever waits on the work it depends on. With
+//VK_KHR_timeline_semaphore each registered queue signals its own timeline semaphore with the ticket value, otherwise
+//every submission signals a fence taken from a recycled pool
+class SyncTimeline
+{
+public:
+	void Initialise(VkDevice device, bool timelineEnabled);
+
+	//Returns the index submissions to this queue are made with
+	uint32_t RegisterQueue(VkQueue queue);
+
+	//Submit with the next ticket appended as a signal, the submit info may carry its own binary semaphores. A non-zero
+	//waitTicket makes the submission wait for that ticket on the GPU, on the fence fallback the CPU waits for it instead
+	SyncTicket Submit(uint32_t queue, const VkSubmitInfo &submitInfo, SyncTicket waitTicket = 0, VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+	//Several submit infos in one vkQueueSubmit completing as a single ticket, the ticket wait is added to the first
+	//and the signal to the last
+	SyncTicket Submit(uint32_t queue, const VkSubmitInfo *submitInfos, uint32_t submitInfoCount, SyncTicket waitTicket = 0, VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+	//Never blocks
+	bool IsComplete(SyncTicket ticket);
+
+	void Wait(SyncTicket ticket);
+
+	//Wait for the last submission made to every queue
+	void WaitAll();
+
+	//Run destroy once the ticket has completed, checked by Collect
+	void Defer(SyncTicket ticket, std::function<void()> destroy);
+	void Collect();
+
+	SyncTicket GetLastSubmitted(uint32_t queue) const { return queues[queue].lastSubmitted; }
+	bool UsesTimeline() const { return timelineSupported; }
+
+	//Print submission and CPU wait totals
+	void ReportMetrics();
+
+	//Waits for everything, runs outstanding deferred work and destroys the semaphores and fences
+	void Release();
+
+private:
+	struct QueueTimeline
+	{
+		VkQueue queue;
+		VkSemaphore semaphore; //Timeline semaphore, only with the extension
+		SyncTicket lastSubmitted;
+	};
+
+	//Submission that has not been seen complete yet, the fence is only used on the fallback
+	struct PendingSubmission
+	{
+		SyncTicket ticket;
+		uint32_t queue;
+		VkFence fence;
+		bool complete;
+	};
+
+	struct DeferredDestroy
+	{
+		SyncTicket ticket;
+		std::function<void()> destroy;
+	};
+
+	VkDevice logicalDevice = VK_NULL_HANDLE;
+	bool timelineSupported = false;
+
+#ifdef VK_KHR_timeline_semaphore
+	PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+	PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue = nullptr;
+#endif
+
+	std::vector<QueueTimeline> queues;
+	std::deque<PendingSubmission> pendingSubmissions; //Ordered by ticket
+	std::vector<VkFence> freeFences;
+	std::vector<DeferredDestroy> deferredDestroys;
+
+	SyncTicket nextTicket = 1;
+	SyncTicket completedBelow = 1; //Every ticket below this has completed
+
+	uint64_t submitCount = 0;
+	uint64_t waitCount = 0; //Waits that actually blocked
+	double waitTimeSum = 0;
+
+	PendingSubmission *findPending(SyncTicket ticket);
+	bool poll(PendingSubmission &submission);
+	void retireCompleted();
+	VkFence acquireFence();
+};
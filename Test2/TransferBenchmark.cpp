@@ -0,0 +1,714 @@
+#include "TransferBenchmark.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <cstring>
+
+void TransferBenchmark::Initialise(VkPhysicalDevice physicalDevice, VkDevice device, SyncTimeline *timeline, MemoryTracker *tracker)
+{
+	logicalDevice = device;
+	syncTimeline = timeline;
+	memoryTracker = tracker;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+
+	//Start and end of the submissions making up one transfer
+	VkQueryPoolCreateInfo query_pool_info = {};
+	query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	query_pool_info.pNext = nullptr;
+	query_pool_info.flags = 0;
+	query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	query_pool_info.queryCount = 2;
+	query_pool_info.pipelineStatistics = 0;
+
+	vkCreateQueryPool(logicalDevice, &query_pool_info, nullptr, &timestampQueryPool);
+
+	if (!createBuffer(BENCHMARK_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MEMORY_TAG_STAGING, ALLOCATION_SITE, ringBuffer, ringMemory))
+	{
+		std::cout << "Failed to allocate the benchmark staging ring.\n";
+		return;
+	}
+
+	void *mapped;
+	vkMapMemory(logicalDevice, ringMemory, 0, BENCHMARK_RING_SIZE, 0, &mapped);
+	ringMapped = reinterpret_cast<uint8_t*>(mapped);
+}
+
+void TransferBenchmark::AddQueue(const char *name, uint32_t queue, uint32_t familyIndex, bool timestamps)
+{
+	BenchmarkQueue benchmarkQueue = {};
+	benchmarkQueue.name = name;
+	benchmarkQueue.queue = queue;
+	benchmarkQueue.familyIndex = familyIndex;
+	benchmarkQueue.timestamps = timestamps;
+
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.pNext = nullptr;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_info.queueFamilyIndex = familyIndex;
+
+	VkResult result = vkCreateCommandPool(logicalDevice, &pool_info, nullptr, &benchmarkQueue.pool);
+	if (result == VK_SUCCESS)
+	{
+		std::cout << "Benchmark command pool created successfully.\n";
+	}
+
+	queues.push_back(benchmarkQueue);
+}
+
+void TransferBenchmark::Run(const std::string &csvPath)
+{
+	if (queues.empty() || ringMapped == nullptr)
+	{
+		return;
+	}
+
+	std::ofstream csv(csvPath, std::ios::trunc);
+	csv << "size,strategy,submits,queue,repetitions";
+	for (const char *metric : { "alloc", "memcpy", "gpu", "wait" })
+	{
+		csv << "," << metric << "_p10," << metric << "_p50," << metric << "_p90";
+	}
+	csv << "\n";
+
+	std::cout << "\n---TRANSFER BENCHMARK---\n";
+	std::cout << "GB/s as p10 / p50 / p90 over the repetitions of each case, - where a phase does not apply\n";
+
+	for (VkDeviceSize size = BENCHMARK_MIN_SIZE; size <= BENCHMARK_MAX_SIZE; size *= 4)
+	{
+		std::vector<uint8_t> source;
+		try
+		{
+			source.resize((size_t)size);
+		}
+		catch (const std::bad_alloc &)
+		{
+			std::cout << "Not enough host memory for " << size << " byte transfers, stopping.\n";
+			break;
+		}
+
+		for (size_t i = 0; i < source.size(); i++)
+		{
+			source[i] = (uint8_t)(i * 31);
+		}
+
+		uint32_t repetitions = (uint32_t)std::min<VkDeviceSize>(BENCHMARK_MAX_REPETITIONS, std::max<VkDeviceSize>(BENCHMARK_MIN_REPETITIONS, BENCHMARK_BYTES_PER_CASE / size));
+
+		for (uint32_t s = 0; s < STAGING_STRATEGY_COUNT; s++)
+		{
+			StagingStrategy strategy = (StagingStrategy)s;
+
+			for (uint32_t submits : BENCHMARK_SUBMIT_COUNTS)
+			{
+				for (uint32_t q = 0; q < queues.size(); q++)
+				{
+					//Direct writes involve no submissions, one case covers them
+					if (strategy == STAGING_DIRECT && (submits != BENCHMARK_SUBMIT_COUNTS[0] || q != 0))
+					{
+						continue;
+					}
+
+					std::vector<TransferSample> samples;
+					for (uint32_t r = 0; r < repetitions; r++)
+					{
+						TransferSample sample;
+						if (!runSample(queues[q], strategy, size, submits, source, sample))
+						{
+							break;
+						}
+						samples.push_back(sample);
+					}
+
+					std::cout << std::setw(10) << size << " " << std::setw(12) << strategyName(strategy) << " " << std::setw(2) << submits << " submits " << std::setw(8) << queues[q].name;
+
+					if (samples.size() < repetitions)
+					{
+						std::cout << " unavailable, allocation failed.\n";
+						continue;
+					}
+
+					csv << size << "," << strategyName(strategy) << "," << submits << "," << queues[q].name << "," << repetitions;
+
+					//Phases that took no time, or had no timestamps, are left out rather than reported as infinite
+					std::array<std::vector<double>, 4> rates;
+					for (const TransferSample &sample : samples)
+					{
+						const double seconds[4] = { sample.allocSeconds, sample.memcpySeconds, sample.gpuValid ? sample.gpuSeconds : 0.0, sample.waitSeconds };
+						for (uint32_t m = 0; m < 4; m++)
+						{
+							if (seconds[m] > 0)
+							{
+								rates[m].push_back(size / seconds[m] / 1e9);
+							}
+						}
+					}
+
+					const char *metricNames[4] = { "alloc", "memcpy", "gpu", "wait" };
+					for (uint32_t m = 0; m < 4; m++)
+					{
+						std::cout << " | " << metricNames[m] << " ";
+						if (rates[m].empty())
+						{
+							std::cout << "-";
+							csv << ",,,";
+							continue;
+						}
+
+						double p10 = percentile(rates[m], 0.1);
+						double p50 = percentile(rates[m], 0.5);
+						double p90 = percentile(rates[m], 0.9);
+
+						std::cout << std::fixed << std::setprecision(2) << p10 << " / " << p50 << " / " << p90 << std::defaultfloat;
+						csv << "," << p10 << "," << p50 << "," << p90;
+					}
+
+					std::cout << "\n";
+					csv << "\n";
+				}
+			}
+		}
+	}
+
+	std::cout << "Transfer benchmark written to " << csvPath << ".\n";
+}
+
+void TransferBenchmark::RunParallelRecording()
+{
+	if (queues.empty())
+	{
+		return;
+	}
+
+	BenchmarkQueue &queue = queues[0];
+	VkDeviceSize bufferSize = RECORDING_COMMAND_COUNT * RECORDING_REGION_SIZE;
+
+	VkBuffer srcBuffer, dstBuffer;
+	VkDeviceMemory srcMemory, dstMemory;
+	if (!createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MEMORY_TAG_STAGING, ALLOCATION_SITE, srcBuffer, srcMemory))
+	{
+		return;
+	}
+	if (!createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_TAG_VERTEX, ALLOCATION_SITE, dstBuffer, dstMemory))
+	{
+		destroyBuffer(srcBuffer, srcMemory);
+		return;
+	}
+
+	CommandPoolRegistry registry;
+	registry.Initialise(logicalDevice, syncTimeline, queue.familyIndex);
+
+	//Workers live for the whole run so each keeps its own pools, a generation counter starts every repetition
+	std::mutex workMutex;
+	std::condition_variable workStart;
+	std::condition_variable workDone;
+	uint32_t generation = 0;
+	uint32_t activeThreads = 0;
+	uint32_t finishedThreads = 0;
+	bool quit = false;
+	std::vector<std::vector<VkCommandBuffer>> recorded(RECORDING_MAX_THREADS);
+
+	std::vector<std::thread> workers;
+	for (uint32_t t = 0; t < RECORDING_MAX_THREADS; t++)
+	{
+		workers.emplace_back([&, t]()
+		{
+			uint32_t seen = 0;
+			for (;;)
+			{
+				uint32_t threadCount;
+				{
+					std::unique_lock<std::mutex> lock(workMutex);
+					workStart.wait(lock, [&]() { return quit || generation != seen; });
+					if (quit)
+					{
+						return;
+					}
+					seen = generation;
+					threadCount = activeThreads;
+				}
+
+				if (t >= threadCount)
+				{
+					continue;
+				}
+
+				recordSlice(registry, t, threadCount, srcBuffer, dstBuffer, recorded[t]);
+
+				{
+					std::lock_guard<std::mutex> lock(workMutex);
+					finishedThreads++;
+				}
+				workDone.notify_one();
+			}
+		});
+	}
+
+	std::cout << "\n---PARALLEL RECORDING--- (" << RECORDING_COMMAND_COUNT << " copies, median of " << RECORDING_REPETITIONS << ")\n";
+
+	double singleThreadTime = 0;
+	for (uint32_t threadCount : RECORDING_THREAD_COUNTS)
+	{
+		std::vector<double> recordTimes;
+		std::vector<double> submitTimes;
+
+		for (uint32_t r = 0; r < RECORDING_REPETITIONS; r++)
+		{
+			auto recordStart = std::chrono::steady_clock::now();
+
+			{
+				std::lock_guard<std::mutex> lock(workMutex);
+				activeThreads = threadCount;
+				finishedThreads = 0;
+				generation++;
+			}
+			workStart.notify_all();
+
+			{
+				std::unique_lock<std::mutex> lock(workMutex);
+				workDone.wait(lock, [&]() { return finishedThreads == threadCount; });
+			}
+
+			auto recordEnd = std::chrono::steady_clock::now();
+			recordTimes.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(recordEnd - recordStart).count());
+
+			//Every thread's command buffers go in one vkQueueSubmit, a VkSubmitInfo each
+			std::vector<VkSubmitInfo> submitInfos(threadCount);
+			for (uint32_t t = 0; t < threadCount; t++)
+			{
+				submitInfos[t].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+				submitInfos[t].pNext = nullptr;
+				submitInfos[t].commandBufferCount = (uint32_t)recorded[t].size();
+				submitInfos[t].pCommandBuffers = recorded[t].data();
+			}
+
+			SyncTicket ticket = syncTimeline->Submit(queue.queue, submitInfos.data(), threadCount);
+			syncTimeline->Wait(ticket);
+
+			auto submitEnd = std::chrono::steady_clock::now();
+			submitTimes.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(submitEnd - recordEnd).count());
+
+			registry.EndEpoch(ticket);
+		}
+
+		double recordTime = percentile(recordTimes, 0.5);
+		if (threadCount == 1)
+		{
+			singleThreadTime = recordTime;
+		}
+
+		std::cout << threadCount << " threads: recording " << recordTime << " milliseconds, " << singleThreadTime / recordTime << "x speedup, ";
+		std::cout << "submit and execute " << percentile(submitTimes, 0.5) << " milliseconds.\n";
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		quit = true;
+	}
+	workStart.notify_all();
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+
+	std::cout << registry.GetPoolCount() << " transient pools, " << registry.GetResetCount() << " pool resets.\n";
+
+	registry.Release();
+	destroyBuffer(srcBuffer, srcMemory);
+	destroyBuffer(dstBuffer, dstMemory);
+}
+
+void TransferBenchmark::Release()
+{
+	if (ringMapped != nullptr)
+	{
+		vkUnmapMemory(logicalDevice, ringMemory);
+		ringMapped = nullptr;
+	}
+	destroyBuffer(ringBuffer, ringMemory);
+
+	vkDestroyQueryPool(logicalDevice, timestampQueryPool, nullptr);
+
+	for (const BenchmarkQueue &queue : queues)
+	{
+		vkDestroyCommandPool(logicalDevice, queue.pool, nullptr);
+	}
+	queues.clear();
+}
+
+bool TransferBenchmark::runSample(BenchmarkQueue &queue, StagingStrategy strategy, VkDeviceSize size, uint32_t submits, const std::vector<uint8_t> &source, TransferSample &sample)
+{
+	sample = TransferSample{ 0, 0, 0, 0, false };
+
+	VkMemoryPropertyFlags dstProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if (strategy == STAGING_DIRECT)
+	{
+		dstProperties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	}
+
+	auto allocStart = std::chrono::steady_clock::now();
+
+	VkBuffer dstBuffer;
+	VkDeviceMemory dstMemory;
+	if (!createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, dstProperties, MEMORY_TAG_VERTEX, ALLOCATION_SITE, dstBuffer, dstMemory))
+	{
+		return false;
+	}
+
+	VkBuffer stagingBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+	if (strategy == STAGING_MAP_PER_COPY && !createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MEMORY_TAG_STAGING, ALLOCATION_SITE, stagingBuffer, stagingMemory))
+	{
+		destroyBuffer(dstBuffer, dstMemory);
+		return false;
+	}
+
+	auto allocEnd = std::chrono::steady_clock::now();
+	sample.allocSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(allocEnd - allocStart).count();
+
+	if (strategy == STAGING_DIRECT)
+	{
+		auto copyStart = std::chrono::steady_clock::now();
+
+		void *mapped;
+		vkMapMemory(logicalDevice, dstMemory, 0, size, 0, &mapped);
+		memcpy(mapped, source.data(), (size_t)size);
+		vkUnmapMemory(logicalDevice, dstMemory);
+
+		auto copyEnd = std::chrono::steady_clock::now();
+		sample.memcpySeconds = std::chrono::duration_cast<std::chrono::duration<double>>(copyEnd - copyStart).count();
+
+		destroyBuffer(dstBuffer, dstMemory);
+		return true;
+	}
+
+	//The ring hands out at most half its size at once, larger transfers are split into more submissions
+	if (strategy == STAGING_PERSISTENT_RING)
+	{
+		submits = std::max(submits, (uint32_t)((size + BENCHMARK_RING_SIZE / 2 - 1) / (BENCHMARK_RING_SIZE / 2)));
+	}
+
+	if (queue.timestamps)
+	{
+		resetQueries();
+	}
+
+	VkDeviceSize chunkSize = (size + submits - 1) / submits;
+	uint32_t submitCount = (uint32_t)((size + chunkSize - 1) / chunkSize);
+	SyncTicket lastTicket = 0;
+
+	for (uint32_t i = 0; i < submitCount; i++)
+	{
+		VkDeviceSize offset = i * chunkSize;
+		VkDeviceSize chunk = std::min(chunkSize, size - offset);
+
+		VkBuffer srcBuffer = stagingBuffer;
+		VkDeviceSize srcOffset = offset;
+
+		if (strategy == STAGING_PERSISTENT_RING)
+		{
+			srcBuffer = ringBuffer;
+			srcOffset = acquireRingRange(chunk, sample.waitSeconds);
+		}
+
+		auto copyStart = std::chrono::steady_clock::now();
+
+		if (strategy == STAGING_MAP_PER_COPY)
+		{
+			void *mapped;
+			vkMapMemory(logicalDevice, stagingMemory, offset, chunk, 0, &mapped);
+			memcpy(mapped, source.data() + offset, (size_t)chunk);
+			vkUnmapMemory(logicalDevice, stagingMemory);
+		}
+		else
+		{
+			memcpy(ringMapped + srcOffset, source.data() + offset, (size_t)chunk);
+		}
+
+		auto copyEnd = std::chrono::steady_clock::now();
+		sample.memcpySeconds += std::chrono::duration_cast<std::chrono::duration<double>>(copyEnd - copyStart).count();
+
+		VkCommandBuffer transferCommandBuffer = commandBuffer(queue, i);
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.pNext = nullptr;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(transferCommandBuffer, &begin_info);
+
+		if (queue.timestamps && i == 0)
+		{
+			vkCmdWriteTimestamp(transferCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 0);
+		}
+
+		VkBufferCopy copy_region = {};
+		copy_region.srcOffset = srcOffset;
+		copy_region.dstOffset = offset;
+		copy_region.size = chunk;
+
+		vkCmdCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, 1, &copy_region);
+
+		if (queue.timestamps && i == submitCount - 1)
+		{
+			vkCmdWriteTimestamp(transferCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 1);
+		}
+
+		vkEndCommandBuffer(transferCommandBuffer);
+
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.pNext = nullptr;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &transferCommandBuffer;
+
+		lastTicket = syncTimeline->Submit(queue.queue, submit_info);
+
+		if (strategy == STAGING_PERSISTENT_RING)
+		{
+			ringInFlight.push_back({ srcOffset, chunk, lastTicket });
+		}
+	}
+
+	//Submissions to one queue complete in order, the last ticket covers the whole transfer
+	auto waitStart = std::chrono::steady_clock::now();
+	syncTimeline->Wait(lastTicket);
+	auto waitEnd = std::chrono::steady_clock::now();
+	sample.waitSeconds += std::chrono::duration_cast<std::chrono::duration<double>>(waitEnd - waitStart).count();
+
+	ringInFlight.clear();
+
+	if (queue.timestamps)
+	{
+		uint64_t timestamps[2];
+		VkResult result = vkGetQueryPoolResults(logicalDevice, timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+		if (result == VK_SUCCESS && timestamps[1] > timestamps[0])
+		{
+			sample.gpuSeconds = (timestamps[1] - timestamps[0]) * timestampPeriod / 1e9;
+			sample.gpuValid = true;
+		}
+	}
+
+	destroyBuffer(stagingBuffer, stagingMemory);
+	destroyBuffer(dstBuffer, dstMemory);
+
+	return true;
+}
+
+VkDeviceSize TransferBenchmark::acquireRingRange(VkDeviceSize size, double &waitSeconds)
+{
+	//Ranges never straddle the end of the ring
+	if (ringHead + size > BENCHMARK_RING_SIZE)
+	{
+		ringHead = 0;
+	}
+
+	VkDeviceSize offset = ringHead;
+	ringHead += size;
+
+	//The newest overlapping range completes last, waiting on it frees the whole span
+	SyncTicket waitTicket = 0;
+	for (const RingRange &range : ringInFlight)
+	{
+		if (range.offset < offset + size && offset < range.offset + range.size)
+		{
+			waitTicket = std::max(waitTicket, range.ticket);
+		}
+	}
+
+	if (waitTicket != 0)
+	{
+		auto waitStart = std::chrono::steady_clock::now();
+		syncTimeline->Wait(waitTicket);
+		auto waitEnd = std::chrono::steady_clock::now();
+		waitSeconds += std::chrono::duration_cast<std::chrono::duration<double>>(waitEnd - waitStart).count();
+	}
+
+	while (!ringInFlight.empty() && syncTimeline->IsComplete(ringInFlight.front().ticket))
+	{
+		ringInFlight.pop_front();
+	}
+
+	return offset;
+}
+
+void TransferBenchmark::resetQueries()
+{
+	//Transfer-only queues cannot reset queries, the first queue is the graphics queue
+	VkCommandBuffer resetCommandBuffer = commandBuffer(queues[0], 0);
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.pNext = nullptr;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(resetCommandBuffer, &begin_info);
+	vkCmdResetQueryPool(resetCommandBuffer, timestampQueryPool, 0, 2);
+	vkEndCommandBuffer(resetCommandBuffer);
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext = nullptr;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &resetCommandBuffer;
+
+	syncTimeline->Wait(syncTimeline->Submit(queues[0].queue, submit_info));
+}
+
+VkCommandBuffer TransferBenchmark::commandBuffer(BenchmarkQueue &queue, uint32_t index)
+{
+	while (queue.commandBuffers.size() <= index)
+	{
+		VkCommandBufferAllocateInfo allocate_info = {};
+		allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocate_info.pNext = nullptr;
+		allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocate_info.commandPool = queue.pool;
+		allocate_info.commandBufferCount = 1;
+
+		VkCommandBuffer allocated;
+		vkAllocateCommandBuffers(logicalDevice, &allocate_info, &allocated);
+		queue.commandBuffers.push_back(allocated);
+	}
+
+	return queue.commandBuffers[index];
+}
+
+void TransferBenchmark::recordSlice(CommandPoolRegistry &registry, uint32_t thread, uint32_t threadCount, VkBuffer srcBuffer, VkBuffer dstBuffer, std::vector<VkCommandBuffer> &recorded)
+{
+	recorded.clear();
+
+	uint32_t first = RECORDING_COMMAND_COUNT * thread / threadCount;
+	uint32_t last = RECORDING_COMMAND_COUNT * (thread + 1) / threadCount;
+
+	for (uint32_t command = first; command < last; command += RECORDING_COMMANDS_PER_BUFFER)
+	{
+		VkCommandBuffer copyCommandBuffer = registry.Allocate();
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.pNext = nullptr;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(copyCommandBuffer, &begin_info);
+
+		//Each repetition overwrites the last one's copies
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.pNext = nullptr;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = dstBuffer;
+		barrier.offset = command * RECORDING_REGION_SIZE;
+		barrier.size = std::min(RECORDING_COMMANDS_PER_BUFFER, last - command) * RECORDING_REGION_SIZE;
+
+		vkCmdPipelineBarrier(copyCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+		for (uint32_t i = command; i < last && i < command + RECORDING_COMMANDS_PER_BUFFER; i++)
+		{
+			VkBufferCopy copy_region = {};
+			copy_region.srcOffset = i * RECORDING_REGION_SIZE;
+			copy_region.dstOffset = i * RECORDING_REGION_SIZE;
+			copy_region.size = RECORDING_REGION_SIZE;
+
+			vkCmdCopyBuffer(copyCommandBuffer, srcBuffer, dstBuffer, 1, &copy_region);
+		}
+
+		vkEndCommandBuffer(copyCommandBuffer);
+		recorded.push_back(copyCommandBuffer);
+	}
+}
+
+bool TransferBenchmark::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryUsageTag tag, AllocationSite site, VkBuffer &buffer, VkDeviceMemory &memory)
+{
+	VkBufferCreateInfo buffer_info = {};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.pNext = nullptr;
+	buffer_info.flags = 0;
+	buffer_info.size = size;
+	buffer_info.usage = usage;
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(logicalDevice, &buffer_info, nullptr, &buffer) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(logicalDevice, buffer, &memoryRequirements);
+
+	uint32_t memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, properties);
+
+	VkMemoryAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.pNext = nullptr;
+	allocate_info.allocationSize = memoryRequirements.size;
+	allocate_info.memoryTypeIndex = memoryTypeIndex;
+
+	//Large sizes or the direct path may not fit, the case is reported as unavailable
+	if (memoryTypeIndex == UINT32_MAX || vkAllocateMemory(logicalDevice, &allocate_info, nullptr, &memory) != VK_SUCCESS)
+	{
+		vkDestroyBuffer(logicalDevice, buffer, nullptr);
+		buffer = VK_NULL_HANDLE;
+		memory = VK_NULL_HANDLE;
+		return false;
+	}
+
+	memoryTracker->RecordAllocation(memory, memoryRequirements.size, memoryTypeIndex, tag, site);
+
+	vkBindBufferMemory(logicalDevice, buffer, memory, 0);
+
+	return true;
+}
+
+void TransferBenchmark::destroyBuffer(VkBuffer buffer, VkDeviceMemory memory)
+{
+	vkDestroyBuffer(logicalDevice, buffer, nullptr);
+
+	if (memory != VK_NULL_HANDLE)
+	{
+		memoryTracker->RecordFree(memory);
+		vkFreeMemory(logicalDevice, memory, nullptr);
+	}
+}
+
+uint32_t TransferBenchmark::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		if (typeFilter & (1 << i) && ((memoryProperties.memoryTypes[i].propertyFlags & properties) == properties))
+		{
+			return i;
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+const char *TransferBenchmark::strategyName(StagingStrategy strategy)
+{
+	switch (strategy)
+	{
+	case STAGING_MAP_PER_COPY: return "map-per-copy";
+	case STAGING_PERSISTENT_RING: return "ring";
+	case STAGING_DIRECT: return "direct";
+	default: return "unknown";
+	}
+}
+
+double TransferBenchmark::percentile(std::vector<double> values, double fraction)
+{
+	std::sort(values.begin(), values.end());
+
+	double position = fraction * (values.size() - 1);
+	size_t lower = (size_t)position;
+	size_t upper = std::min(lower + 1, values.size() - 1);
+
+	return values[lower] + (values[upper] - values[lower]) * (position - lower);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "MemoryTracker.h"
+#include "SyncTimeline.h"
+#include "CommandPoolRegistry.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//Sizes swept, each step is four times the last
+const VkDeviceSize BENCHMARK_MIN_SIZE = 4 * 1024;
+const VkDeviceSize BENCHMARK_MAX_SIZE = 1024ull * 1024 * 1024;
+
+//Repetitions are chosen to move about this many bytes per case, within the limits below
+const VkDeviceSize BENCHMARK_BYTES_PER_CASE = 512 * 1024 * 1024;
+const uint32_t BENCHMARK_MIN_REPETITIONS = 3;
+const uint32_t BENCHMARK_MAX_REPETITIONS = 20;
+
+//Submission granularities compared, the transfer is split evenly into this many submissions
+const uint32_t BENCHMARK_SUBMIT_COUNTS[] = { 1, 16 };
+
+//Capacity of the persistently mapped ring, no piece is larger than half of it so one can fill while the other is read
+const VkDeviceSize BENCHMARK_RING_SIZE = 64 * 1024 * 1024;
+
+//Parallel recording, the same copies are split across this many threads each recording from its own command pool
+const uint32_t RECORDING_THREAD_COUNTS[] = { 1, 2, 4, 8 };
+const uint32_t RECORDING_MAX_THREADS = 8;
+const uint32_t RECORDING_COMMAND_COUNT = 16384;
+const uint32_t RECORDING_COMMANDS_PER_BUFFER = 512;
+const VkDeviceSize RECORDING_REGION_SIZE = 4 * 1024;
+const uint32_t RECORDING_REPETITIONS = 5;
+
+enum StagingStrategy
+{
+	STAGING_MAP_PER_COPY, //Staging buffer allocated per transfer and mapped around every copy
+	STAGING_PERSISTENT_RING, //One staging ring mapped for the whole run
+	STAGING_DIRECT, //Written straight into host visible device local memory, no GPU copy
+	STAGING_STRATEGY_COUNT
+};
+
+//Time spent in each phase of one repetition
+struct TransferSample
+{
+	double allocSeconds;
+	double memcpySeconds;
+	double gpuSeconds;
+	double waitSeconds;
+	bool gpuValid;
+};
+
+//Measures upload throughput across transfer sizes, staging strategies, submission granularity and queues. Allocation,
+//memcpy, GPU copy and wait times are reported separately as GB/s percentiles over the repetitions of each case
+class TransferBenchmark
+{
+public:
+	void Initialise(VkPhysicalDevice physicalDevice, VkDevice device, SyncTimeline *timeline, MemoryTracker *tracker);
+
+	//Queues are timeline indices. The first queue added must support graphics, queries are reset on it
+	void AddQueue(const char *name, uint32_t queue, uint32_t familyIndex, bool timestamps);
+
+	//Run the full sweep, print a table and write every case to a CSV file
+	void Run(const std::string &csvPath);
+
+	//Record the same copies on 1 to 8 threads and gather them into one submission, reports the speedup over one thread
+	void RunParallelRecording();
+
+	void Release();
+
+private:
+	struct BenchmarkQueue
+	{
+		const char *name;
+		uint32_t queue;
+		uint32_t familyIndex;
+		VkCommandPool pool;
+		std::vector<VkCommandBuffer> commandBuffers;
+		bool timestamps;
+	};
+
+	//Ring range still being read by a submission
+	struct RingRange
+	{
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		SyncTicket ticket;
+	};
+
+	VkDevice logicalDevice = VK_NULL_HANDLE;
+	SyncTimeline *syncTimeline = nullptr;
+	MemoryTracker *memoryTracker = nullptr;
+	VkPhysicalDeviceMemoryProperties memoryProperties = {};
+	double timestampPeriod = 1.0;
+
+	std::vector<BenchmarkQueue> queues;
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+
+	VkBuffer ringBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory ringMemory = VK_NULL_HANDLE;
+	uint8_t *ringMapped = nullptr;
+	VkDeviceSize ringHead = 0;
+	std::deque<RingRange> ringInFlight;
+
+	bool runSample(BenchmarkQueue &queue, StagingStrategy strategy, VkDeviceSize size, uint32_t submits, const std::vector<uint8_t> &source, TransferSample &sample);
+	VkDeviceSize acquireRingRange(VkDeviceSize size, double &waitSeconds);
+	void resetQueries();
+	VkCommandBuffer commandBuffer(BenchmarkQueue &queue, uint32_t index);
+	void recordSlice(CommandPoolRegistry &registry, uint32_t thread, uint32_t threadCount, VkBuffer srcBuffer, VkBuffer dstBuffer, std::vector<VkCommandBuffer> &recorded);
+
+	bool createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryUsageTag tag, AllocationSite site, VkBuffer &buffer, VkDeviceMemory &memory);
+	void destroyBuffer(VkBuffer buffer, VkDeviceMemory memory);
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+	static const char *strategyName(StagingStrategy strategy);
+	static double percentile(std::vector<double> values, double fraction);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//Single producer single consumer handoff of the newest value without locks. The producer always owns a slot to write
+//and the consumer a slot to read, the third sits between them holding the latest value published. Neither side ever
+//waits, a value the consumer was too slow to take is overwritten by the next one
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : middle(1) {}
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer &operator=(const TripleBuffer&) = delete;
+
+	//Producer side, the slot keeps whatever was written to it three publishes ago
+	T &GetWriteSlot() { return slots[back].value; }
+
+	//Hand the write slot over as the newest value and take the middle slot to write next
+	void Publish()
+	{
+		back = middle.exchange(back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	//Consumer side, take the newest value if one was published since the last call. Returns false and keeps the
+	//current read slot otherwise
+	bool Consume()
+	{
+		if (!(middle.load(std::memory_order_relaxed) & FRESH_BIT))
+		{
+			return false;
+		}
+
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+
+		return true;
+	}
+
+	const T &GetReadSlot() const { return slots[front].value; }
+
+private:
+	static const uint32_t INDEX_MASK = 3;
+	static const uint32_t FRESH_BIT = 4; //Set in middle when it holds a value the consumer has not taken
+
+	//Kept on separate cache lines so the two threads do not contend over neighbouring slots
+	struct alignas(64) Slot
+	{
+		T value;
+	};
+
+	Slot slots[3];
+	uint32_t back = 0; //Producer only
+	uint32_t front = 2; //Consumer only
+	alignas(64) std::atomic<uint32_t> middle;
+};
@@ -0,0 +1,481 @@
+#include "UploadBatch.h"
+
+void UploadBatch::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset)
+{
+	flushBarriers();
+
+	VkBufferCopy copy_region = {};
+	copy_region.srcOffset = srcOffset;
+	copy_region.dstOffset = dstOffset;
+	copy_region.size = size;
+
+	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copy_region);
+	commandCount++;
+}
+
+void UploadBatch::CopyImage(VkImage srcImage, VkImage dstImage, uint32_t width, uint32_t height, VkImageAspectFlags aspect)
+{
+	flushBarriers();
+
+	VkImageSubresourceLayers subresource_layers = {};
+	subresource_layers.aspectMask = aspect;
+	subresource_layers.baseArrayLayer = 0;
+	subresource_layers.mipLevel = 0;
+	subresource_layers.layerCount = 1;
+
+	VkImageCopy copy_region = {};
+	copy_region.srcSubresource = subresource_layers;
+	copy_region.dstSubresource = subresource_layers;
+	copy_region.srcOffset = { 0, 0, 0 };
+	copy_region.dstOffset = { 0, 0, 0 };
+	copy_region.extent.width = width;
+	copy_region.extent.height = height;
+	copy_region.extent.depth = 1;
+
+	vkCmdCopyImage(commandBuffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy_region);
+	commandCount++;
+}
+
+void UploadBatch::BufferBarrier(VkBuffer buffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage, VkDeviceSize offset, VkDeviceSize size)
+{
+	VkBufferMemoryBarrier buffer_barrier = {};
+	buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	buffer_barrier.pNext = nullptr;
+	buffer_barrier.srcAccessMask = srcAccessMask;
+	buffer_barrier.dstAccessMask = dstAccessMask;
+	buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	buffer_barrier.buffer = buffer;
+	buffer_barrier.offset = offset;
+	buffer_barrier.size = size;
+
+	pendingBufferBarriers.push_back(buffer_barrier);
+	pendingSrcStages |= srcStage;
+	pendingDstStages |= dstStage;
+}
+
+void UploadBatch::ImageBarrier(VkImage image, VkImageAspectFlags aspect, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+	VkImageMemoryBarrier image_barrier = {};
+	image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	image_barrier.pNext = nullptr;
+	image_barrier.srcAccessMask = srcAccessMask;
+	image_barrier.dstAccessMask = dstAccessMask;
+	image_barrier.oldLayout = oldLayout;
+	image_barrier.newLayout = newLayout;
+	image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.image = image;
+	image_barrier.subresourceRange.aspectMask = aspect;
+	image_barrier.subresourceRange.baseMipLevel = 0;
+	image_barrier.subresourceRange.levelCount = 1;
+	image_barrier.subresourceRange.baseArrayLayer = 0;
+	image_barrier.subresourceRange.layerCount = 1;
+
+	pendingImageBarriers.push_back(image_barrier);
+	pendingSrcStages |= srcStage;
+	pendingDstStages |= dstStage;
+}
+
+void UploadBatch::ReleaseBuffer(VkBuffer buffer, VkAccessFlags dstAccessMask, VkDeviceSize offset, VkDeviceSize size)
+{
+	if (!context->IsDedicated())
+	{
+		BufferBarrier(buffer, VK_ACCESS_TRANSFER_WRITE_BIT, dstAccessMask, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, offset, size);
+		return;
+	}
+
+	//Release half, the destination access only matters on the acquire
+	BufferBarrier(buffer, VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, offset, size);
+
+	VkBufferMemoryBarrier &release = pendingBufferBarriers.back();
+	release.srcQueueFamilyIndex = context->transferFamily;
+	release.dstQueueFamilyIndex = context->graphicsFamily;
+
+	VkBufferMemoryBarrier acquire = release;
+	acquire.srcAccessMask = 0;
+	acquire.dstAccessMask = dstAccessMask;
+	bufferAcquires.push_back(acquire);
+}
+
+void UploadBatch::ReleaseImage(VkImage image, VkImageAspectFlags aspect, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags dstAccessMask)
+{
+	if (!context->IsDedicated())
+	{
+		ImageBarrier(image, aspect, oldLayout, newLayout, VK_ACCESS_TRANSFER_WRITE_BIT, dstAccessMask, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		return;
+	}
+
+	//The layout change is part of the transfer and must be identical in the release and the acquire
+	ImageBarrier(image, aspect, oldLayout, newLayout, VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+	VkImageMemoryBarrier &release = pendingImageBarriers.back();
+	release.srcQueueFamilyIndex = context->transferFamily;
+	release.dstQueueFamilyIndex = context->graphicsFamily;
+
+	VkImageMemoryBarrier acquire = release;
+	acquire.srcAccessMask = 0;
+	acquire.dstAccessMask = dstAccessMask;
+	imageAcquires.push_back(acquire);
+}
+
+SyncTicket UploadBatch::Submit()
+{
+	if (state != BATCH_RECORDING)
+	{
+		return ticket;
+	}
+
+	flushBarriers();
+
+	//Without a dedicated transfer queue the batch already runs on the graphics family
+	if (!context->IsDedicated())
+	{
+		for (const std::function<void(VkCommandBuffer)> &record : graphicsWork)
+		{
+			record(commandBuffer);
+			commandCount++;
+		}
+		graphicsWork.clear();
+	}
+
+	//Nothing was recorded, skip the round trip
+	if (commandCount == 0 && bufferAcquires.empty() && imageAcquires.empty() && graphicsWork.empty())
+	{
+		vkEndCommandBuffer(commandBuffer);
+		timestampsValid = false;
+		ticket = 0;
+		complete();
+		return ticket;
+	}
+
+	VkQueryPool queryPool = context->timestampQueryPool;
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, firstQuery(timestampPair) + 1);
+	}
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext = nullptr;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &commandBuffer;
+
+	if (!context->IsDedicated())
+	{
+		if (queryPool != VK_NULL_HANDLE)
+		{
+			vkCmdResetQueryPool(commandBuffer, queryPool, firstQuery(1 - timestampPair), 2);
+		}
+
+		vkEndCommandBuffer(commandBuffer);
+		ticket = context->syncTimeline->Submit(context->transferQueue, submit_info);
+	}
+	else
+	{
+		vkEndCommandBuffer(commandBuffer);
+
+		//Release on the transfer queue, then acquire on the graphics queue once the semaphore signals
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &transferCompleteSemaphore;
+
+		context->syncTimeline->Submit(context->transferQueue, submit_info);
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.pNext = nullptr;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(acquireCommandBuffer, &begin_info);
+
+		if (!bufferAcquires.empty() || !imageAcquires.empty())
+		{
+			vkCmdPipelineBarrier(acquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+				(uint32_t)bufferAcquires.size(), bufferAcquires.data(), (uint32_t)imageAcquires.size(), imageAcquires.data());
+		}
+
+		for (const std::function<void(VkCommandBuffer)> &record : graphicsWork)
+		{
+			record(acquireCommandBuffer);
+			commandCount++;
+		}
+		graphicsWork.clear();
+
+		if (queryPool != VK_NULL_HANDLE)
+		{
+			vkCmdResetQueryPool(acquireCommandBuffer, queryPool, firstQuery(1 - timestampPair), 2);
+		}
+
+		vkEndCommandBuffer(acquireCommandBuffer);
+
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkSubmitInfo acquire_submit_info = {};
+		acquire_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquire_submit_info.pNext = nullptr;
+		acquire_submit_info.waitSemaphoreCount = 1;
+		acquire_submit_info.pWaitSemaphores = &transferCompleteSemaphore;
+		acquire_submit_info.pWaitDstStageMask = &waitStage;
+		acquire_submit_info.commandBufferCount = 1;
+		acquire_submit_info.pCommandBuffers = &acquireCommandBuffer;
+
+		ticket = context->syncTimeline->Submit(context->graphicsQueue, acquire_submit_info);
+	}
+
+	state = BATCH_SUBMITTED;
+	context->submitCount++;
+
+	return ticket;
+}
+
+void UploadBatch::Wait()
+{
+	if (state != BATCH_SUBMITTED)
+	{
+		return;
+	}
+
+	context->syncTimeline->Wait(ticket);
+	complete();
+}
+
+bool UploadBatch::Poll()
+{
+	if (state == BATCH_SUBMITTED && context->syncTimeline->IsComplete(ticket))
+	{
+		complete();
+	}
+
+	return state == BATCH_FREE;
+}
+
+bool UploadBatch::GetTimestamps(uint64_t &begin, uint64_t &end) const
+{
+	begin = timestamps[0];
+	end = timestamps[1];
+
+	return timestampsValid;
+}
+
+void UploadBatch::flushBarriers()
+{
+	if (pendingBufferBarriers.empty() && pendingImageBarriers.empty())
+	{
+		return;
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, pendingSrcStages, pendingDstStages, 0, 0, nullptr,
+		(uint32_t)pendingBufferBarriers.size(), pendingBufferBarriers.data(), (uint32_t)pendingImageBarriers.size(), pendingImageBarriers.data());
+
+	pendingBufferBarriers.clear();
+	pendingImageBarriers.clear();
+	pendingSrcStages = 0;
+	pendingDstStages = 0;
+	commandCount++;
+}
+
+void UploadBatch::complete()
+{
+	if (state == BATCH_SUBMITTED)
+	{
+		timestampsValid = false;
+		if (context->timestampQueryPool != VK_NULL_HANDLE)
+		{
+			VkResult result = vkGetQueryPoolResults(context->logicalDevice, context->timestampQueryPool, firstQuery(timestampPair), 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+			timestampsValid = result == VK_SUCCESS;
+
+			//The submission reset the other pair, the one just read is reset by the next use
+			timestampPair = 1 - timestampPair;
+		}
+	}
+
+	bufferAcquires.clear();
+	imageAcquires.clear();
+	state = BATCH_FREE;
+
+	//Callbacks may begin new batches, so run them from a copy after the batch has been freed
+	std::vector<std::function<void()>> callbacks;
+	callbacks.swap(completionCallbacks);
+	for (const std::function<void()> &callback : callbacks)
+	{
+		callback();
+	}
+}
+
+void UploadContext::Initialise(VkDevice device, SyncTimeline *timeline, uint32_t transferQueue, uint32_t transferFamilyIndex, uint32_t graphicsQueue, uint32_t graphicsFamilyIndex, bool timestamps)
+{
+	logicalDevice = device;
+	syncTimeline = timeline;
+	this->transferQueue = transferQueue;
+	this->graphicsQueue = graphicsQueue;
+	transferFamily = transferFamilyIndex;
+	graphicsFamily = graphicsFamilyIndex;
+
+	//Command buffers are reset and re-recorded rather than freed
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.pNext = nullptr;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_info.queueFamilyIndex = transferFamily;
+
+	VkResult result = vkCreateCommandPool(logicalDevice, &pool_info, nullptr, &transferPool);
+	if (result == VK_SUCCESS)
+	{
+		std::cout << "Upload command pool created successfully.\n";
+	}
+
+	pool_info.queueFamilyIndex = graphicsFamily;
+	vkCreateCommandPool(logicalDevice, &pool_info, nullptr, &acquirePool);
+
+	std::array<VkCommandBuffer, UPLOAD_BATCH_COUNT> transferCommandBuffers;
+	std::array<VkCommandBuffer, UPLOAD_BATCH_COUNT> acquireCommandBuffers;
+
+	VkCommandBufferAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocate_info.pNext = nullptr;
+	allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocate_info.commandPool = transferPool;
+	allocate_info.commandBufferCount = UPLOAD_BATCH_COUNT;
+
+	vkAllocateCommandBuffers(logicalDevice, &allocate_info, transferCommandBuffers.data());
+
+	allocate_info.commandPool = acquirePool;
+	vkAllocateCommandBuffers(logicalDevice, &allocate_info, acquireCommandBuffers.data());
+
+	VkSemaphoreCreateInfo semaphore_info = {};
+	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_info.pNext = nullptr;
+	semaphore_info.flags = 0;
+
+	for (uint32_t i = 0; i < UPLOAD_BATCH_COUNT; i++)
+	{
+		UploadBatch &batch = batches[i];
+		batch.context = this;
+		batch.index = i;
+		batch.commandBuffer = transferCommandBuffers[i];
+		batch.acquireCommandBuffer = acquireCommandBuffers[i];
+
+		vkCreateSemaphore(logicalDevice, &semaphore_info, nullptr, &batch.transferCompleteSemaphore);
+	}
+
+	if (!timestamps)
+	{
+		return;
+	}
+
+	VkQueryPoolCreateInfo query_pool_info = {};
+	query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	query_pool_info.pNext = nullptr;
+	query_pool_info.flags = 0;
+	query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	query_pool_info.queryCount = UPLOAD_BATCH_COUNT * 4;
+	query_pool_info.pipelineStatistics = 0;
+
+	result = vkCreateQueryPool(logicalDevice, &query_pool_info, nullptr, &timestampQueryPool);
+	if (result == VK_SUCCESS)
+	{
+		std::cout << "Upload Timestamp Query Pool created successfully.\n";
+	}
+
+	//Queries start out undefined, reset all of them once on the graphics queue
+	VkCommandBuffer resetCommandBuffer = acquireCommandBuffers[0];
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.pNext = nullptr;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(resetCommandBuffer, &begin_info);
+	vkCmdResetQueryPool(resetCommandBuffer, timestampQueryPool, 0, query_pool_info.queryCount);
+	vkEndCommandBuffer(resetCommandBuffer);
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext = nullptr;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &resetCommandBuffer;
+
+	syncTimeline->Wait(syncTimeline->Submit(graphicsQueue, submit_info));
+}
+
+UploadBatch *UploadContext::Begin()
+{
+	UploadBatch *batch = nullptr;
+	UploadBatch *oldest = nullptr;
+
+	for (UploadBatch &candidate : batches)
+	{
+		if (candidate.Poll())
+		{
+			batch = &candidate;
+			break;
+		}
+
+		if (candidate.state == UploadBatch::BATCH_SUBMITTED && (oldest == nullptr || candidate.ticket < oldest->ticket))
+		{
+			oldest = &candidate;
+		}
+	}
+
+	if (batch == nullptr)
+	{
+		if (oldest == nullptr)
+		{
+			std::cout << "Every upload batch is being recorded, submit one before beginning another.\n";
+			return nullptr;
+		}
+
+		oldest->Wait();
+		batch = oldest;
+	}
+
+	vkResetCommandBuffer(batch->commandBuffer, 0);
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.pNext = nullptr;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(batch->commandBuffer, &begin_info);
+
+	if (timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(batch->commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, batch->firstQuery(batch->timestampPair));
+	}
+
+	batch->state = UploadBatch::BATCH_RECORDING;
+	batch->commandCount = 0;
+	batch->graphicsWork.clear();
+
+	return batch;
+}
+
+void UploadContext::PollAll()
+{
+	for (UploadBatch &batch : batches)
+	{
+		batch.Poll();
+	}
+}
+
+void UploadContext::WaitAll()
+{
+	for (UploadBatch &batch : batches)
+	{
+		batch.Wait();
+	}
+}
+
+void UploadContext::Release()
+{
+	WaitAll();
+
+	for (UploadBatch &batch : batches)
+	{
+		vkDestroySemaphore(logicalDevice, batch.transferCompleteSemaphore, nullptr);
+	}
+
+	vkDestroyQueryPool(logicalDevice, timestampQueryPool, nullptr);
+	vkDestroyCommandPool(logicalDevice, acquirePool, nullptr);
+	vkDestroyCommandPool(logicalDevice, transferPool, nullptr);
+}
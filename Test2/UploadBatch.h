@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "SyncTimeline.h"
+#include <iostream>
+#include <vector>
+#include <array>
+#include <functional>
+
+//Batches that can be recorded or in flight at once, Begin waits on the oldest submitted one when all are taken
+const uint32_t UPLOAD_BATCH_COUNT = 4;
+
+class UploadContext;
+
+//Buffer copies, image copies and barriers recorded into one command buffer and submitted once as a single ticket.
+//Barriers are held back and merged into a single vkCmdPipelineBarrier in front of the next copy
+class UploadBatch
+{
+public:
+	void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+	void CopyImage(VkImage srcImage, VkImage dstImage, uint32_t width, uint32_t height, VkImageAspectFlags aspect);
+
+	void BufferBarrier(VkBuffer buffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+	void ImageBarrier(VkImage image, VkImageAspectFlags aspect, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
+
+	//Make a resource written by the batch available to the graphics queue. With a dedicated transfer queue this is a
+	//release here and a matching acquire submitted on the graphics queue once the batch has run. A buffer range can be
+	//handed over while the graphics queue keeps reading the rest of the buffer
+	void ReleaseBuffer(VkBuffer buffer, VkAccessFlags dstAccessMask, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+	void ReleaseImage(VkImage image, VkImageAspectFlags aspect, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags dstAccessMask);
+
+	//Run once the GPU has finished the batch, used to free the staging resources it reads from
+	void OnComplete(std::function<void()> callback) { completionCallbacks.push_back(callback); }
+
+	//Record work that needs the graphics family, such as compute, after every copy and acquire of the batch. Runs at
+	//Submit, into the batch's own command buffer or with a dedicated transfer queue into the acquire command buffer
+	void OnGraphics(std::function<void(VkCommandBuffer)> record) { graphicsWork.push_back(record); }
+
+	//Returns the ticket the batch completes with, later graphics submissions are ordered after it without waiting
+	SyncTicket Submit();
+
+	//Block until the batch has completed
+	void Wait();
+
+	//Returns true once the batch has completed, never blocks
+	bool Poll();
+
+	uint32_t GetCommandCount() const { return commandCount; }
+	SyncTicket GetTicket() const { return ticket; }
+
+	//Start and end of the batch on the GPU in timestamp ticks, valid from completion until the batch is begun again
+	bool GetTimestamps(uint64_t &begin, uint64_t &end) const;
+
+private:
+	friend class UploadContext;
+
+	enum BatchState
+	{
+		BATCH_FREE,
+		BATCH_RECORDING,
+		BATCH_SUBMITTED
+	};
+
+	UploadContext *context = nullptr;
+	uint32_t index = 0;
+	BatchState state = BATCH_FREE;
+	SyncTicket ticket = 0;
+
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE; //On the transfer family
+	VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE; //On the graphics family, only used with a dedicated transfer queue
+	VkSemaphore transferCompleteSemaphore = VK_NULL_HANDLE;
+
+	std::vector<VkBufferMemoryBarrier> pendingBufferBarriers;
+	std::vector<VkImageMemoryBarrier> pendingImageBarriers;
+	VkPipelineStageFlags pendingSrcStages = 0;
+	VkPipelineStageFlags pendingDstStages = 0;
+
+	std::vector<VkBufferMemoryBarrier> bufferAcquires;
+	std::vector<VkImageMemoryBarrier> imageAcquires;
+
+	std::vector<std::function<void()>> completionCallbacks;
+	std::vector<std::function<void(VkCommandBuffer)>> graphicsWork;
+	uint32_t commandCount = 0;
+
+	//Each batch owns two timestamp pairs and alternates between them, the graphics side of a submission resets the
+	//pair the next use will write as transfer-only queues cannot reset queries
+	uint32_t timestampPair = 0;
+	uint64_t timestamps[2] = {};
+	bool timestampsValid = false;
+
+	uint32_t firstQuery(uint32_t pair) const { return index * 4 + pair * 2; }
+	void flushBarriers();
+	void complete();
+};
+
+//Owns the recycled command buffers and semaphores batches are recorded into, submissions go through the sync timeline
+class UploadContext
+{
+public:
+	//Queues are the timeline's queue indices and may be the same, ownership transfers are only recorded when the families differ
+	void Initialise(VkDevice device, SyncTimeline *timeline, uint32_t transferQueue, uint32_t transferFamilyIndex, uint32_t graphicsQueue, uint32_t graphicsFamilyIndex, bool timestamps);
+
+	//Take a free batch and begin recording into it
+	UploadBatch *Begin();
+
+	//Complete every submitted batch the GPU has finished with, without blocking
+	void PollAll();
+
+	//Block until every submitted batch has completed
+	void WaitAll();
+
+	void Release();
+
+	bool IsDedicated() const { return transferFamily != graphicsFamily; }
+	uint32_t GetSubmitCount() const { return (uint32_t)submitCount; }
+
+private:
+	friend class UploadBatch;
+
+	VkDevice logicalDevice = VK_NULL_HANDLE;
+	SyncTimeline *syncTimeline = nullptr;
+	uint32_t transferQueue = 0;
+	uint32_t graphicsQueue = 0;
+	uint32_t transferFamily = UINT32_MAX;
+	uint32_t graphicsFamily = UINT32_MAX;
+
+	VkCommandPool transferPool = VK_NULL_HANDLE;
+	VkCommandPool acquirePool = VK_NULL_HANDLE;
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+
+	std::array<UploadBatch, UPLOAD_BATCH_COUNT> batches;
+	uint64_t submitCount = 0;
+};
@@ -43,106 +43,193 @@ void VulkanBase::InitialiseVulkan()
 
 	glfwSetWindowUserPointer(window, this);
 	glfwSetWindowSizeCallback(window, VulkanBase::windowResize);//GLFW window resize callback function
+	glfwSetKeyCallback(window, VulkanBase::keyPressed);
+	glfwGetWindowSize(window, &windowWidth, &windowHeight);
 
 	CreateInstance();
 	EnumeratePhysicalDevices();
 	CreateSurface();
 	CreateLogicalDevice();
+	syncTimeline.Initialise(logicalDevice, timelineSemaphoreEnabled);
+	graphicsTimeline = syncTimeline.RegisterQueue(graphicsQueue);
+	transferTimeline = dedicatedTransferQueue ? syncTimeline.RegisterQueue(transferQueue) : graphicsTimeline;
+	memoryTracker.Initialise(instance, physicalDevices[0], memoryBudgetEnabled);
+	deviceAllocator.Initialise(physicalDevices[0], logicalDevice, &syncTimeline, graphicsTimeline, graphics_queue_family_index, transferTimeline, &memoryTracker);
+	if (defragmentCheck)
+	{
+		checkDefragmentation(); //Before anything else is allocated so only its own buffers are moved
+	}
+	deviceLocalHeap = memoryTracker.GetHeapIndex(findMemoryType(UINT32_MAX, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+	if (directWriteBuffers)
+	{
+		directWriteMemoryType = findMemoryType(UINT32_MAX, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (directWriteMemoryType != UINT32_MAX)
+		{
+			directWriteHeap = memoryTracker.GetHeapIndex(directWriteMemoryType);
+			std::cout << "Host visible device local memory found, buffers are written in place.\n";
+		}
+	}
+	textureAsset = residencyManager.RegisterAsset(RESIDENT_TEXTURE, TEXTURE_PATH.c_str());
+	modelAsset = residencyManager.RegisterAsset(RESIDENT_MESH, MODEL_PATH.c_str());
+	if (compressedMeshUpload && graphicsCompute)
+	{
+		meshDecoder.Initialise(logicalDevice, "shaders/meshdecode.spv", frameTimestamps, timestampPeriod);
+	}
+	assetLoader.Initialise(0);
+	uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	jobSystem.SetWorkerExit([this]() { drawPools.ReleaseThread(); }); //Workers record secondary buffers from pools of their own
+	jobSystem.Initialise(hardwareThreads > 2 ? hardwareThreads - 2 : 1); //The main and render threads are left their own cores
+	framePacer.Initialise(0.0); //Set once the swapchain's present mode is known
+	RequestAsset(textureAsset);
+	RequestAsset(modelAsset);
+	renderTargetPool.Initialise(physicalDevices[0], logicalDevice, &memoryTracker);
+	renderGraph.Initialise(logicalDevice);
 	CreateSwapchain();
 	CreateSwapchainImageViews();
 	CreateRenderPass();
 	CreateDescriptorSetLayout();
 	LoadShaders();
 	CreateGraphicsPipeline();
-	CreateCommandPool(commandPool, 0); //Create Draw command pool
-	CreateCommandPool(transferPool, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT); //Create Transfer command pool
-	CreateDepthImageResources();
+	transferPools.Initialise(logicalDevice, &syncTimeline, graphics_queue_family_index); //Transfer command pools, created per thread on first use
+	drawPools.Initialise(logicalDevice, &syncTimeline, graphics_queue_family_index);
+	CreateUploadResources();
+	CreateRenderTargets();
 	CreateFramebuffers();
-	CreateTextureImage();
-	CreateTextureImageView();
+
+	//Every startup upload goes into one batch and costs a single round trip. The texture and model are still being
+	//decoded, only their placeholders are uploaded here
+	uploadBatch = uploadContext.Begin();
+
 	CreateTextureSampler();
-	CreateModel();
-	if (multiCopy)
-	{
-		auto copyStart = std::chrono::steady_clock::now();
+	CreatePlaceholders();
+
+	uploadBatch->Submit();
+	uploadBatch->Wait();
+	std::cout << "Startup uploads: " << uploadBatch->GetCommandCount() << " commands in one submission.\n";
+	reportUploadTimestamps(uploadBatch);
+	uploadBatch = nullptr;
+
+	CreateUniformBuffer();
+	CreateDescriptorPool();
+	CreateDescriptorSet();
+	CreateFrameResources();
+
+	//The first snapshot is taken here so the uniforms are valid before any frame is drawn
+	simulationStart = std::chrono::steady_clock::now();
+	UpdateSimulation();
+	consumeSnapshot();
+	UpdateUniformBuffer();
 
-		for (int i = 0; i <= 100; i++)
+	if (transferBenchmark)
+	{
+		TransferBenchmark benchmark;
+		benchmark.Initialise(physicalDevices[0], logicalDevice, &syncTimeline, &memoryTracker);
+		benchmark.AddQueue("graphics", graphicsTimeline, graphics_queue_family_index, frameTimestamps);
+		if (dedicatedTransferQueue)
 		{
-			CreateVertexBuffer();
-			CreateIndexBuffer();
+			benchmark.AddQueue("transfer", transferTimeline, transfer_queue_family_index, uploadTimestamps);
 		}
+		benchmark.Run("transfer_benchmark.csv");
+		benchmark.RunParallelRecording();
+		benchmark.Release();
+	}
+
+	if (compressionBenchmark)
+	{
+		CompressionBenchmark benchmark;
 
-		auto copyEnd = std::chrono::steady_clock::now();
+		int texWidth, texHeight;
+		PixelWriter writePixels = LoadTexture(texWidth, texHeight);
+		std::vector<uint8_t> pixels;
+		if (writePixels)
+		{
+			pixels.resize((size_t)texWidth * texHeight * 4);
+			if (writePixels(pixels.data()))
+			{
+				benchmark.AddInput("texture", std::move(pixels));
+			}
+		}
 
-		auto elapsedTime = std::chrono::duration_cast<std::chrono::duration<double>>(copyEnd - copyStart).count();
+		std::vector<Vertex> modelVertices;
+		std::vector<uint32_t> modelIndices;
+		if (LoadModel(modelVertices, modelIndices))
+		{
+			std::vector<uint8_t> modelBytes(modelVertices.size() * sizeof(Vertex) + modelIndices.size() * sizeof(uint32_t));
+			memcpy(modelBytes.data(), modelVertices.data(), modelVertices.size() * sizeof(Vertex));
+			memcpy(modelBytes.data() + modelVertices.size() * sizeof(Vertex), modelIndices.data(), modelIndices.size() * sizeof(uint32_t));
+			benchmark.AddInput("model", std::move(modelBytes));
+		}
 
-		std::cout << "Time taken to copy 100 model's data to GPU: " << elapsedTime << " seconds.\n";
+		benchmark.Run("compression_benchmark.csv");
 	}
-	else
+
+	if (jobSystemBenchmark)
 	{
-		CreateVertexBuffer();
-		CreateIndexBuffer();
+		JobBenchmark benchmark;
+		benchmark.Run(jobSystem, "job_benchmark.csv");
 	}
-	CreateUniformBuffer();
-	CreateDescriptorPool();
-	CreateDescriptorSet();
-	CreateSemaphores();
-	CreateCommandBuffers();
-	RecordCommandBuffers();
 
-	UpdateUniformBuffer();
+	if (drawRecordingBenchmark)
+	{
+		benchmarkDrawRecording();
+	}
 }
 
 //Termination of program
 VulkanBase::~VulkanBase()
 {
-	vkDeviceWaitIdle(logicalDevice);
+	jobSystem.Release();
+	assetLoader.Release();
+
+	syncTimeline.WaitAll();
+	syncTimeline.Collect();
 
-	vkDestroySemaphore(logicalDevice, renderFinishedSemaphore, nullptr);
-	vkDestroySemaphore(logicalDevice, imageAcquiredSemaphore, nullptr);
+	memoryTracker.ReportHeaps();
+	memoryTracker.WriteSnapshot("memory_snapshot_exit.json");
+
+	for (FrameResources &frame : frameResources)
+	{
+		vkDestroySemaphore(logicalDevice, frame.renderFinishedSemaphore, nullptr);
+		vkDestroySemaphore(logicalDevice, frame.imageAcquiredSemaphore, nullptr);
+		vkDestroyCommandPool(logicalDevice, frame.commandPool, nullptr);
+	}
+	vkDestroyCommandPool(logicalDevice, prerecordedPool, nullptr);
 
 	vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
 
 	vkDestroySampler(logicalDevice, textureSampler, nullptr);
 	vkDestroyImageView(logicalDevice, textureImageView, nullptr);
-	vkFreeMemory(logicalDevice, textureImageMemory, nullptr); //May not be in correct order
-	vkDestroyImage(logicalDevice, textureImage, nullptr); //May not be in correct order
-
-	vkFreeMemory(logicalDevice, uniformBufferMemory, nullptr);
-	vkDestroyBuffer(logicalDevice, uniformBuffer, nullptr);
-	vkFreeMemory(logicalDevice, uniformStagingBufferMemory, nullptr);
-	vkDestroyBuffer(logicalDevice, uniformStagingBuffer, nullptr);
-	vkFreeMemory(logicalDevice, indexBufferMemory, nullptr);
-	vkDestroyBuffer(logicalDevice, indexBuffer, nullptr);
-	vkFreeMemory(logicalDevice, vertexBufferMemory, nullptr);
-	vkDestroyBuffer(logicalDevice, vertexBuffer, nullptr);
-	vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
-	vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-
-	vkDestroyImageView(logicalDevice, multisampleDepthImageView, nullptr);
-	vkFreeMemory(logicalDevice, multisampleDepthImageMemory, nullptr);
-	vkDestroyImage(logicalDevice, multisampleDepthImage, nullptr);
-	vkDestroyImageView(logicalDevice, multisampleColourImageView, nullptr);
-	vkFreeMemory(logicalDevice, multisampleColourImageMemory, nullptr);
-	vkDestroyImage(logicalDevice, multisampleColourImage, nullptr);
-
-	vkDestroyImageView(logicalDevice, depthImageView, nullptr);
-	vkFreeMemory(logicalDevice, depthImageMemory, nullptr);
-	vkDestroyImage(logicalDevice, depthImage, nullptr);
-
-	vkDestroyCommandPool(logicalDevice, transferPool, nullptr);
-	vkFreeCommandBuffers(logicalDevice, commandPool, (uint32_t)commandBuffers.size(), commandBuffers.data());
-	vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
-	for (uint32_t i = 0; i < framebuffers.size(); i++)
-	{
-		vkDestroyFramebuffer(logicalDevice, framebuffers[i], nullptr);
+	vkDestroyImageView(logicalDevice, placeholderTextureView, nullptr);
+
+	if (!uniformDirect)
+	{
+		vkUnmapMemory(logicalDevice, uniformHostBufferMemory);
+		FreeDeviceMemory(uniformHostBufferMemory);
+		vkDestroyBuffer(logicalDevice, uniformHostBuffer, nullptr);
+	}
+	deviceAllocator.ReportBlocks();
+	deviceAllocator.Release();
+
+	renderTargetPool.ReportCommitment();
+	renderTargetPool.Release();
+
+	vkDestroyQueryPool(logicalDevice, timestampQueryPool, nullptr);
+	meshDecoder.Release();
+	uploadContext.Release();
+	syncTimeline.Release();
+	transferPools.Release();
+	drawPools.Release();
+	renderGraph.Release();
+	if (uniformPipeline != graphicsPipeline)
+	{
+		vkDestroyPipeline(logicalDevice, uniformPipeline, nullptr);
 	}
 	vkDestroyPipeline(logicalDevice, graphicsPipeline, nullptr);
 	vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
 	vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
 	vkDestroyShaderModule(logicalDevice, fragmentShaderModule, nullptr);
 	vkDestroyShaderModule(logicalDevice, vertexShaderModule, nullptr);
-	vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
+	vkDestroyShaderModule(logicalDevice, uniformVertexShaderModule, nullptr);
 	for (uint32_t i = 0; i < swapchainImageViews.size(); i++)
 	{
 		vkDestroyImageView(logicalDevice, swapchainImageViews[i], nullptr);
@@ -190,6 +277,15 @@ void VulkanBase::CreateInstance()
 		extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 	}
 
+#ifdef VK_KHR_get_physical_device_properties2
+	//Needed on a 1.0 instance to query memory budgets
+	if (checkInstanceExtensionSupport(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+	{
+		extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		physicalDeviceProperties2Enabled = true;
+	}
+#endif
+
 	VkInstanceCreateInfo instance_create_info = {};
 	instance_create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instance_create_info.pNext = nullptr;
@@ -371,26 +467,80 @@ void VulkanBase::CreateLogicalDevice()
 		exit(-1);
 	}
 
-	VkDeviceQueueCreateInfo queue_info = {};
-	queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	queue_info.pNext = nullptr;
-	queue_info.flags = 0;
-	queue_info.queueFamilyIndex = graphics_queue_family_index;
-	queue_info.queueCount = 1;
+	//A family that can only transfer is backed by the copy engines and runs uploads alongside rendering
+	for (uint32_t i = 0; i < queue_family_count; i++)
+	{
+		VkQueueFlags queueFlags = queueFamilyProperties[i].queueFlags;
+
+		if ((queueFlags & VK_QUEUE_TRANSFER_BIT) != 0 && (queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0)
+		{
+			transfer_queue_family_index = i;
+			dedicatedTransferQueue = true;
+			std::cout << "Dedicated transfer queue found\n";
+			break;
+		}
+	}
+
+	if (!dedicatedTransferQueue)
+	{
+		transfer_queue_family_index = graphics_queue_family_index;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevices[0], &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+	frameTimestamps = queueFamilyProperties[graphics_queue_family_index].timestampValidBits > 0;
+	uploadTimestamps = frameTimestamps && queueFamilyProperties[transfer_queue_family_index].timestampValidBits > 0;
+	graphicsCompute = (queueFamilyProperties[graphics_queue_family_index].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
 
 	float queuePriority = 1.0f;
-	queue_info.pQueuePriorities = &queuePriority;
+
+	std::vector<VkDeviceQueueCreateInfo> queue_infos(dedicatedTransferQueue ? 2 : 1);
+	for (uint32_t i = 0; i < queue_infos.size(); i++)
+	{
+		queue_infos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queue_infos[i].pNext = nullptr;
+		queue_infos[i].flags = 0;
+		queue_infos[i].queueFamilyIndex = i == 0 ? graphics_queue_family_index : transfer_queue_family_index;
+		queue_infos[i].queueCount = 1;
+		queue_infos[i].pQueuePriorities = &queuePriority;
+	}
 
 	std::vector<const char *> extensions;
 	extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+#ifdef VK_EXT_memory_budget
+	if (physicalDeviceProperties2Enabled && checkDeviceExtensionSupport(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+	{
+		extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		memoryBudgetEnabled = true;
+		std::cout << "Memory budget extension enabled.\n";
+	}
+#endif
+
 	//////Device Creation
 	VkDeviceCreateInfo device_info = {};
 	device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	device_info.pNext = nullptr;
+
+#ifdef VK_KHR_timeline_semaphore
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features = {};
+	timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timeline_features.pNext = nullptr;
+	timeline_features.timelineSemaphore = VK_TRUE;
+
+	if (physicalDeviceProperties2Enabled && checkDeviceExtensionSupport(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+	{
+		extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		device_info.pNext = &timeline_features;
+		timelineSemaphoreEnabled = true;
+		std::cout << "Timeline semaphore extension enabled.\n";
+	}
+#endif
+
 	device_info.flags = 0;
-	device_info.queueCreateInfoCount = 1;
-	device_info.pQueueCreateInfos = &queue_info;
+	device_info.queueCreateInfoCount = (uint32_t)queue_infos.size();
+	device_info.pQueueCreateInfos = queue_infos.data();
 	if (enableValidationLayers) {
 		device_info.enabledLayerCount = (uint32_t)validationLayers.size();
 		device_info.ppEnabledLayerNames = validationLayers.data();
@@ -419,6 +569,15 @@ void VulkanBase::CreateLogicalDevice()
 	{
 		vkGetDeviceQueue(logicalDevice, present_queue_family_index, 0, &presentQueue);
 	}
+
+	if (dedicatedTransferQueue)
+	{
+		vkGetDeviceQueue(logicalDevice, transfer_queue_family_index, 0, &transferQueue);
+	}
+	else
+	{
+		transferQueue = graphicsQueue;
+	}
 }
 
 void VulkanBase::CreateSwapchain()
@@ -459,13 +618,11 @@ void VulkanBase::CreateSwapchain()
 		std::cout << "Surface Capabilities retrieved successfully.\n";
 	}
 
-	int width, height;
-	glfwGetWindowSize(window, &width, &height);
 	if (surfaceCapabilities.currentExtent.width == UINT32_MAX)//If the surface size is undefined set our surface size appropriately
 	{
 		//Set the correct surface size for the swapchain for both width and height
-		swapchainExtent.width = width;
-		swapchainExtent.height = height;
+		swapchainExtent.width = windowWidth;
+		swapchainExtent.height = windowHeight;
 
 		if (swapchainExtent.width < surfaceCapabilities.minImageExtent.width) //If the current width is less than the minimum then set it to the minimum capable
 		{
@@ -515,8 +672,20 @@ void VulkanBase::CreateSwapchain()
 		std::cout << "Present Modes assigned successfully.\n";
 	}
 
-	VkPresentModeKHR swapchainPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR; //Guaranteed to be supported - Mailbox could be used for triple-buffering 
-	free(presentModes); //No need for available modes unless anything other than FIFO is used
+	swapchainPresentMode = ChoosePresentMode(presentModes, presentModeCount);
+	free(presentModes);
+	updateFramePacing();
+
+	//Mailbox replaces a queued image rather than waiting for one, it needs a spare image to render into while one is
+	//queued and another displayed
+	if (swapchainPresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+	{
+		desiredNumberOfSwapchainImages++;
+		if (surfaceCapabilities.maxImageCount > 0)
+		{
+			desiredNumberOfSwapchainImages = std::min(desiredNumberOfSwapchainImages, surfaceCapabilities.maxImageCount);
+		}
+	}
 
 	//Swapchain create information
 	VkSwapchainCreateInfoKHR swapchain_info = {};
@@ -545,7 +714,7 @@ void VulkanBase::CreateSwapchain()
 	}
 	swapchain_info.preTransform = preTransform;
 	swapchain_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	swapchain_info.presentMode = swapchainPresentMode; //CAREFUL HERE SHOULD QUERY
+	swapchain_info.presentMode = swapchainPresentMode;
 	swapchain_info.clipped = VK_TRUE;
 
 	if (swapchain_info.imageSharingMode == VK_SHARING_MODE_EXCLUSIVE)
@@ -571,15 +740,18 @@ void VulkanBase::CreateSwapchain()
 		std::cout << "Swapchain creation failed.\n";
 	}
 
+	//Retired rather than destroyed, frames still in flight may be presenting its images
 	if (oldSwapchain)
 	{
-		vkDestroySwapchainKHR(logicalDevice, oldSwapchain, nullptr);
+		syncTimeline.Defer(lastFrameTicket, [this, oldSwapchain]()
+		{
+			vkDestroySwapchainKHR(logicalDevice, oldSwapchain, nullptr);
+		});
 	}
 }
 
 void VulkanBase::CreateSwapchainImageViews()
 {
-	std::vector<VkImage> swapchainImages;
 	uint32_t swapchainImageCount;
 	result = vkGetSwapchainImagesKHR(logicalDevice, swapchain, &swapchainImageCount, nullptr);
 	if (result == VK_SUCCESS)
@@ -606,112 +778,49 @@ void VulkanBase::CreateSwapchainImageViews()
 
 void VulkanBase::CreateRenderPass()
 {
-	//Multisample resolve attachments
-	VkAttachmentDescription multisample_color_attachment = {};
-	multisample_color_attachment.format = swapchainImageFormat;
-	multisample_color_attachment.samples = SAMPLE_COUNT;
-	multisample_color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	multisample_color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	multisample_color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	multisample_color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	multisample_color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	multisample_color_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference multisample_color_reference = {};
-	multisample_color_reference.attachment = 1;
-	multisample_color_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription multisample_depth_attachment = {};
-	multisample_depth_attachment.format = findDepthFormat();
-	multisample_depth_attachment.samples = SAMPLE_COUNT;
-	multisample_depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	multisample_depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	multisample_depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	multisample_depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	multisample_depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	multisample_depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference multisample_depth_reference = {};
-	multisample_depth_reference.attachment = 3;
-	multisample_depth_reference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	//Default Render Pass/Subpass Creation
-	VkAttachmentDescription color_attachment = {};
-	color_attachment.flags = 0;
-	color_attachment.format = swapchainImageFormat;
-	color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE; //CHANGED DEFAULT
-	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference color_attachment_reference = {};
-	color_attachment_reference.attachment = 0;
-	color_attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription depth_attachment = {};
-	depth_attachment.flags = 0;
-	depth_attachment.format = findDepthFormat();
-	depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference depth_attachment_reference = {};
-	depth_attachment_reference.attachment = 2;
-	depth_attachment_reference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	std::array<VkAttachmentReference, 2> resolveReferences{ multisample_color_reference, multisample_depth_reference };
-
-	VkSubpassDescription subpass = {};
-	subpass.flags = 0;
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.inputAttachmentCount = 0;
-	subpass.pInputAttachments = nullptr;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &color_attachment_reference;
-	subpass.pResolveAttachments = resolveReferences.data();
-	subpass.pDepthStencilAttachment = &depth_attachment_reference;
-	subpass.preserveAttachmentCount = 0;
-	subpass.pPreserveAttachments = nullptr;
-
-	VkSubpassDependency subpass_dependency = {};
-	subpass_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	subpass_dependency.dstSubpass = 0;
-	subpass_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpass_dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpass_dependency.srcAccessMask = 0;
-	subpass_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	subpass_dependency.dependencyFlags = 0;
-
-	std::array<VkAttachmentDescription, 4> attachments = { multisample_color_attachment, color_attachment, multisample_depth_attachment, depth_attachment };
-
-	VkRenderPassCreateInfo renderPass_info = {};
-	renderPass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPass_info.pNext = nullptr;
-	renderPass_info.flags = 0;
-	renderPass_info.attachmentCount = (uint32_t)attachments.size();
-	renderPass_info.pAttachments = attachments.data();
-	renderPass_info.subpassCount = 1;
-	renderPass_info.pSubpasses = &subpass;
-	renderPass_info.dependencyCount = 1;
-	renderPass_info.pDependencies = &subpass_dependency;
-
-	result = vkCreateRenderPass(logicalDevice, &renderPass_info, nullptr, &renderPass);
-	if (result == VK_SUCCESS)
-	{
-		std::cout << "Render Pass created successfully.\n";
-	}
+	//The swapchain image is handed over by the acquire semaphore, which is waited on at colour output, and goes back to
+	//the presentation engine. Its previous contents are never needed
+	RenderGraphState acquired = { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 };
+	RenderGraphState presented = { VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 };
+	backbufferImage = renderGraph.ImportImage("backbuffer", swapchainImageFormat, VK_SAMPLE_COUNT_1_BIT, acquired, presented);
+
+	uint32_t multisampleColour = renderGraph.CreateImage("multisample colour", swapchainImageFormat, SAMPLE_COUNT);
+	uint32_t multisampleDepth = renderGraph.CreateImage("multisample depth", findDepthFormat(), SAMPLE_COUNT);
+
+	VkClearValue colourClear = {};
+	colourClear.color = { 0.2f, 0.2f, 0.2f, 0.2f };
+	VkClearValue depthClear = {};
+	depthClear.depthStencil = { 1.0f, 0 };
+
+	//Forward pass, drawn multisampled and resolved into the swapchain image
+	forwardPass = renderGraph.AddPass("Forward");
+	renderGraph.Clear(forwardPass, multisampleColour, GRAPH_COLOUR_ATTACHMENT, colourClear);
+	renderGraph.Use(forwardPass, backbufferImage, GRAPH_RESOLVE_ATTACHMENT);
+	renderGraph.Clear(forwardPass, multisampleDepth, GRAPH_DEPTH_ATTACHMENT, depthClear);
+
+	renderGraph.Compile();
+	renderPass = renderGraph.GetRenderPass(forwardPass);
 }
 
 void VulkanBase::LoadShaders()
 {
-	std::vector<char> vertexShaderCode = readFile("shaders/vert.spv");
+	//The push constant variant is built separately from vertexShaderPush.vert, a missing binary keeps the uniform path
+	std::string vertexShaderPath = "shaders/vert.spv";
+	if (pushConstantTransforms)
+	{
+		std::ifstream variantFile("shaders/vertpush.spv", std::ios::binary);
+		pushTransforms = variantFile.is_open();
+		if (pushTransforms)
+		{
+			vertexShaderPath = "shaders/vertpush.spv";
+		}
+		else
+		{
+			std::cout << "Push constant vertex shader shaders/vertpush.spv not found, transforms are read from the uniform buffer.\n";
+		}
+	}
+
+	std::vector<char> vertexShaderCode = readFile(vertexShaderPath);
 	std::vector<char> fragmentShaderCode = readFile("shaders/frag.spv");
 
 	//Vertex Shader Information
@@ -762,6 +871,21 @@ void VulkanBase::LoadShaders()
 	
 	shaderStages[0] = vertex_stage_info;
 	shaderStages[1] = fragment_stage_info;
+
+	if (pushTransforms)
+	{
+		std::vector<char> uniformShaderCode = readFile("shaders/vert.spv");
+
+		VkShaderModuleCreateInfo uniform_module_info = vertex_module_info;
+		uniform_module_info.codeSize = uniformShaderCode.size();
+		uniform_module_info.pCode = (uint32_t *)uniformShaderCode.data();
+
+		result = vkCreateShaderModule(logicalDevice, &uniform_module_info, nullptr, &uniformVertexShaderModule);
+		if (result == VK_SUCCESS)
+		{
+			std::cout << "Uniform Vertex Shader Module created successfully.\n";
+		}
+	}
 }
 
 void VulkanBase::CreateDescriptorSetLayout()
@@ -824,27 +948,15 @@ void VulkanBase::CreateGraphicsPipeline()
 	//Tessellation
 	//SKIPPED AS TESSELLATION NOT USED
 
-	//Viewport and Scissor
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)swapchainExtent.width;
-	viewport.height = (float)swapchainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swapchainExtent;
-
+	//Viewport and Scissor - Set when recording so the pipeline does not depend on the swapchain extent
 	VkPipelineViewportStateCreateInfo viewport_scissor_state_info = {};
 	viewport_scissor_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewport_scissor_state_info.pNext = nullptr;
 	viewport_scissor_state_info.flags = 0;
 	viewport_scissor_state_info.viewportCount = 1;
-	viewport_scissor_state_info.pViewports = &viewport;
+	viewport_scissor_state_info.pViewports = nullptr;
 	viewport_scissor_state_info.scissorCount = 1;
-	viewport_scissor_state_info.pScissors = &scissor;
+	viewport_scissor_state_info.pScissors = nullptr;
 
 	//Rasterization
 	VkPipelineRasterizationStateCreateInfo rasterizer_state_info = {};
@@ -917,9 +1029,23 @@ void VulkanBase::CreateGraphicsPipeline()
 	color_blend_state_info.blendConstants[3] = 0.0f;
 
 	//Dynamic States - Only set if dynamic state enabled for certain fixed-function features allowing for changes without pipeline recreation
-	//Set to nullptr for now at pipeline creation as no dynamic states are enabled
+	std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamic_state_info = {};
+	dynamic_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamic_state_info.pNext = nullptr;
+	dynamic_state_info.flags = 0;
+	dynamic_state_info.dynamicStateCount = (uint32_t)dynamicStates.size();
+	dynamic_state_info.pDynamicStates = dynamicStates.data();
 
 	VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout };
+
+	//Per-draw transform for the push constant shader variant, harmless to the uniform variant which never reads it
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	push_constant_range.offset = 0;
+	push_constant_range.size = sizeof(PushConstantTransform);
+
 	//Pipeline Layout - Here we can use uniform variables for use in shaders given as descriptor sets. In addition, push constants can be used.
 	VkPipelineLayoutCreateInfo pipeline_layout_info = {};
 	pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -927,8 +1053,8 @@ void VulkanBase::CreateGraphicsPipeline()
 	pipeline_layout_info.flags = 0;
 	pipeline_layout_info.setLayoutCount = 1;
 	pipeline_layout_info.pSetLayouts = setLayouts;
-	pipeline_layout_info.pushConstantRangeCount = 0;
-	pipeline_layout_info.pPushConstantRanges = nullptr;
+	pipeline_layout_info.pushConstantRangeCount = 1;
+	pipeline_layout_info.pPushConstantRanges = &push_constant_range;
 
 	result = vkCreatePipelineLayout(logicalDevice, &pipeline_layout_info, nullptr, &pipelineLayout);
 	if (result == VK_SUCCESS)
@@ -951,7 +1077,7 @@ void VulkanBase::CreateGraphicsPipeline()
 	graphics_pipeline_info.pMultisampleState = &multisample_state_info;
 	graphics_pipeline_info.pDepthStencilState = &depth_stencil_state_info;
 	graphics_pipeline_info.pColorBlendState = &color_blend_state_info;
-	graphics_pipeline_info.pDynamicState = nullptr;
+	graphics_pipeline_info.pDynamicState = &dynamic_state_info;
 	graphics_pipeline_info.layout = pipelineLayout;
 	graphics_pipeline_info.renderPass = renderPass;
 	graphics_pipeline_info.subpass = 0;
@@ -963,44 +1089,37 @@ void VulkanBase::CreateGraphicsPipeline()
 	{
 		std::cout << "Graphics Pipeline created successfully.\n";
 	}
-}
-
-void VulkanBase::CreateFramebuffers()
-{
-	framebuffers.resize(swapchainImageViews.size());
-
-	CreateMultisampleTargets();
 
-	for (uint32_t i = 0; i < framebuffers.size(); i++) 
+	//Prerecorded command buffers outlive the transform, so they need the variant that reads it from the uniform buffer
+	uniformPipeline = graphicsPipeline;
+	if (pushTransforms)
 	{
-		std::array<VkImageView, 4> attachments = { multisampleColourImageView, swapchainImageViews[i], multisampleDepthImageView, depthImageView };
+		VkPipelineShaderStageCreateInfo uniformStages[2] = { shaderStages[0], shaderStages[1] };
+		uniformStages[0].module = uniformVertexShaderModule;
+		graphics_pipeline_info.pStages = uniformStages;
 
-		VkFramebufferCreateInfo framebuffer_info = {};
-		framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebuffer_info.pNext = nullptr;
-		framebuffer_info.flags = 0;
-		framebuffer_info.renderPass = renderPass;
-		framebuffer_info.attachmentCount = (uint32_t)attachments.size();
-		framebuffer_info.pAttachments = attachments.data();
-		framebuffer_info.width = swapchainExtent.width;
-		framebuffer_info.height = swapchainExtent.height;
-		framebuffer_info.layers = 1;
-	
-		result = vkCreateFramebuffer(logicalDevice, &framebuffer_info, nullptr, &framebuffers[i]);
+		result = vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &graphics_pipeline_info, nullptr, &uniformPipeline);
 		if (result == VK_SUCCESS)
 		{
-			std::cout << "Framebuffer " << i << " created successfully.\n";
+			std::cout << "Uniform transform Graphics Pipeline created successfully.\n";
 		}
 	}
 }
 
-void VulkanBase::CreateCommandPool(VkCommandPool &commandpool, VkCommandPoolCreateFlags flags)
+void VulkanBase::CreateFramebuffers()
+{
+	//One framebuffer per swapchain image for each pass, the transient attachments are shared between them
+	renderGraph.SetImportedImages(backbufferImage, swapchainImages, swapchainImageViews);
+	renderGraph.CreateFramebuffers(renderTargetPool, swapchainExtent);
+}
+
+void VulkanBase::CreateCommandPool(VkCommandPool &commandpool, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags)
 {
 	VkCommandPoolCreateInfo command_pool_info = {};
 	command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	command_pool_info.pNext = nullptr;
 	command_pool_info.flags = flags;
-	command_pool_info.queueFamilyIndex = graphics_queue_family_index;
+	command_pool_info.queueFamilyIndex = queueFamilyIndex;
 
 	//Create a command pool to assign command buffers from
 	result = vkCreateCommandPool(logicalDevice, &command_pool_info, nullptr, &commandpool);
@@ -1010,8 +1129,60 @@ void VulkanBase::CreateCommandPool(VkCommandPool &commandpool, VkCommandPoolCrea
 	}
 }
 
-void VulkanBase::CreateModel()
+void VulkanBase::CreateUploadResources()
+{
+	uploadContext.Initialise(logicalDevice, &syncTimeline, transferTimeline, transfer_queue_family_index, graphicsTimeline, graphics_queue_family_index, uploadTimestamps);
+
+	//Frame queries are reset by the command buffers that write them
+	VkQueryPoolCreateInfo query_pool_info = {};
+	query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	query_pool_info.pNext = nullptr;
+	query_pool_info.flags = 0;
+	query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	query_pool_info.queryCount = 2 * maxTimestampedFrames;
+	query_pool_info.pipelineStatistics = 0;
+
+	result = vkCreateQueryPool(logicalDevice, &query_pool_info, nullptr, &timestampQueryPool);
+	if (result == VK_SUCCESS)
+	{
+		std::cout << "Timestamp Query Pool created successfully.\n";
+	}
+}
+
+bool VulkanBase::LoadModel(std::vector<Vertex> &modelVertices, std::vector<uint32_t> &modelIndices) const
 {
+	//The deduplicated vertices and indices are cached after the first parse
+	AssetPackHeader packHeader;
+	std::vector<uint8_t> packData;
+
+	auto readStart = std::chrono::steady_clock::now();
+	if (AssetPack::Read(MODEL_PACK_PATH, packHeader, packData, MODEL_PATH) && packHeader.metadata[2] == sizeof(Vertex) &&
+		packHeader.rawSize == (uint64_t)packHeader.metadata[0] * sizeof(Vertex) + (uint64_t)packHeader.metadata[1] * sizeof(uint32_t))
+	{
+		auto readEnd = std::chrono::steady_clock::now();
+
+		//Other loader threads decode side by side, so the pack decodes on this one
+		std::vector<uint8_t> raw((size_t)packHeader.rawSize);
+		if (AssetPack::Decode(packHeader, packData, raw.data(), 1))
+		{
+			auto decodeEnd = std::chrono::steady_clock::now();
+
+			modelVertices.resize(packHeader.metadata[0]);
+			modelIndices.resize(packHeader.metadata[1]);
+			memcpy(modelVertices.data(), raw.data(), modelVertices.size() * sizeof(Vertex));
+			memcpy(modelIndices.data(), raw.data() + modelVertices.size() * sizeof(Vertex), modelIndices.size() * sizeof(uint32_t));
+
+			double decodeMilliseconds = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(decodeEnd - readEnd).count();
+			std::cout << "Model cache loaded: " << packData.size() << " of " << raw.size() << " bytes, ";
+			std::cout << std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(readEnd - readStart).count() << " milliseconds to read, ";
+			std::cout << decodeMilliseconds << " milliseconds to decompress (" << raw.size() / (decodeMilliseconds * 1e6) << " GB/s).\n";
+
+			return !modelIndices.empty();
+		}
+
+		std::cout << "Model cache " << MODEL_PACK_PATH << " failed to decompress, parsing the model.\n";
+	}
+
 	tinyobj::attrib_t attributes;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
@@ -1020,6 +1191,7 @@ void VulkanBase::CreateModel()
 	if (!LoadObj(&attributes, &shapes, &materials, &error, MODEL_PATH.c_str()))
 	{
 		std::cout << error;
+		return false;
 	}
 	else
 	{
@@ -1049,63 +1221,91 @@ void VulkanBase::CreateModel()
 
 			if (uniqueVertices.count(vertex) == 0)
 			{
-				uniqueVertices[vertex] = (uint32_t)vertices.size();
-				vertices.push_back(vertex);
+				uniqueVertices[vertex] = (uint32_t)modelVertices.size();
+				modelVertices.push_back(vertex);
 			}
 
-			indices.push_back(uniqueVertices[vertex]);
+			modelIndices.push_back(uniqueVertices[vertex]);
 		}
 	}
+
+	if (!modelIndices.empty())
+	{
+		std::vector<uint8_t> raw(modelVertices.size() * sizeof(Vertex) + modelIndices.size() * sizeof(uint32_t));
+		memcpy(raw.data(), modelVertices.data(), modelVertices.size() * sizeof(Vertex));
+		memcpy(raw.data() + modelVertices.size() * sizeof(Vertex), modelIndices.data(), modelIndices.size() * sizeof(uint32_t));
+
+		const uint32_t metadata[4] = { (uint32_t)modelVertices.size(), (uint32_t)modelIndices.size(), sizeof(Vertex), 0 };
+		AssetPack::Write(MODEL_PACK_PATH, metadata, raw.data(), raw.size(), compressAssetCache, MODEL_PATH);
+	}
+
+	return !modelIndices.empty();
 }
 
 void VulkanBase::CreateVertexBuffer()
 {
 	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
 
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	//Map our vertex data to the correct memory buffer
-	void *data;
-	vkMapMemory(logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, vertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(logicalDevice, stagingBufferMemory);
-
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
-
-	copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+	//Each upload has its own staging buffer so copies batched together do not overwrite each other's source
+	vertexAllocation = UploadBuffer(vertices.data(), bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, MEMORY_TAG_VERTEX, ALLOCATION_SITE);
 }
 
 void VulkanBase::CreateIndexBuffer()
 {
 	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 
-	//Map our vertex data to the correct memory buffer
-	void *data;
-	vkMapMemory(logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices.data(), (size_t)bufferSize);
-	vkUnmapMemory(logicalDevice, stagingBufferMemory);
-
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
-
-	copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+	indexAllocation = UploadBuffer(indices.data(), bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, MEMORY_TAG_INDEX, ALLOCATION_SITE);
 }
 
 void VulkanBase::CreateUniformBuffer()
 {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+	//Each frame in flight writes its own region, bound at the device's uniform offset alignment
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevices[0], &properties);
+
+	VkDeviceSize alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+	uniformStride = (sizeof(UniformBufferObject) + alignment - 1) / alignment * alignment;
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		frameResources[i].uniformOffset = uniformStride * i;
+	}
 
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformStagingBuffer, uniformStagingBufferMemory);
+	VkDeviceSize bufferSize = uniformStride * MAX_FRAMES_IN_FLIGHT;
 
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, uniformBuffer, uniformBufferMemory);
+	//Written in place every frame, in device local memory when the CPU can map it and otherwise in host visible memory
+	//the shaders read across the bus. Either way an update is a memcpy with no submission behind it
+	if (!stagedUniformUpdates)
+	{
+		uniformAllocation = CreateDirectBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, MEMORY_TAG_UNIFORM, ALLOCATION_SITE);
+		uniformDirect = uniformAllocation != UINT32_MAX;
+		if (uniformDirect)
+		{
+			return;
+		}
+	}
+
+	VkBufferUsageFlags usage = stagedUniformUpdates ? VK_BUFFER_USAGE_TRANSFER_SRC_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	CreateBuffer(bufferSize, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformHostBuffer, uniformHostBufferMemory, stagedUniformUpdates ? MEMORY_TAG_STAGING : MEMORY_TAG_UNIFORM, ALLOCATION_SITE);
+
+	//Mapped once, coherent memory needs no flush after a write
+	void *data;
+	vkMapMemory(logicalDevice, uniformHostBufferMemory, 0, bufferSize, 0, &data);
+	uniformHostMapped = reinterpret_cast<uint8_t*>(data);
+
+	if (stagedUniformUpdates)
+	{
+		uniformAllocation = CreateDeviceBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, MEMORY_TAG_UNIFORM, ALLOCATION_SITE);
+	}
 }
 
 void VulkanBase::CreateDescriptorPool()
 {
 	std::array<VkDescriptorPoolSize, 2> pool_sizes = {};
 	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	pool_sizes[0].descriptorCount = 1;
+	pool_sizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 	pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	pool_sizes[1].descriptorCount = 1;
+	pool_sizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 	VkDescriptorPoolCreateInfo pool_info = {};
 	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -1113,7 +1313,7 @@ void VulkanBase::CreateDescriptorPool()
 	pool_info.flags = 0;
 	pool_info.poolSizeCount = (uint32_t)pool_sizes.size();
 	pool_info.pPoolSizes = pool_sizes.data();
-	pool_info.maxSets = 1;
+	pool_info.maxSets = MAX_FRAMES_IN_FLIGHT;
 
 	result = vkCreateDescriptorPool(logicalDevice, &pool_info, nullptr, &descriptorPool);
 	if (result == VK_SUCCESS)
@@ -1124,34 +1324,47 @@ void VulkanBase::CreateDescriptorPool()
 
 void VulkanBase::CreateDescriptorSet()
 {
-	VkDescriptorSetLayout layouts[] = { descriptorSetLayout };
+	std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+	layouts.fill(descriptorSetLayout);
+
 	VkDescriptorSetAllocateInfo allocate_info = {};
 	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocate_info.pNext = nullptr;
 	allocate_info.descriptorPool = descriptorPool;
-	allocate_info.descriptorSetCount = 1;
-	allocate_info.pSetLayouts = layouts;
+	allocate_info.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+	allocate_info.pSetLayouts = layouts.data();
 
-	result = vkAllocateDescriptorSets(logicalDevice, &allocate_info, &descriptorSet);
+	std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptorSets;
+	result = vkAllocateDescriptorSets(logicalDevice, &allocate_info, descriptorSets.data());
 	if (result == VK_SUCCESS)
 	{
-		std::cout << "Descriptor Set allocated successfully.\n";
+		std::cout << MAX_FRAMES_IN_FLIGHT << " Descriptor Sets allocated successfully.\n";
+	}
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		frameResources[i].descriptorSet = descriptorSets[i];
+		WriteDescriptorSet(frameResources[i]);
 	}
+}
 
+void VulkanBase::WriteDescriptorSet(FrameResources &frame)
+{
+	//Every frame has a set of its own, identical apart from the uniform region
 	VkDescriptorBufferInfo descriptor_buffer_info = {};
-	descriptor_buffer_info.buffer = uniformBuffer;
-	descriptor_buffer_info.offset = 0;
+	descriptor_buffer_info.buffer = uniformAllocation != UINT32_MAX ? deviceAllocator.GetBuffer(uniformAllocation) : uniformHostBuffer;
+	descriptor_buffer_info.offset = frame.uniformOffset;
 	descriptor_buffer_info.range = sizeof(UniformBufferObject);
 
 	VkDescriptorImageInfo descriptor_image_info = {};
 	descriptor_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	descriptor_image_info.imageView = textureImageView;
+	descriptor_image_info.imageView = residencyManager.IsResident(textureAsset) ? textureImageView : placeholderTextureView;
 	descriptor_image_info.sampler = textureSampler;
 
 	std::array<VkWriteDescriptorSet, 2> descriptor_writes = {};
 	descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptor_writes[0].pNext = nullptr;
-	descriptor_writes[0].dstSet = descriptorSet;
+	descriptor_writes[0].dstSet = frame.descriptorSet;
 	descriptor_writes[0].dstBinding = 0;
 	descriptor_writes[0].dstArrayElement = 0;
 	descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -1162,7 +1375,7 @@ void VulkanBase::CreateDescriptorSet()
 
 	descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptor_writes[1].pNext = nullptr;
-	descriptor_writes[1].dstSet = descriptorSet;
+	descriptor_writes[1].dstSet = frame.descriptorSet;
 	descriptor_writes[1].dstBinding = 1;
 	descriptor_writes[1].dstArrayElement = 0;
 	descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -1172,35 +1385,47 @@ void VulkanBase::CreateDescriptorSet()
 	descriptor_writes[1].pTexelBufferView = nullptr;
 
 	vkUpdateDescriptorSets(logicalDevice, (uint32_t)descriptor_writes.size(), descriptor_writes.data(), 0, nullptr);
+
+	frame.descriptorVersion = descriptorVersion;
 }
 
-void VulkanBase::CreateDepthImageResources()
+void VulkanBase::CreateRenderTargets()
 {
-	VkFormat depthFormat = findDepthFormat();
+	//Targets still large enough for the new extent are handed back unchanged, only missing ones are allocated
+	renderTargetPool.BeginRebuild();
 
-	CreateImage(swapchainExtent.width, swapchainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_SAMPLE_COUNT_1_BIT, depthImage, depthImageMemory);
+	renderGraph.RequestTargets(renderTargetPool, swapchainExtent);
 
-	CreateImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, depthImageView);
+	//Targets idle for several rebuilds are destroyed, so the frames that last drew into them must complete first. Most
+	//resizes destroy nothing and never wait
+	if (renderTargetPool.HasExpiringTargets())
+	{
+		syncTimeline.Wait(lastFrameTicket);
+	}
 
-	transitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+	renderTargetPool.Allocate();
+	renderTargetPool.ReportCommitment();
 }
 
-void VulkanBase::CreateTextureImage()
+void VulkanBase::UploadTextureImage(const stbi_uc *pixels, int texWidth, int texHeight, uint32_t &imageAllocation)
 {
-	int texWidth, texHeight, texChannels;
-	stbi_uc *pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
+	size_t pixelBytes = (size_t)texWidth * texHeight * 4;
 
-	if (!pixels)
+	UploadTextureImage(texWidth, texHeight, [pixels, pixelBytes](uint8_t *destination)
 	{
-		std::cout << "Failed to load texture.\n";
-	}
+		memcpy(destination, pixels, pixelBytes);
+		return true;
+	}, imageAllocation);
+}
+
+void VulkanBase::UploadTextureImage(int texWidth, int texHeight, const PixelWriter &writePixels, uint32_t &imageAllocation)
+{
+	VkDeviceSize imageSize = texWidth * texHeight * 4;
 
 	VkImage stagingImage = VK_NULL_HANDLE;
 	VkDeviceMemory stagingImageMemory = VK_NULL_HANDLE;
 	
-	CreateImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_LINEAR, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_SAMPLE_COUNT_1_BIT, stagingImage, stagingImageMemory);
+	CreateImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_LINEAR, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_SAMPLE_COUNT_1_BIT, stagingImage, stagingImageMemory, MEMORY_TAG_STAGING, ALLOCATION_SITE);
 
 	VkImageSubresource image_subresource = {};
 	image_subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -1211,17 +1436,22 @@ void VulkanBase::CreateTextureImage()
 	vkGetImageSubresourceLayout(logicalDevice, stagingImage, &image_subresource, &stagingImageLayout);
 
 	void *data;
-	vkMapMemory(logicalDevice, stagingImageMemory, 0, imageSize, 0, &data);
+	vkMapMemory(logicalDevice, stagingImageMemory, 0, VK_WHOLE_SIZE, 0, &data);
 
+	//Tightly packed staging rows are written in place, padded rows go through a packed copy first
+	bool written;
 	if (stagingImageLayout.rowPitch == texWidth * 4)
 	{
-		memcpy(data, pixels, (size_t)imageSize);
+		written = writePixels(reinterpret_cast<uint8_t*>(data) + stagingImageLayout.offset);
 	}
 	else
 	{
-		uint8_t *dataBytes = reinterpret_cast<uint8_t*>(data);
+		std::vector<uint8_t> pixels((size_t)imageSize);
+		written = writePixels(pixels.data());
 
-		for (int u = 0; u < texHeight; u++)
+		uint8_t *dataBytes = reinterpret_cast<uint8_t*>(data) + stagingImageLayout.offset;
+
+		for (int u = 0; written && u < texHeight; u++)
 		{
 			memcpy(&dataBytes[u * stagingImageLayout.rowPitch], &pixels[u * texWidth * 4], texWidth * 4);
 		}
@@ -1229,23 +1459,67 @@ void VulkanBase::CreateTextureImage()
 
 	vkUnmapMemory(logicalDevice, stagingImageMemory);
 
-	stbi_image_free(pixels);
+	if (!written)
+	{
+		std::cout << "Failed to write texture pixels.\n";
+		imageAllocation = UINT32_MAX;
+		FreeDeviceMemory(stagingImageMemory);
+		vkDestroyImage(logicalDevice, stagingImage, nullptr);
+		return;
+	}
+
+	VkImageCreateInfo image_info = {};
+	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_info.pNext = nullptr;
+	image_info.flags = 0;
+	image_info.imageType = VK_IMAGE_TYPE_2D;
+	image_info.extent.width = texWidth;
+	image_info.extent.height = texWidth;
+	image_info.extent.depth = 1;
+	image_info.mipLevels = 1;
+	image_info.arrayLayers = 1;
+	image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+	image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+
+	imageAllocation = CreateDeviceImage(image_info, VK_IMAGE_ASPECT_COLOR_BIT, MEMORY_TAG_TEXTURE, ALLOCATION_SITE);
+	if (imageAllocation == UINT32_MAX)
+	{
+		FreeDeviceMemory(stagingImageMemory);
+		vkDestroyImage(logicalDevice, stagingImage, nullptr);
+		return;
+	}
 
-	CreateImage(texWidth, texWidth, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_SAMPLE_COUNT_1_BIT, textureImage, textureImageMemory);
+	VkImage textureImage = deviceAllocator.GetImage(imageAllocation);
 
-	transitionImageLayout(stagingImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_PREINITIALIZED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-	transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_PREINITIALIZED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	copyImage(stagingImage, textureImage, texWidth, texHeight);
-	
-	transitionImageLayout(textureImage, VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	//Transitions, copy and the hand over to the graphics queue all run on the upload queue
+	UploadBatch *batch = beginUpload();
 
-	vkFreeMemory(logicalDevice, stagingImageMemory, nullptr);
-	vkDestroyImage(logicalDevice, stagingImage, nullptr);
+	batch->ImageBarrier(stagingImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_PREINITIALIZED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_HOST_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+	batch->ImageBarrier(textureImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_PREINITIALIZED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_HOST_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+	batch->CopyImage(stagingImage, textureImage, texWidth, texHeight, VK_IMAGE_ASPECT_COLOR_BIT);
+	batch->ReleaseImage(textureImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+	deviceAllocator.BeginWrite(imageAllocation);
+
+	uint32_t writtenAllocation = imageAllocation;
+	batch->OnComplete([this, stagingImage, stagingImageMemory, writtenAllocation]()
+	{
+		FreeDeviceMemory(stagingImageMemory);
+		vkDestroyImage(logicalDevice, stagingImage, nullptr);
+		deviceAllocator.EndWrite(writtenAllocation);
+	});
+
+	endUpload(batch);
+
+	deviceAllocator.SetImageLayout(imageAllocation, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
 void VulkanBase::CreateTextureImageView()
 {
-	CreateImageView(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, textureImageView);
+	CreateImageView(deviceAllocator.GetImage(textureAllocation), VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, textureImageView);
 }
 
 void VulkanBase::CreateTextureSampler()
@@ -1277,117 +1551,675 @@ void VulkanBase::CreateTextureSampler()
 	}
 }
 
-void VulkanBase::CreateCommandBuffers()
+void VulkanBase::CreateFrameResources()
 {
-	//Check there are no existing command buffers allocated
-	if (commandBuffers.size() > 0)
-	{
-		vkFreeCommandBuffers(logicalDevice, commandPool, (uint32_t)commandBuffers.size(), commandBuffers.data());
-	}
-
-	//Allocate command buffer memory from command pool
-	commandBuffers.resize(framebuffers.size());
-
-	//Info for an allocated command buffer from the created command pool
-	VkCommandBufferAllocateInfo command_buffer_info = {};
-	command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	command_buffer_info.pNext = nullptr;
-	command_buffer_info.commandPool = commandPool;
-	command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; //Enum to 0
-	command_buffer_info.commandBufferCount = (uint32_t)commandBuffers.size(); //Amount needs to be in accordance with amount in commandBuffer vector
+	VkSemaphoreCreateInfo semaphore_info = {};
+	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_info.pNext = nullptr;
+	semaphore_info.flags = 0;
 
-	result = vkAllocateCommandBuffers(logicalDevice, &command_buffer_info, commandBuffers.data()); //Allocated buffers must match the bufferCount in info
-	if (result == VK_SUCCESS)
+	//Resources for the most frames that can be in flight, framesInFlight chooses how many of them are cycled through
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		std::cout << command_buffer_info.commandBufferCount << " Command Buffer allocated successfully.\n";
-	}
-}
+		FrameResources &frame = frameResources[i];
 
-void VulkanBase::RecordCommandBuffers()
-{
-	/////Recording for command buffers - IMPORTANT HERE FOR MULTI-THREAD IMPLEMENTATION, MULTIPLE RECORDINGS ACROSS DIFFERENT THREADS
+		result = vkCreateSemaphore(logicalDevice, &semaphore_info, nullptr, &frame.imageAcquiredSemaphore);
+		if (result == VK_SUCCESS)
+		{
+			std::cout << "Image Acquired Semaphore created successfully.\n";
+		}
+		result = vkCreateSemaphore(logicalDevice, &semaphore_info, nullptr, &frame.renderFinishedSemaphore);
+		if (result == VK_SUCCESS)
+		{
+			std::cout << "Render Finished Semaphore created successfully.\n";
+		}
 
-	for (uint32_t i = 0; i < commandBuffers.size(); i++)
-	{
-		VkCommandBufferBeginInfo command_buffer_begin_info = {};
-		command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		command_buffer_begin_info.pNext = nullptr;
-		command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-		command_buffer_begin_info.pInheritanceInfo = nullptr; //Used for secondary command buffers
+		//Command buffers are recorded once and reset with the whole pool
+		CreateCommandPool(frame.commandPool, graphics_queue_family_index, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+		VkCommandBufferAllocateInfo command_buffer_info = {};
+		command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		command_buffer_info.pNext = nullptr;
+		command_buffer_info.commandPool = frame.commandPool;
+		command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; //Enum to 0
+		command_buffer_info.commandBufferCount = 1;
 
-		result = vkBeginCommandBuffer(commandBuffers[i], &command_buffer_begin_info);
+		result = vkAllocateCommandBuffers(logicalDevice, &command_buffer_info, &frame.commandBuffer);
 		if (result == VK_SUCCESS)
 		{
-			std::cout << "Begin Recording Successful.\n";
+			std::cout << "Frame " << i << " Command Buffer allocated successfully.\n";
 		}
 
-		VkRenderPassBeginInfo renderpass_begin_info = {};
-		renderpass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderpass_begin_info.pNext = nullptr;
-		renderpass_begin_info.renderPass = renderPass;
-		renderpass_begin_info.framebuffer = framebuffers[i];
-		renderpass_begin_info.renderArea.offset.x = 0;
-		renderpass_begin_info.renderArea.offset.y = 0;
-		renderpass_begin_info.renderArea.extent.width = swapchainExtent.width;
-		renderpass_begin_info.renderArea.extent.height = swapchainExtent.height;
-
-		std::array<VkClearValue, 3> clearValues = {};
-		clearValues[0].color = { 0.2f, 0.2f, 0.2f, 0.2f };
-		clearValues[1].color = { 0.2f, 0.2f, 0.2f, 0.2f };
-		clearValues[2].depthStencil = { 1.0f, 0 };
-		renderpass_begin_info.clearValueCount = (uint32_t)clearValues.size();
-		renderpass_begin_info.pClearValues = clearValues.data();
+		frame.ticket = 0;
+		frame.timestamped = false;
+		frame.recordingMode = recordingMode;
+	}
 
-		vkCmdBeginRenderPass(commandBuffers[i], &renderpass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+	//Prerecorded buffers for every frame and swapchain image, allocated as images are first drawn to
+	CreateCommandPool(prerecordedPool, graphics_queue_family_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 
-		vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	currentFrame = 0;
+	lastFrameStart = std::chrono::steady_clock::now();
+}
 
-		VkBuffer vertexBuffers[] = { vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+VkCommandBuffer VulkanBase::RecordFrameCommands(FrameResources &frame, uint32_t imageIndex)
+{
+	auto recordStart = std::chrono::steady_clock::now();
 
-		vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	uint32_t frameIndex = (uint32_t)(&frame - frameResources.data());
+	frame.timestamped = frameTimestamps && frameIndex < maxTimestampedFrames;
+	frame.recordingMode = recordingMode;
 
-		vkCmdDrawIndexed(commandBuffers[i], (uint32_t)indices.size(), 1, 0, 0, 0);
+	RecordingStats &stats = recordingStats[recordingMode];
+	VkCommandBuffer commandBuffer = frame.commandBuffer;
 
-		vkCmdEndRenderPass(commandBuffers[i]);
+	if (recordingMode == RECORD_PRERECORDED)
+	{
+		if (frame.prerecordedBuffers.size() <= imageIndex)
+		{
+			VkCommandBufferAllocateInfo command_buffer_info = {};
+			command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			command_buffer_info.pNext = nullptr;
+			command_buffer_info.commandPool = prerecordedPool;
+			command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			command_buffer_info.commandBufferCount = imageIndex + 1 - (uint32_t)frame.prerecordedBuffers.size();
+
+			std::vector<VkCommandBuffer> added(command_buffer_info.commandBufferCount);
+			vkAllocateCommandBuffers(logicalDevice, &command_buffer_info, added.data());
+			frame.prerecordedBuffers.insert(frame.prerecordedBuffers.end(), added.begin(), added.end());
+			frame.prerecordedVersions.resize(frame.prerecordedBuffers.size(), 0);
+		}
 
-		result = vkEndCommandBuffer(commandBuffers[i]);
-		if (result == VK_SUCCESS)
+		//Replayed until something it draws changes. Only this frame submits its buffers and its last submission has
+		//completed, so the buffer can be recorded again without waiting. The transform cannot be pushed, it changes
+		//every frame while the buffer does not
+		commandBuffer = frame.prerecordedBuffers[imageIndex];
+		if (frame.prerecordedVersions[imageIndex] != drawContentVersion)
 		{
-			std::cout << "End Recording Successful.\n";
+			FrameDrawState state = gatherDrawState(frame, imageIndex, 1 + stressCopyCount, false);
+			recordPrimary(commandBuffer, VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT, frame, state, imageIndex, 0);
+			frame.prerecordedVersions[imageIndex] = drawContentVersion;
+
+			stats.recordedCount++;
+			stats.drawCount += state.drawCount;
 		}
 	}
+	else
+	{
+		//The draws are recorded across the job system's threads first, the primary buffer only begins the render pass
+		//and executes them
+		FrameDrawState state = gatherDrawState(frame, imageIndex, 1 + stressCopyCount, pushTransforms);
+		uint32_t secondaryCount = secondaryCommandBuffers ? recordSecondaryBuffers(state) : 0;
+		recordPrimary(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, frame, state, imageIndex, secondaryCount);
+
+		stats.recordedCount++;
+		stats.drawCount += state.drawCount;
+		stats.secondaryCount += secondaryCount;
+	}
+
+	auto recordEnd = std::chrono::steady_clock::now();
+	stats.recordTimeSum += std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(recordEnd - recordStart).count();
+	stats.frameCount++;
+
+	return commandBuffer;
 }
 
-void VulkanBase::CreateSemaphores()
+void VulkanBase::recordPrimary(VkCommandBuffer commandBuffer, VkCommandBufferUsageFlags usage, const FrameResources &frame, const FrameDrawState &state, uint32_t imageIndex, uint32_t secondaryCount)
 {
-	VkSemaphoreCreateInfo semaphore_info = {};
-	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	semaphore_info.pNext = nullptr;
-	semaphore_info.flags = 0;
+	uint32_t frameIndex = (uint32_t)(&frame - frameResources.data());
+
+	VkCommandBufferBeginInfo command_buffer_begin_info = {};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.pNext = nullptr;
+	command_buffer_begin_info.flags = usage;
+	command_buffer_begin_info.pInheritanceInfo = nullptr; //Used for secondary command buffers
 
-	result = vkCreateSemaphore(logicalDevice, &semaphore_info, nullptr, &imageAcquiredSemaphore);
+	result = vkBeginCommandBuffer(commandBuffer, &command_buffer_begin_info);
 	if (result == VK_SUCCESS)
 	{
-		std::cout << "Image Acquired Semaphore created successfully.\n";
+#ifdef DEBUG
+		std::cout << "Begin Recording Successful.\n";
+#endif // DEBUG
 	}
-	result = vkCreateSemaphore(logicalDevice, &semaphore_info, nullptr, &renderFinishedSemaphore);
-	if (result == VK_SUCCESS)
+
+	if (frame.timestamped)
 	{
-		std::cout << "Render Finished Semaphore created successfully.\n";
+		vkCmdResetQueryPool(commandBuffer, timestampQueryPool, frameIndex * 2, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, frameIndex * 2);
+	}
+
+	//The graph begins and ends the render pass and issues whatever barriers the passes around it need
+	if (secondaryCount > 0)
+	{
+		renderGraph.SetRecorder(forwardPass, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, [this, secondaryCount](VkCommandBuffer passCommandBuffer)
+		{
+			vkCmdExecuteCommands(passCommandBuffer, secondaryCount, secondaryBuffers.data());
+		});
+	}
+	else
+	{
+		renderGraph.SetRecorder(forwardPass, VK_SUBPASS_CONTENTS_INLINE, [this, &state](VkCommandBuffer passCommandBuffer)
+		{
+			recordDraws(passCommandBuffer, state, 0, state.drawCount);
+		});
+	}
+
+	renderGraph.Execute(commandBuffer, imageIndex);
+	renderGraph.SetRecorder(forwardPass, VK_SUBPASS_CONTENTS_INLINE, nullptr); //Nothing captured outlives the recording
+
+	if (frame.timestamped)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, frameIndex * 2 + 1);
+	}
+
+	result = vkEndCommandBuffer(commandBuffer);
+	if (result == VK_SUCCESS)
+	{
+#ifdef DEBUG
+		std::cout << "End Recording Successful.\n";
+#endif // DEBUG
+	}
+}
+
+FrameDrawState VulkanBase::gatherDrawState(const FrameResources &frame, uint32_t imageIndex, uint32_t copyCount, bool pushed)
+{
+	//An evicted model is drawn as its bounding box until it has been uploaded again
+	bool modelResident = residencyManager.IsResident(modelAsset);
+
+	FrameDrawState state = {};
+	state.framebuffer = renderGraph.GetFramebuffer(forwardPass, imageIndex);
+	state.descriptorSet = frame.descriptorSet;
+	state.vertexBuffer = deviceAllocator.GetBuffer(modelResident ? vertexAllocation : placeholderVertexAllocation);
+	state.indexBuffer = deviceAllocator.GetBuffer(modelResident ? indexAllocation : placeholderIndexAllocation);
+	state.indexCount = modelResident ? (uint32_t)indices.size() : placeholderIndexCount;
+	state.chunkDraws = nullptr;
+	state.drawsPerCopy = 1;
+
+	//A streamed model draws each resident chunk from its slot in the pool buffers
+	if (modelResident && chunkedModel)
+	{
+		state.vertexBuffer = deviceAllocator.GetBuffer(chunkVertexAllocation);
+		state.indexBuffer = deviceAllocator.GetBuffer(chunkIndexAllocation);
+		state.chunkDraws = &chunkStreamer.GetDrawList();
+		state.drawsPerCopy = (uint32_t)state.chunkDraws->size();
+	}
+
+	state.drawCount = modelHidden ? 0 : state.drawsPerCopy * copyCount;
+	state.gridWidth = std::max(1u, (uint32_t)std::ceil(std::sqrt((double)copyCount)));
+	state.pipeline = pushed ? graphicsPipeline : uniformPipeline;
+	state.pushTransforms = pushed;
+	state.modelViewProjection = frameModelViewProjection;
+	state.materialIndex = frameHandoff.GetReadSlot().materialIndex;
+
+	return state;
+}
+
+void VulkanBase::recordDraws(VkCommandBuffer commandBuffer, const FrameDrawState &state, uint32_t firstDraw, uint32_t lastDraw)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.pipeline);
+
+	//Dynamic state is not inherited from the primary buffer, every secondary buffer sets its own
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)swapchainExtent.width;
+	viewport.height = (float)swapchainExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = swapchainExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	VkBuffer vertexBuffers[] = { state.vertexBuffer };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, state.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &state.descriptorSet, 0, nullptr);
+
+	uint32_t pushedCopy = UINT32_MAX;
+	for (uint32_t draw = firstDraw; draw < lastDraw; draw++)
+	{
+		//Recorded into the command buffer itself, so a draw's transform costs no buffer write or descriptor. Every draw
+		//of one copy shares the transform and its single material
+		uint32_t copy = draw / state.drawsPerCopy;
+		if (state.pushTransforms && copy != pushedCopy)
+		{
+			glm::vec3 offset((copy % state.gridWidth) * STRESS_GRID_SPACING, (copy / state.gridWidth) * STRESS_GRID_SPACING, 0.0f);
+
+			PushConstantTransform transform = {};
+			transform.mvp = state.modelViewProjection * glm::translate(glm::mat4(1.0f), offset);
+			transform.materialIndex = state.materialIndex;
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(transform), &transform);
+			pushedCopy = copy;
+		}
+
+		if (state.chunkDraws)
+		{
+			const ChunkDraw &chunk = (*state.chunkDraws)[draw % state.drawsPerCopy];
+			vkCmdDrawIndexed(commandBuffer, chunk.indexCount, 1, chunk.slot * chunkSlotIndexCount, (int32_t)(chunk.slot * chunkSlotVertexCount), 0);
+		}
+		else
+		{
+			vkCmdDrawIndexed(commandBuffer, state.indexCount, 1, 0, 0, 0);
+		}
+	}
+}
+
+uint32_t VulkanBase::recordSecondaryBuffers(const FrameDrawState &state)
+{
+	if (state.drawCount == 0)
+	{
+		return 0;
+	}
+
+	//A couple of buffers per thread lets threads that finish early take another, small frames stay in one buffer
+	uint32_t threadCount = jobSystem.GetWorkerCount() + 1;
+	uint32_t bufferCount = std::max(1u, std::min(state.drawCount / SECONDARY_MIN_DRAWS, threadCount * SECONDARY_BUFFERS_PER_THREAD));
+	if (secondaryBuffers.size() < bufferCount)
+	{
+		secondaryBuffers.resize(bufferCount);
+	}
+
+	VkCommandBufferInheritanceInfo inheritance_info = {};
+	inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance_info.pNext = nullptr;
+	inheritance_info.renderPass = renderPass;
+	inheritance_info.subpass = 0;
+	inheritance_info.framebuffer = state.framebuffer;
+	inheritance_info.occlusionQueryEnable = VK_FALSE;
+	inheritance_info.queryFlags = 0;
+	inheritance_info.pipelineStatistics = 0;
+
+	VkCommandBufferBeginInfo command_buffer_begin_info = {};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.pNext = nullptr;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	command_buffer_begin_info.pInheritanceInfo = &inheritance_info;
+
+	//Each buffer comes from a pool of the thread recording it, command pools may only be used by one thread at a time
+	jobSystem.Wait(jobSystem.ParallelFor(0, bufferCount, 1, [&](uint32_t first, uint32_t last)
+	{
+		for (uint32_t i = first; i < last; i++)
+		{
+			VkCommandBuffer commandBuffer = drawPools.Allocate(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+			vkBeginCommandBuffer(commandBuffer, &command_buffer_begin_info);
+
+			uint32_t firstDraw = (uint32_t)((uint64_t)state.drawCount * i / bufferCount);
+			uint32_t lastDraw = (uint32_t)((uint64_t)state.drawCount * (i + 1) / bufferCount);
+			recordDraws(commandBuffer, state, firstDraw, lastDraw);
+
+			vkEndCommandBuffer(commandBuffer);
+			secondaryBuffers[i] = commandBuffer;
+		}
+	}));
+
+	return bufferCount;
+}
+
+void VulkanBase::benchmarkDrawRecording()
+{
+	uint32_t originalWorkers = jobSystem.GetWorkerCount();
+	FrameDrawState state = gatherDrawState(frameResources[0], 0, DRAW_BENCHMARK_COPIES, pushTransforms);
+
+	//Nothing recorded here is submitted, the pools are handed back against work that has already been submitted
+	SyncTicket submitted = syncTimeline.GetLastSubmitted(graphicsTimeline);
+
+	//Odd repetition counts, the middle time
+	auto median = [](std::vector<double> times)
+	{
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	};
+
+	std::ofstream csv("draw_recording_benchmark.csv", std::ios::trunc);
+	csv << "mode,threads,secondary_buffers,milliseconds,speedup,efficiency\n";
+
+	std::cout << "\n---DRAW RECORDING--- (" << state.drawCount << " draws, median of " << DRAW_BENCHMARK_REPETITIONS << ")\n";
+
+	//The whole frame in one buffer on this thread, as when recording inline
+	VkCommandBufferInheritanceInfo inheritance_info = {};
+	inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance_info.pNext = nullptr;
+	inheritance_info.renderPass = renderPass;
+	inheritance_info.subpass = 0;
+	inheritance_info.framebuffer = state.framebuffer;
+
+	VkCommandBufferBeginInfo command_buffer_begin_info = {};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.pNext = nullptr;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	command_buffer_begin_info.pInheritanceInfo = &inheritance_info;
+
+	std::vector<double> inlineTimes;
+	for (uint32_t r = 0; r < DRAW_BENCHMARK_REPETITIONS; r++)
+	{
+		auto recordStart = std::chrono::steady_clock::now();
+
+		VkCommandBuffer commandBuffer = drawPools.Allocate(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		vkBeginCommandBuffer(commandBuffer, &command_buffer_begin_info);
+		recordDraws(commandBuffer, state, 0, state.drawCount);
+		vkEndCommandBuffer(commandBuffer);
+
+		auto recordEnd = std::chrono::steady_clock::now();
+		inlineTimes.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(recordEnd - recordStart).count());
+
+		drawPools.EndEpoch(submitted);
+	}
+	double inlineMilliseconds = median(inlineTimes);
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Inline, 1 thread: " << std::setw(9) << inlineMilliseconds << " ms\n";
+	csv << "inline,1,1," << inlineMilliseconds << ",1,100\n";
+
+	//Each thread count on a freshly started job system, the stopped workers hand their pools back as they exit
+	for (uint32_t threads : DRAW_BENCHMARK_THREADS)
+	{
+		jobSystem.Release();
+		jobSystem.Initialise(threads - 1);
+
+		std::vector<double> times;
+		uint32_t bufferCount = 0;
+		for (uint32_t r = 0; r < DRAW_BENCHMARK_REPETITIONS; r++)
+		{
+			auto recordStart = std::chrono::steady_clock::now();
+			bufferCount = recordSecondaryBuffers(state);
+			auto recordEnd = std::chrono::steady_clock::now();
+			times.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(recordEnd - recordStart).count());
+
+			drawPools.EndEpoch(submitted);
+		}
+
+		double milliseconds = median(times);
+		double speedup = milliseconds > 0 ? inlineMilliseconds / milliseconds : 0.0;
+		double efficiency = speedup / threads * 100.0;
+
+		std::cout << "Secondary, " << std::setw(2) << threads << " threads, " << std::setw(2) << bufferCount << " buffers: " << std::setw(9) << milliseconds << " ms, ";
+		std::cout << std::setprecision(2) << speedup << "x, " << std::setprecision(1) << efficiency << "% efficiency\n" << std::setprecision(3);
+		csv << "secondary," << threads << "," << bufferCount << "," << milliseconds << "," << speedup << "," << efficiency << "\n";
+	}
+	std::cout << std::defaultfloat;
+
+	jobSystem.Release();
+	jobSystem.Initialise(originalWorkers);
+
+	std::cout << "Draw recording benchmark written to draw_recording_benchmark.csv.\n";
+}
+
+void VulkanBase::WaitForFrame(FrameResources &frame)
+{
+	if (!syncTimeline.IsComplete(frame.ticket))
+	{
+		auto waitStart = std::chrono::steady_clock::now();
+		syncTimeline.Wait(frame.ticket);
+		auto waitEnd = std::chrono::steady_clock::now();
+
+		frameFenceWait += std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(waitEnd - waitStart).count();
+	}
+
+	//Nothing executing reads the frame's set any more, so it can follow the resources replaced since it was written
+	if (frame.descriptorVersion != descriptorVersion)
+	{
+		WriteDescriptorSet(frame);
+	}
+}
+
+void VulkanBase::SetFramesInFlight(uint32_t count)
+{
+	count = std::min(std::max(count, 1u), MAX_FRAMES_IN_FLIGHT);
+	if (count == framesInFlight)
+	{
+		return;
+	}
+
+	//Start the new cycle from idle so no frame's resources are shared between the two
+	syncTimeline.Wait(lastFrameTicket);
+
+	framesInFlight = count;
+	currentFrame = 0;
+	lastFrameStart = std::chrono::steady_clock::now();
+
+	UpdateUniformBuffer();
+
+	std::cout << "Frames in flight: " << framesInFlight << ".\n";
+}
+
+void VulkanBase::SetRecordingMode(RecordingMode mode)
+{
+	if (mode == recordingMode)
+	{
+		return;
+	}
+
+	//Takes effect from the next frame recorded, buffers prerecorded earlier are checked against drawContentVersion
+	recordingMode = mode;
+
+	std::cout << "Recording mode: " << (recordingMode == RECORD_PRERECORDED ? "prerecorded" : "per frame") << ".\n";
+}
+
+VkPresentModeKHR VulkanBase::ChoosePresentMode(const VkPresentModeKHR *availableModes, uint32_t availableCount) const
+{
+	auto available = [&](VkPresentModeKHR presentMode)
+	{
+		return std::find(availableModes, availableModes + availableCount, presentMode) != availableModes + availableCount;
+	};
+
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR; //The one mode every surface supports
+	if (available(requestedPresentMode))
+	{
+		presentMode = requestedPresentMode;
+	}
+	else if (requestedPresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR && available(VK_PRESENT_MODE_MAILBOX_KHR))
+	{
+		presentMode = VK_PRESENT_MODE_MAILBOX_KHR; //Still never waits on vertical blank, without the tearing
+	}
+
+	if (presentMode != requestedPresentMode)
+	{
+		std::cout << "Present mode " << presentModeName(requestedPresentMode) << " not supported by the surface, falling back to " << presentModeName(presentMode) << ".\n";
+	}
+	else
+	{
+		std::cout << "Present mode " << presentModeName(presentMode) << " selected.\n";
+	}
+
+	return presentMode;
+}
+
+void VulkanBase::SetPresentMode(VkPresentModeKHR presentMode)
+{
+	if (presentMode == requestedPresentMode)
+	{
+		return;
+	}
+
+	//The present mode is fixed at swapchain creation
+	requestedPresentMode = presentMode;
+	RecreateSwapchain();
+}
+
+void VulkanBase::PaceFrame()
+{
+	framePacer.Wait();
+}
+
+void VulkanBase::updateFramePacing()
+{
+	//Presenting in a FIFO mode already blocks until vertical blank, pacing on top of it only adds latency
+	bool presentBlocks = swapchainPresentMode == VK_PRESENT_MODE_FIFO_KHR || swapchainPresentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+	double target = framePacingRequested && !presentBlocks ? (targetFrameTime > 0 ? targetFrameTime : 1000.0 / 60.0) : 0.0;
+
+	if (target != framePacer.GetTargetFrameTime())
+	{
+		framePacer.SetTargetFrameTime(target);
+	}
+}
+
+void VulkanBase::UpdateSimulation()
+{
+	auto stepStart = std::chrono::steady_clock::now();
+
+	//Written into the slot only this thread can see, the renderer reads it once published
+	FrameSnapshot &snapshot = frameHandoff.GetWriteSlot();
+	snapshot.sequence = ++simulationSequence;
+	snapshot.simulationTime = std::chrono::duration_cast<std::chrono::duration<double>>(stepStart - simulationStart).count();
+
+	snapshot.model = glm::scale(glm::mat4(), glm::vec3(0.05f, 0.05f, 0.05f));
+	snapshot.model *= glm::rotate(glm::mat4(), glm::radians(105.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+	snapshot.model *= glm::rotate(glm::mat4(), glm::radians(10.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	snapshot.model *= glm::rotate(glm::mat4(), glm::radians(120.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	snapshot.model *= glm::translate(glm::mat4(), glm::vec3(-15.0f, 5.0f, 0.0f));
+	snapshot.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	snapshot.cameraPosition = glm::vec3(glm::inverse(snapshot.view * snapshot.model)[3]);
+	snapshot.materialIndex = 0;
+
+	frameHandoff.Publish();
+
+	auto stepEnd = std::chrono::steady_clock::now();
+	simulationTimeSum += std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(stepEnd - stepStart).count();
+	simulationStepCount++;
+}
+
+void VulkanBase::consumeSnapshot()
+{
+	if (!frameHandoff.Consume())
+	{
+		snapshotsRepeated++;
+		return;
+	}
+
+	uint64_t sequence = frameHandoff.GetReadSlot().sequence;
+	snapshotsSuperseded += sequence - lastConsumedSequence - 1;
+	lastConsumedSequence = sequence;
+	snapshotsConsumed++;
+}
+
+void VulkanBase::RenderFrame()
+{
+	auto frameStart = std::chrono::steady_clock::now();
+
+	ProcessWindowEvents();
+	consumeSnapshot();
+
+	AcquireSubmitPresent();
+	UpdateUniformBuffer();
+	Defragment();
+	UpdateResidency();
+	showFPS(window);
+	windowTimer();
+
+	auto frameEnd = std::chrono::steady_clock::now();
+	renderTimeSum += std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(frameEnd - frameStart).count();
+	renderFrameCount++;
+
+	PaceFrame();
+}
+
+void VulkanBase::StartFrameThreads()
+{
+	frameThreadsRunning = true;
+	simulationThread = std::thread(&VulkanBase::simulationLoop, this);
+	renderThread = std::thread(&VulkanBase::renderLoop, this);
+
+	std::cout << "Simulation and render threads started.\n";
+}
+
+void VulkanBase::StopFrameThreads()
+{
+	frameThreadsRunning = false;
+
+	if (renderThread.joinable())
+	{
+		renderThread.join();
+	}
+	if (simulationThread.joinable())
+	{
+		simulationThread.join();
+	}
+}
+
+void VulkanBase::simulationLoop()
+{
+	//Fixed steps on their own clock, the renderer takes whichever snapshot is newest when it starts a frame
+	auto tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(simulationTickTime));
+	auto nextStep = std::chrono::steady_clock::now();
+
+	while (frameThreadsRunning)
+	{
+		UpdateSimulation();
+
+		nextStep += tick;
+		auto now = std::chrono::steady_clock::now();
+		if (now > nextStep + tick) //Stalled for more than a step, carry on from now rather than catching up
+		{
+			nextStep = now;
+		}
+		std::this_thread::sleep_until(nextStep);
+	}
+}
+
+void VulkanBase::renderLoop()
+{
+	while (frameThreadsRunning)
+	{
+		RenderFrame();
+	}
+}
+
+void VulkanBase::RunMainThreadJobs()
+{
+	jobSystem.RunMainThreadJobs();
+}
+
+const char *VulkanBase::presentModeName(VkPresentModeKHR presentMode)
+{
+	switch (presentMode)
+	{
+	case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+	case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+	case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+	default: return "UNKNOWN";
 	}
 }
 
 void VulkanBase::AcquireSubmitPresent()
 {
+	HandlePendingResize();
+
 	startFrame = std::chrono::steady_clock::now();
 
+	//The only CPU wait of the frame, on the submission that last used this frame's resources. Usually already paid
+	//by UpdateUniformBuffer, which writes the frame's uniform region ahead of it
+	FrameResources &frame = frameResources[currentFrame];
+	WaitForFrame(frame);
+
+	if (frame.timestamped)
+	{
+		uint64_t frameTimes[2];
+		uint32_t frameIndex = currentFrame;
+		if (vkGetQueryPoolResults(logicalDevice, timestampQueryPool, frameIndex * 2, 2, sizeof(frameTimes), frameTimes, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			double gpuTime = (frameTimes[1] - frameTimes[0]) * timestampPeriod / 1000000.0;
+
+			FramePacingStats &stats = framePacingStats[framesInFlight - 1];
+			stats.gpuTimeSum += gpuTime;
+			stats.gpuTimedCount++;
+
+			RecordingStats &modeStats = recordingStats[frame.recordingMode];
+			modeStats.gpuTimeSum += gpuTime;
+			modeStats.gpuTimedCount++;
+		}
+		frame.timestamped = false;
+	}
+
 	uint32_t imageIndex;
 	//VkPipelineStageFlags pipeline_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
-	result = vkAcquireNextImageKHR(logicalDevice, swapchain, UINT64_MAX, imageAcquiredSemaphore, VK_NULL_HANDLE, &imageIndex);
+	result = vkAcquireNextImageKHR(logicalDevice, swapchain, UINT64_MAX, frame.imageAcquiredSemaphore, VK_NULL_HANDLE, &imageIndex);
 	if (result == VK_SUCCESS)
 	{
 #ifdef DEBUG
@@ -1396,11 +2228,18 @@ void VulkanBase::AcquireSubmitPresent()
 	}
 	else if (result == VK_ERROR_OUT_OF_DATE_KHR)
 	{
-		RecreateSwapchain();
+		if (!resizePending) //A pending resize will rebuild the swapchain once the window settles
+		{
+			RecreateSwapchain();
+		}
 		return;
 	}
 
-	VkSemaphore waitSemaphores[] = { imageAcquiredSemaphore };
+	//Everything recorded from the pool last time has completed
+	vkResetCommandPool(logicalDevice, frame.commandPool, 0);
+	VkCommandBuffer commandBuffer = RecordFrameCommands(frame, imageIndex);
+
+	VkSemaphore waitSemaphores[] = { frame.imageAcquiredSemaphore };
 	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 	VkSubmitInfo submit_info = {};
 	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -1409,17 +2248,17 @@ void VulkanBase::AcquireSubmitPresent()
 	submit_info.pWaitSemaphores = waitSemaphores;
 	submit_info.pWaitDstStageMask = waitStages;
 	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &commandBuffers[imageIndex];
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
+	submit_info.pCommandBuffers = &commandBuffer;
+	VkSemaphore signalSemaphores[] = { frame.renderFinishedSemaphore };
 	submit_info.signalSemaphoreCount = 1;
 	submit_info.pSignalSemaphores = signalSemaphores;
 
-	result = vkQueueSubmit(graphicsQueue, 1, &submit_info, VK_NULL_HANDLE);
-	if (result == VK_SUCCESS)
+	lastFrameTicket = syncTimeline.Submit(graphicsTimeline, submit_info);
+	frame.ticket = lastFrameTicket;
+	drawPools.EndEpoch(lastFrameTicket); //The secondary buffers executed by this frame
+	if (chunkedModel)
 	{
-#ifdef DEBUG
-		std::cout << "Command Buffer queued for execution.\n";
-#endif // DEBUG
+		chunkStreamer.MarkDrawn(lastFrameTicket);
 	}
 
 	VkPresentInfoKHR present_info = {};
@@ -1433,6 +2272,9 @@ void VulkanBase::AcquireSubmitPresent()
 	present_info.pImageIndices = &imageIndex;
 	present_info.pResults = nullptr;
 
+	//The next frame's resources are used from here on, including by UpdateUniformBuffer
+	currentFrame = (currentFrame + 1) % framesInFlight;
+
 	result = vkQueuePresentKHR(presentQueue, &present_info);
 	if (result == VK_SUCCESS)
 	{
@@ -1440,116 +2282,1380 @@ void VulkanBase::AcquireSubmitPresent()
 		std::cout << "Presented successfully to the present queue.\n\n\n";
 #endif // DEBUG
 	}
-	else if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+	else if ((result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) && !resizePending)
+	{
+		RecreateSwapchain();
+	}
+
+	if (!firstFramePresented)
+	{
+		firstFramePresented = true;
+
+		auto firstFrameTime = std::chrono::high_resolution_clock::now();
+		std::cout << "Time to first frame: " << std::chrono::duration_cast<std::chrono::duration<double>>(firstFrameTime - startTime).count() << " seconds.\n";
+	}
+
+	//Release whatever the GPU has finished with since the last frame
+	syncTimeline.Collect();
+	uploadContext.PollAll();
+	transferPools.EndEpoch(syncTimeline.GetLastSubmitted(graphicsTimeline));
+
+	endFrame = std::chrono::steady_clock::now();
+
+	auto elapsedTime = std::chrono::duration_cast<std::chrono::duration<double>>(endFrame - startFrame).count();
+
+	if (elapsedTime > 0)
+	{
+		drawFrames++;
+		elapsedSum += elapsedTime;
+	}
+
+	//Start to start interval, includes the waits made for this frame by UpdateUniformBuffer in the previous iteration
+	FramePacingStats &stats = framePacingStats[framesInFlight - 1];
+	stats.frameTimeSum += std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(startFrame - lastFrameStart).count();
+	stats.fenceWaitSum += frameFenceWait;
+	stats.frameCount++;
+	lastFrameStart = startFrame;
+	frameFenceWait = 0;
+}
+
+void VulkanBase::UpdateUniformBuffer()
+{ 
+	const FrameSnapshot &snapshot = frameHandoff.GetReadSlot();
+
+	glm::mat4 projection = glm::perspective(glm::radians(65.0f), swapchainExtent.width / (float)swapchainExtent.height, 0.1f, 10.0f);
+	projection[1][1] *= -1; //Flip the y axis
+
+	UniformBufferObject ubo = {};
+	ubo.mvp = projection * snapshot.view * snapshot.model;
+
+	frameModelViewProjection = ubo.mvp;
+	frameCameraPosition = snapshot.cameraPosition;
+
+	auto updateStart = std::chrono::steady_clock::now();
+
+	//Written for the frame about to be recorded, whose region is free once its last submission has completed. Frames
+	//still in flight keep reading their own regions
+	FrameResources &frame = frameResources[currentFrame];
+	WaitForFrame(frame);
+
+	if (uniformDirect)
+	{
+		memcpy(reinterpret_cast<uint8_t*>(deviceAllocator.GetMapped(uniformAllocation)) + frame.uniformOffset, &ubo, sizeof(ubo));
+	}
+	else
+	{
+		memcpy(uniformHostMapped + frame.uniformOffset, &ubo, sizeof(ubo));
+
+		//The staging region was last read by a copy submitted ahead of the frame, so it has completed too
+		if (stagedUniformUpdates)
+		{
+			copyBuffer(uniformHostBuffer, deviceAllocator.GetBuffer(uniformAllocation), sizeof(ubo), frame.uniformOffset);
+		}
+	}
+
+	auto updateEnd = std::chrono::steady_clock::now();
+	uniformUpdateTimeSum += std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(updateEnd - updateStart).count();
+	uniformUpdateCount++;
+}
+
+void VulkanBase::Defragment()
+{
+	if (!defragmentMemory)
+	{
+		return;
+	}
+
+	std::vector<uint32_t> movedHandles;
+	if (!deviceAllocator.Defragment(defragmentBytesPerFrame, movedHandles))
+	{
+		return;
+	}
+
+	//Views onto the new images, the descriptor sets follow as each frame completes
+	std::vector<VkImageView> retiredViews;
+	for (uint32_t handle : movedHandles)
+	{
+		if (handle == textureAllocation)
+		{
+			retiredViews.push_back(textureImageView);
+			CreateTextureImageView();
+		}
+		else if (handle == placeholderTextureAllocation)
+		{
+			retiredViews.push_back(placeholderTextureView);
+			CreateImageView(deviceAllocator.GetImage(placeholderTextureAllocation), VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, placeholderTextureView);
+		}
+	}
+
+	RefreshDrawResources();
+
+	//Frames recorded against the old resources may still be executing, the next step waits until they are released
+	syncTimeline.Defer(lastFrameTicket, [this, retiredViews]()
+	{
+		for (VkImageView view : retiredViews)
+		{
+			vkDestroyImageView(logicalDevice, view, nullptr);
+		}
+		deviceAllocator.ReleaseRetired();
+	});
+	defragmentSteps++;
+
+	std::cout << "Defragmentation moved " << movedHandles.size() << " resources (" << deviceAllocator.GetBytesMovedLastStep() << " bytes), ";
+	std::cout << deviceAllocator.GetTotalBytesFreed() << " bytes released so far.\n";
+}
+
+//Fill two blocks with buffers of alternating tags, free three in four so both are sparse, then step compaction until
+//it settles. One block should be emptied into the other with every surviving buffer's words unchanged
+void VulkanBase::checkDefragmentation()
+{
+	const VkDeviceSize bufferSize = 4 * 1024 * 1024;
+	const uint32_t bufferCount = (uint32_t)(2 * DEVICE_MEMORY_BLOCK_SIZE / bufferSize);
+	const MemoryUsageTag tags[] = { MEMORY_TAG_VERTEX, MEMORY_TAG_INDEX, MEMORY_TAG_UNIFORM, MEMORY_TAG_STAGING };
+	const VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; //Mapped to check the contents
+
+	std::vector<uint32_t> handles;
+	for (uint32_t i = 0; i < bufferCount; i++)
+	{
+		uint32_t handle = deviceAllocator.CreateBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, properties, tags[i % 4], ALLOCATION_SITE);
+		if (handle == UINT32_MAX)
+		{
+			break;
+		}
+
+		uint32_t *words = reinterpret_cast<uint32_t*>(deviceAllocator.GetMapped(handle));
+		for (VkDeviceSize w = 0; w < bufferSize / sizeof(uint32_t); w++)
+		{
+			words[w] = (uint32_t)(i * 0x9E3779B9u + w);
+		}
+
+		handles.push_back(handle);
+	}
+
+	//Every tag but the first is freed, the survivors are of one tag and the free space elsewhere is of the others
+	for (uint32_t i = 0; i < handles.size(); i++)
+	{
+		if (i % 4 != 0)
+		{
+			deviceAllocator.Destroy(handles[i]);
+			handles[i] = UINT32_MAX;
+		}
+	}
+
+	VkDeviceSize freedBefore = deviceAllocator.GetTotalBytesFreed();
+	auto start = std::chrono::steady_clock::now();
+	uint32_t steps = 0;
+
+	do
+	{
+		std::vector<uint32_t> movedHandles;
+		if (deviceAllocator.Defragment(defragmentBytesPerFrame, movedHandles))
+		{
+			deviceAllocator.ReleaseRetired();
+			steps++;
+		}
+	} while (deviceAllocator.IsCompacting() && std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+	bool contentsKept = true;
+	for (uint32_t i = 0; i < handles.size(); i++)
+	{
+		if (handles[i] == UINT32_MAX)
+		{
+			continue;
+		}
+
+		const uint32_t *words = reinterpret_cast<const uint32_t*>(deviceAllocator.GetMapped(handles[i]));
+		for (VkDeviceSize w = 0; w < bufferSize / sizeof(uint32_t) && contentsKept; w++)
+		{
+			contentsKept = words[w] == (uint32_t)(i * 0x9E3779B9u + w);
+		}
+
+		deviceAllocator.Destroy(handles[i]);
+	}
+
+	VkDeviceSize freed = deviceAllocator.GetTotalBytesFreed() - freedBefore;
+	bool compacted = freed >= DEVICE_MEMORY_BLOCK_SIZE;
+
+	std::cout << "Defragmentation check " << (compacted && contentsKept ? "passed" : "FAILED") << ": " << steps << " steps, ";
+	std::cout << freed << " bytes released, contents " << (contentsKept ? "kept" : "corrupted") << ".\n";
+}
+
+void VulkanBase::UpdateResidency()
+{
+	residencyManager.BeginFrame();
+
+	//Only the assets the frame drew, the texture is sampled by nothing but the model
+	if (isModelInView())
+	{
+		residencyManager.Touch(textureAsset);
+		residencyManager.Touch(modelAsset);
+	}
+
+	if (residencyCheck && ++residencyCheckFrames % residencyCheckPeriod == 0)
+	{
+		modelHidden = !modelHidden;
+		drawContentVersion++;
+		std::cout << "Residency check: model " << (modelHidden ? "taken out of" : "returned to") << " the scene.\n";
+	}
+
+	//Shed assets the frame does not need until back under budget
+	VkDeviceSize budget, usage;
+	getDeviceLocalBudget(budget, usage);
+	while (usage > budget && EvictLeastRecentlyUsed())
+	{
+		getDeviceLocalBudget(budget, usage);
+	}
+
+	UpdateChunks();
+
+	//Bring back what has been drawn since it was evicted, decoded on the loader threads
+	uint32_t asset;
+	while (residencyManager.NextUpload(asset))
+	{
+		RequestAsset(asset);
+	}
+
+	//Record the uploads of finished decodes, spread over frames so a burst of loads does not stall one
+	if (assetLoader.HasFinished())
+	{
+		uploadBatch = uploadContext.Begin();
+
+		assetLoader.Drain(residencyUploadBytesPerFrame);
+
+		UploadBatch *batch = uploadBatch;
+		batch->OnComplete([this, batch]() { reportUploadTimestamps(batch); });
+		batch->Submit();
+		uploadBatch = nullptr;
+	}
+
+	if (drawResourcesDirty)
+	{
+		RefreshDrawResources();
+		residencyManager.ReportMetrics();
+	}
+}
+
+bool VulkanBase::isModelInView() const
+{
+	if (modelHidden)
+	{
+		return false;
+	}
+
+	//Copies of the stress grid are spread beyond the model's own bounds
+	if (stressCopyCount > 0)
+	{
+		return true;
+	}
+
+	return ChunkStreamer::IsBoxVisible(modelBoundsMin, modelBoundsMax, frameModelViewProjection);
+}
+
+void VulkanBase::getDeviceLocalBudget(VkDeviceSize &budget, VkDeviceSize &usage)
+{
+	memoryTracker.GetHeapBudget(deviceLocalHeap, budget, usage);
+
+	//Evicted assets still waiting on frames in flight are as good as gone
+	usage -= std::min(usage, evictingBytes);
+
+	//Room for everything but the assets, so any the frame did not draw are over budget
+	if (residencyCheck)
+	{
+		budget = std::min(budget, usage - std::min(usage, residencyManager.GetResidentBytes()));
+	}
+}
+
+void VulkanBase::RecreateSwapchain()
+{
+	auto recreateStart = std::chrono::steady_clock::now();
+
+	//Nothing waits for the GPU here, the old framebuffers and views go once the last frame drawn with them completes
+	std::vector<VkFramebuffer> retiredFramebuffers = renderGraph.TakeFramebuffers();
+	std::vector<VkImageView> retiredImageViews = swapchainImageViews;
+	syncTimeline.Defer(lastFrameTicket, [this, retiredFramebuffers, retiredImageViews]()
+	{
+		for (VkFramebuffer framebuffer : retiredFramebuffers)
+		{
+			vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+		}
+		for (VkImageView imageView : retiredImageViews)
+		{
+			vkDestroyImageView(logicalDevice, imageView, nullptr);
+		}
+	});
+
+	VkFormat previousFormat = swapchainImageFormat;
+
+	CreateSwapchain();
+	CreateSwapchainImageViews();
+
+	//Viewport and scissor are dynamic, so the render pass and pipeline only depend on the surface format
+	if (swapchainImageFormat != previousFormat)
+	{
+		syncTimeline.Wait(lastFrameTicket);
+
+		if (uniformPipeline != graphicsPipeline)
+		{
+			vkDestroyPipeline(logicalDevice, uniformPipeline, nullptr);
+		}
+		vkDestroyPipeline(logicalDevice, graphicsPipeline, nullptr);
+		vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
+		renderGraph.Release();
+
+		CreateRenderPass();
+		CreateGraphicsPipeline();
+		pipelineRebuildCount++;
+	}
+
+	CreateRenderTargets();
+	CreateFramebuffers();
+	drawContentVersion++;
+
+	UpdateUniformBuffer();
+
+	auto recreateEnd = std::chrono::steady_clock::now();
+
+	auto elapsedTime = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(recreateEnd - recreateStart).count();
+	recreateTimeSum += elapsedTime;
+	recreateTimeMax = std::max(recreateTimeMax, elapsedTime);
+	recreateCount++;
+
+	std::cout << "Swapchain recreated in " << elapsedTime << " milliseconds.\n";
+}
+
+void VulkanBase::HandlePendingResize()
+{
+	if (!resizePending)
+	{
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+
+	//Wait for the size to settle so a window drag produces a single rebuild
+	if (std::chrono::duration_cast<std::chrono::duration<double>>(now - lastResizeEvent).count() < resizeSettleTime)
+	{
+		return;
+	}
+
+	resizePending = false;
+
+	RecreateSwapchain();
+
+	auto recreateEnd = std::chrono::steady_clock::now();
+
+	//Latency from the first event of the burst, which includes the settle time, to a usable swapchain
+	auto latency = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(recreateEnd - firstResizeEvent).count();
+	resizeLatencySum += latency;
+	resizeCount++;
+
+	std::cout << "Resize latency: " << latency << " milliseconds, " << resizeEventCount << " resize events coalesced.\n";
+
+	resizeEventCount = 0;
+}
+
+void VulkanBase::CreatePlaceholders()
+{
+	const stbi_uc whitePixel[4] = { 255, 255, 255, 255 };
+	UploadTextureImage(whitePixel, 1, 1, placeholderTextureAllocation);
+	CreateImageView(deviceAllocator.GetImage(placeholderTextureAllocation), VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, placeholderTextureView);
+
+	CreatePlaceholderBox(placeholderVertexAllocation, placeholderIndexAllocation);
+	placeholderIndexCount = 36;
+}
+
+void VulkanBase::CreatePlaceholderBox(uint32_t &vertexAllocation, uint32_t &indexAllocation)
+{
+	glm::vec3 minimum = vertices.empty() ? glm::vec3(-0.5f) : vertices[0].position;
+	glm::vec3 maximum = vertices.empty() ? glm::vec3(0.5f) : minimum;
+	for (const Vertex &vertex : vertices)
+	{
+		minimum = glm::min(minimum, vertex.position);
+		maximum = glm::max(maximum, vertex.position);
+	}
+	modelBoundsMin = minimum;
+	modelBoundsMax = maximum;
+
+	std::array<Vertex, 8> boxVertices = {};
+	for (uint32_t i = 0; i < boxVertices.size(); i++)
+	{
+		boxVertices[i].position = { (i & 1) ? maximum.x : minimum.x, (i & 2) ? maximum.y : minimum.y, (i & 4) ? maximum.z : minimum.z };
+		boxVertices[i].color = { 0.5f, 0.5f, 0.5f };
+		boxVertices[i].texCoord = { 0.0f, 0.0f };
+	}
+
+	const std::array<uint32_t, 36> boxIndices = {
+		0, 2, 1, 1, 2, 3,
+		4, 5, 6, 5, 7, 6,
+		0, 1, 4, 1, 5, 4,
+		2, 6, 3, 3, 6, 7,
+		0, 4, 2, 2, 4, 6,
+		1, 3, 5, 3, 7, 5
+	};
+
+	vertexAllocation = UploadBuffer(boxVertices.data(), sizeof(boxVertices), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, MEMORY_TAG_VERTEX, ALLOCATION_SITE);
+	indexAllocation = UploadBuffer(boxIndices.data(), sizeof(boxIndices), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, MEMORY_TAG_INDEX, ALLOCATION_SITE);
+}
+
+uint32_t VulkanBase::CreateDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsageTag tag, AllocationSite site)
+{
+	uint32_t allocation = deviceAllocator.CreateBuffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tag, site);
+
+	//Out of device memory, make room by dropping assets the current frame does not draw
+	while (allocation == UINT32_MAX && EvictLeastRecentlyUsed())
+	{
+		reclaimEvictedMemory();
+		allocation = deviceAllocator.CreateBuffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tag, site);
+	}
+
+	if (allocation == UINT32_MAX)
+	{
+		std::cout << "Out of device memory for " << MemoryTracker::TagName(tag) << " buffer with nothing left to evict.\n";
+	}
+
+	return allocation;
+}
+
+uint32_t VulkanBase::CreateDirectBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsageTag tag, AllocationSite site)
+{
+	if (directWriteMemoryType == UINT32_MAX)
+	{
+		return UINT32_MAX;
+	}
+
+	//Resizable BAR heaps can be small, leave room for a new block before placing more in them
+	VkDeviceSize budget, heapUsage;
+	memoryTracker.GetHeapBudget(directWriteHeap, budget, heapUsage);
+	if (heapUsage + std::max(size, DEVICE_MEMORY_BLOCK_SIZE) > budget)
+	{
+		return UINT32_MAX;
+	}
+
+	return deviceAllocator.CreateBuffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, tag, site);
+}
+
+uint32_t VulkanBase::CreateDeviceImage(const VkImageCreateInfo &imageInfo, VkImageAspectFlags aspect, MemoryUsageTag tag, AllocationSite site)
+{
+	uint32_t allocation = deviceAllocator.CreateImage(imageInfo, aspect, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tag, site);
+
+	while (allocation == UINT32_MAX && EvictLeastRecentlyUsed())
+	{
+		reclaimEvictedMemory();
+		allocation = deviceAllocator.CreateImage(imageInfo, aspect, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tag, site);
+	}
+
+	if (allocation == UINT32_MAX)
+	{
+		std::cout << "Out of device memory for " << MemoryTracker::TagName(tag) << " image with nothing left to evict.\n";
+	}
+
+	return allocation;
+}
+
+uint32_t VulkanBase::UploadBuffer(const void *data, VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsageTag tag, AllocationSite site)
+{
+	auto uploadStart = std::chrono::steady_clock::now();
+
+	//Written in place, host writes are visible to every later submission without a copy or an ownership transfer
+	uint32_t directAllocation = CreateDirectBuffer(size, usage, tag, site);
+	void *directMapped = directAllocation != UINT32_MAX ? deviceAllocator.GetMapped(directAllocation) : nullptr;
+	if (directAllocation != UINT32_MAX && directMapped == nullptr)
+	{
+		deviceAllocator.Destroy(directAllocation);
+	}
+	else if (directAllocation != UINT32_MAX)
+	{
+		memcpy(directMapped, data, (size_t)size);
+
+		auto uploadEnd = std::chrono::steady_clock::now();
+		directUploadTimeSum += std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(uploadEnd - uploadStart).count();
+		directUploadCount++;
+
+		return directAllocation;
+	}
+
+	VkBuffer uploadBuffer;
+	VkDeviceMemory uploadBufferMemory;
+	CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uploadBuffer, uploadBufferMemory, MEMORY_TAG_STAGING, site);
+
+	void *mapped;
+	vkMapMemory(logicalDevice, uploadBufferMemory, 0, size, 0, &mapped);
+	memcpy(mapped, data, (size_t)size);
+	vkUnmapMemory(logicalDevice, uploadBufferMemory);
+
+	uint32_t allocation = CreateDeviceBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, tag, site);
+	if (allocation == UINT32_MAX)
+	{
+		FreeDeviceMemory(uploadBufferMemory);
+		vkDestroyBuffer(logicalDevice, uploadBuffer, nullptr);
+		return allocation;
+	}
+
+	UploadBatch *batch = beginUpload();
+
+	//Storage buffers are read by compute, such as encoded meshes on their way to the decoder
+	VkAccessFlags dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+	if ((usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) != 0)
+	{
+		dstAccessMask |= VK_ACCESS_SHADER_READ_BIT;
+	}
+
+	batch->CopyBuffer(uploadBuffer, deviceAllocator.GetBuffer(allocation), size);
+	batch->ReleaseBuffer(deviceAllocator.GetBuffer(allocation), dstAccessMask);
+	deviceAllocator.BeginWrite(allocation);
+
+	//The staging buffer is read until the batch completes
+	batch->OnComplete([this, uploadBuffer, uploadBufferMemory, allocation]()
+	{
+		FreeDeviceMemory(uploadBufferMemory);
+		vkDestroyBuffer(logicalDevice, uploadBuffer, nullptr);
+		deviceAllocator.EndWrite(allocation);
+	});
+
+	endUpload(batch);
+
+	auto uploadEnd = std::chrono::steady_clock::now();
+	stagedUploadTimeSum += std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(uploadEnd - uploadStart).count();
+	stagedUploadCount++;
+
+	return allocation;
+}
+
+bool VulkanBase::EvictLeastRecentlyUsed()
+{
+	uint32_t asset = residencyManager.EvictionCandidate();
+	if (asset == UINT32_MAX)
+	{
+		return false;
+	}
+
+	EvictAsset(asset);
+
+	return true;
+}
+
+void VulkanBase::EvictAsset(uint32_t asset)
+{
+	//The texture is reloaded from disk and the model from the vertices and indices kept on the CPU
+	VkImageView evictedView = VK_NULL_HANDLE;
+	std::vector<uint32_t> evictedAllocations;
+	if (asset == textureAsset)
+	{
+		evictedView = textureImageView;
+		evictedAllocations = { textureAllocation };
+		textureImageView = VK_NULL_HANDLE;
+		textureAllocation = UINT32_MAX;
+	}
+	else if (asset == modelAsset && chunkedModel)
+	{
+		//Copies into the pool may still be in flight, their slots are dropped with it
+		uploadContext.WaitAll();
+
+		evictedAllocations = { chunkVertexAllocation, chunkIndexAllocation };
+		chunkVertexAllocation = UINT32_MAX;
+		chunkIndexAllocation = UINT32_MAX;
+		chunkStreamer.Reset();
+		chunkPoolGeneration++;
+	}
+	else if (asset == modelAsset)
+	{
+		evictedAllocations = { vertexAllocation, indexAllocation };
+		vertexAllocation = UINT32_MAX;
+		indexAllocation = UINT32_MAX;
+	}
+
+	VkDeviceSize evictedBytes = 0;
+	for (uint32_t allocation : evictedAllocations)
+	{
+		evictedBytes += allocation != UINT32_MAX ? deviceAllocator.GetSize(allocation) : 0;
+	}
+	evictingBytes += evictedBytes;
+
+	//Frames in flight may still draw with the asset, it is released once the last of them completes
+	syncTimeline.Defer(lastFrameTicket, [this, evictedView, evictedAllocations, evictedBytes]()
+	{
+		vkDestroyImageView(logicalDevice, evictedView, nullptr);
+		for (uint32_t allocation : evictedAllocations)
+		{
+			deviceAllocator.Destroy(allocation);
+		}
+		evictingBytes -= evictedBytes;
+	});
+
+	residencyManager.MarkEvicted(asset);
+	drawResourcesDirty = true;
+}
+
+void VulkanBase::reclaimEvictedMemory()
+{
+	//Only an allocation that cannot go ahead without the memory waits for the frames still drawing evicted assets
+	syncTimeline.Wait(lastFrameTicket);
+	syncTimeline.Collect();
+}
+
+void VulkanBase::RequestAsset(uint32_t asset)
+{
+	residencyManager.MarkLoading(asset);
+
+	if (asset == textureAsset)
+	{
+		assetLoader.Request(asset, [this]() -> AssetUpload
+		{
+			int texWidth, texHeight;
+			PixelWriter writePixels = LoadTexture(texWidth, texHeight);
+
+			return [this, texWidth, texHeight, writePixels]() { return UploadTexture(texWidth, texHeight, writePixels); };
+		});
+	}
+	else if (asset == modelAsset)
+	{
+		//Out-of-core models only read the chunk records here, the chunk file is built from the model the first time
+		if (outOfCoreModel || chunkedModel)
+		{
+			assetLoader.Request(asset, [this]() -> AssetUpload
+			{
+				bool opened = modelChunks.IsOpen() || modelChunks.Open(MODEL_CHUNK_PATH, MODEL_PATH);
+				if (!opened)
+				{
+					std::vector<Vertex> modelVertices;
+					std::vector<uint32_t> modelIndices;
+					opened = LoadModel(modelVertices, modelIndices) && BuildModelChunks(modelVertices, modelIndices) && modelChunks.Open(MODEL_CHUNK_PATH, MODEL_PATH);
+				}
+
+				return [this, opened]() { return EnableChunkedModel(opened); };
+			});
+			return;
+		}
+
+		//Only the first load parses the file, evicted models are rebuilt from the vertices and indices kept on the CPU
+		if (!vertices.empty())
+		{
+			assetLoader.Request(asset, [this]() -> AssetUpload { return [this]() { return UploadModel(); }; });
+			return;
+		}
+
+		//Models that would crowd out everything else are streamed instead
+		VkDeviceSize budget, usage;
+		memoryTracker.GetHeapBudget(deviceLocalHeap, budget, usage);
+		VkDeviceSize inCoreLimit = budget / 2;
+
+		assetLoader.Request(asset, [this, inCoreLimit]() -> AssetUpload
+		{
+			auto modelVertices = std::make_shared<std::vector<Vertex>>();
+			auto modelIndices = std::make_shared<std::vector<uint32_t>>();
+			auto modelStream = std::make_shared<std::vector<uint8_t>>();
+			bool loaded = LoadModel(*modelVertices, *modelIndices);
+
+			VkDeviceSize modelBytes = sizeof(Vertex) * modelVertices->size() + sizeof(uint32_t) * modelIndices->size();
+			if (loaded && modelBytes > inCoreLimit)
+			{
+				std::cout << "Model needs " << modelBytes << " bytes of a " << inCoreLimit << " byte in-core limit, streaming it in chunks.\n";
+
+				bool opened = BuildModelChunks(*modelVertices, *modelIndices) && modelChunks.Open(MODEL_CHUNK_PATH, MODEL_PATH);
+				return [this, opened]() { return EnableChunkedModel(opened); };
+			}
+
+			if (loaded && meshDecoder.IsAvailable())
+			{
+				*modelStream = EncodeModel(*modelVertices, *modelIndices);
+			}
+
+			return [this, modelVertices, modelIndices, modelStream]()
+			{
+				vertices = std::move(*modelVertices);
+				indices = std::move(*modelIndices);
+				encodedModel = std::move(*modelStream);
+				return UploadModel();
+			};
+		});
+	}
+}
+
+PixelWriter VulkanBase::LoadTexture(int &texWidth, int &texHeight) const
+{
+	//The pack is decompressed here on the loading thread, the upload only copies the pixels into staging
+	AssetPackHeader packHeader;
+	std::vector<uint8_t> packData;
+
+	auto readStart = std::chrono::steady_clock::now();
+	if (AssetPack::Read(TEXTURE_PACK_PATH, packHeader, packData, TEXTURE_PATH) && packHeader.rawSize == (uint64_t)packHeader.metadata[0] * packHeader.metadata[1] * 4)
+	{
+		auto readEnd = std::chrono::steady_clock::now();
+
+		//Other loader threads decode side by side, so the pack decodes on this one
+		auto decoded = std::make_shared<std::vector<uint8_t>>((size_t)packHeader.rawSize);
+		if (AssetPack::Decode(packHeader, packData, decoded->data(), 1))
+		{
+			auto decodeEnd = std::chrono::steady_clock::now();
+
+			double decodeMilliseconds = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(decodeEnd - readEnd).count();
+			std::cout << "Texture cache loaded: " << packData.size() << " of " << decoded->size() << " bytes, ";
+			std::cout << std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(readEnd - readStart).count() << " milliseconds to read, ";
+			std::cout << decodeMilliseconds << " milliseconds to decompress (" << decoded->size() / (decodeMilliseconds * 1e6) << " GB/s).\n";
+
+			texWidth = (int)packHeader.metadata[0];
+			texHeight = (int)packHeader.metadata[1];
+
+			return [decoded](uint8_t *pixels)
+			{
+				memcpy(pixels, decoded->data(), decoded->size());
+				return true;
+			};
+		}
+
+		std::cout << "Texture cache " << TEXTURE_PACK_PATH << " failed to decompress, decoding the image.\n";
+	}
+
+	int texChannels;
+	std::shared_ptr<stbi_uc> pixels(stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha), stbi_image_free);
+	if (!pixels)
+	{
+		return nullptr;
+	}
+
+	//Later loads skip the image decode
+	const uint32_t metadata[4] = { (uint32_t)texWidth, (uint32_t)texHeight, 0, 0 };
+	size_t pixelBytes = (size_t)texWidth * texHeight * 4;
+	AssetPack::Write(TEXTURE_PACK_PATH, metadata, pixels.get(), pixelBytes, compressAssetCache, TEXTURE_PATH);
+
+	return [pixels, pixelBytes](uint8_t *destination)
+	{
+		memcpy(destination, pixels.get(), pixelBytes);
+		return true;
+	};
+}
+
+VkDeviceSize VulkanBase::UploadTexture(int texWidth, int texHeight, const PixelWriter &writePixels)
+{
+	if (!writePixels)
+	{
+		std::cout << "Failed to load texture.\n";
+		residencyManager.MarkLoadFailed(textureAsset, true);
+		return 0;
+	}
+
+	UploadTextureImage(texWidth, texHeight, writePixels, textureAllocation);
+	if (textureAllocation == UINT32_MAX)
+	{
+		residencyManager.MarkLoadFailed(textureAsset, false);
+		return 0;
+	}
+
+	CreateTextureImageView();
+	VkDeviceSize uploadedBytes = deviceAllocator.GetSize(textureAllocation);
+
+	//Swapped in once the copy has completed, the placeholder is drawn until then
+	uploadBatch->OnComplete([this, uploadedBytes]()
+	{
+		residencyManager.MarkResident(textureAsset, uploadedBytes);
+		drawResourcesDirty = true;
+
+		auto swapTime = std::chrono::high_resolution_clock::now();
+		std::cout << "Texture swapped in after " << std::chrono::duration_cast<std::chrono::duration<double>>(swapTime - startTime).count() << " seconds.\n";
+	});
+
+	return uploadedBytes;
+}
+
+VkDeviceSize VulkanBase::UploadModel()
+{
+	if (vertices.empty())
+	{
+		residencyManager.MarkLoadFailed(modelAsset, true);
+		return 0;
+	}
+
+	//The encoded stream is decoded straight into the vertex and index buffers, the raw arrays are uploaded otherwise
+	if (encodedModel.empty() || !UploadEncodedModel())
+	{
+		CreateVertexBuffer();
+		CreateIndexBuffer();
+	}
+	if (vertexAllocation == UINT32_MAX || indexAllocation == UINT32_MAX)
+	{
+		deviceAllocator.Destroy(vertexAllocation);
+		deviceAllocator.Destroy(indexAllocation);
+		vertexAllocation = UINT32_MAX;
+		indexAllocation = UINT32_MAX;
+		residencyManager.MarkLoadFailed(modelAsset, false);
+		return 0;
+	}
+
+	VkDeviceSize uploadedBytes = deviceAllocator.GetSize(vertexAllocation) + deviceAllocator.GetSize(indexAllocation);
+
+	//Now the bounds are known the unit cube is replaced by the model's bounding box for any later eviction
+	uint32_t boxVertexAllocation = UINT32_MAX;
+	uint32_t boxIndexAllocation = UINT32_MAX;
+	if (!placeholderFitsModel)
+	{
+		CreatePlaceholderBox(boxVertexAllocation, boxIndexAllocation);
+		placeholderFitsModel = true;
+	}
+
+	//Swapped in once the copies have completed, the placeholder is drawn until then
+	uploadBatch->OnComplete([this, uploadedBytes, boxVertexAllocation, boxIndexAllocation]()
+	{
+		if (boxVertexAllocation != UINT32_MAX && boxIndexAllocation != UINT32_MAX)
+		{
+			//The recorded command buffers draw the old box until they are refreshed
+			uint32_t oldVertexAllocation = placeholderVertexAllocation;
+			uint32_t oldIndexAllocation = placeholderIndexAllocation;
+			syncTimeline.Defer(lastFrameTicket, [this, oldVertexAllocation, oldIndexAllocation]()
+			{
+				deviceAllocator.Destroy(oldVertexAllocation);
+				deviceAllocator.Destroy(oldIndexAllocation);
+			});
+
+			placeholderVertexAllocation = boxVertexAllocation;
+			placeholderIndexAllocation = boxIndexAllocation;
+		}
+
+		residencyManager.MarkResident(modelAsset, uploadedBytes);
+		drawResourcesDirty = true;
+
+		auto swapTime = std::chrono::high_resolution_clock::now();
+		std::cout << "Model swapped in after " << std::chrono::duration_cast<std::chrono::duration<double>>(swapTime - startTime).count() << " seconds.\n";
+	});
+
+	return uploadedBytes;
+}
+
+bool VulkanBase::UploadEncodedModel()
+{
+	MeshStreamHeader header;
+	if (!MeshCodec::ReadHeader(encodedModel, header))
+	{
+		return false;
+	}
+
+	//Every decode slot is still in flight, the raw arrays are uploaded instead
+	uint32_t slot = meshDecoder.AcquireSlot();
+	if (slot == UINT32_MAX)
+	{
+		return false;
+	}
+
+	VkDeviceSize decodedBytes = sizeof(vertices[0]) * vertices.size() + sizeof(indices[0]) * indices.size();
+	VkDeviceSize encodedBytes = encodedModel.size();
+
+	//Written only by the decode dispatch, so they need no staging. The encoded stream is uploaded last so nothing has
+	//been recorded against the buffers if it fails
+	vertexAllocation = CreateDeviceBuffer(sizeof(vertices[0]) * vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MEMORY_TAG_VERTEX, ALLOCATION_SITE);
+	indexAllocation = CreateDeviceBuffer(sizeof(indices[0]) * indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MEMORY_TAG_INDEX, ALLOCATION_SITE);
+	uint32_t encodedAllocation = UINT32_MAX;
+	if (vertexAllocation != UINT32_MAX && indexAllocation != UINT32_MAX)
+	{
+		encodedAllocation = UploadBuffer(encodedModel.data(), encodedBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MEMORY_TAG_STAGING, ALLOCATION_SITE);
+	}
+
+	if (encodedAllocation == UINT32_MAX)
+	{
+		double unused;
+		meshDecoder.ReleaseSlot(slot, unused);
+		deviceAllocator.Destroy(vertexAllocation);
+		deviceAllocator.Destroy(indexAllocation);
+		vertexAllocation = UINT32_MAX;
+		indexAllocation = UINT32_MAX;
+		return true;
+	}
+
+	uint32_t decodeVertexAllocation = vertexAllocation;
+	uint32_t decodeIndexAllocation = indexAllocation;
+	uint32_t blockCount = MeshCodec::GetBlockCount(header);
+
+	//Recorded on the graphics family after the encoded stream has been acquired
+	deviceAllocator.BeginWrite(decodeVertexAllocation);
+	deviceAllocator.BeginWrite(decodeIndexAllocation);
+	uploadBatch->OnGraphics([this, slot, encodedAllocation, decodeVertexAllocation, decodeIndexAllocation, blockCount](VkCommandBuffer commandBuffer)
+	{
+		meshDecoder.Record(commandBuffer, slot, deviceAllocator.GetBuffer(encodedAllocation), deviceAllocator.GetBuffer(decodeVertexAllocation), deviceAllocator.GetBuffer(decodeIndexAllocation), blockCount);
+	});
+
+	uploadBatch->OnComplete([this, slot, encodedAllocation, decodeVertexAllocation, decodeIndexAllocation, encodedBytes, decodedBytes]()
+	{
+		deviceAllocator.Destroy(encodedAllocation);
+		deviceAllocator.EndWrite(decodeVertexAllocation);
+		deviceAllocator.EndWrite(decodeIndexAllocation);
+
+		double gpuMilliseconds;
+		meshDecoder.ReleaseSlot(slot, gpuMilliseconds);
+
+		meshDecodeCount++;
+		encodedUploadBytes += encodedBytes;
+		decodedMeshBytes += decodedBytes;
+
+		std::cout << "Mesh decoded on the GPU: " << encodedBytes << " bytes uploaded for " << decodedBytes << " decoded";
+		if (gpuMilliseconds >= 0.0)
+		{
+			meshDecodeTimedCount++;
+			meshDecodeGpuTimeSum += gpuMilliseconds;
+			std::cout << " in " << gpuMilliseconds << " milliseconds";
+		}
+		std::cout << ".\n";
+	});
+
+	return true;
+}
+
+std::vector<uint8_t> VulkanBase::EncodeModel(const std::vector<Vertex> &modelVertices, const std::vector<uint32_t> &modelIndices) const
+{
+	static_assert(sizeof(Vertex) % sizeof(float) == 0, "Vertex must be made of floats to be encoded");
+	const uint32_t componentCount = sizeof(Vertex) / sizeof(float);
+
+	auto encodeStart = std::chrono::steady_clock::now();
+
+	std::vector<uint8_t> stream = MeshCodec::Encode(reinterpret_cast<const float*>(modelVertices.data()), (uint32_t)modelVertices.size(), componentCount,
+		modelIndices.data(), (uint32_t)modelIndices.size());
+
+	auto encodeEnd = std::chrono::steady_clock::now();
+
+	//The CPU decoder is the reference the shader is checked against, run it once to time it and bound the error
+	std::vector<float> decodedVertices;
+	std::vector<uint32_t> decodedIndices;
+	bool decoded = MeshCodec::Decode(stream, decodedVertices, decodedIndices);
+
+	auto decodeEnd = std::chrono::steady_clock::now();
+
+	const float *sourceVertices = reinterpret_cast<const float*>(modelVertices.data());
+	float maxError = 0.0f;
+	for (size_t i = 0; decoded && i < decodedVertices.size(); i++)
+	{
+		maxError = std::max(maxError, std::abs(decodedVertices[i] - sourceVertices[i]));
+	}
+
+	if (!decoded || decodedIndices != modelIndices)
+	{
+		std::cout << "Mesh stream failed the CPU reference decode, the model is uploaded uncompressed.\n";
+		return std::vector<uint8_t>();
+	}
+
+	VkDeviceSize rawBytes = sizeof(Vertex) * modelVertices.size() + sizeof(uint32_t) * modelIndices.size();
+	std::cout << "Model encoded: " << stream.size() << " of " << rawBytes << " bytes (" << (double)rawBytes / stream.size() << "x), ";
+	std::cout << std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(encodeEnd - encodeStart).count() << " milliseconds to encode, ";
+	std::cout << std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(decodeEnd - encodeEnd).count() << " milliseconds CPU reference decode, ";
+	std::cout << maxError << " largest vertex error.\n";
+
+	return stream;
+}
+
+bool VulkanBase::BuildModelChunks(const std::vector<Vertex> &modelVertices, const std::vector<uint32_t> &modelIndices) const
+{
+	auto buildStart = std::chrono::steady_clock::now();
+
+	bool built = MeshChunkFile::Build(MODEL_CHUNK_PATH, MODEL_PATH, reinterpret_cast<const float*>(modelVertices.data()), (uint32_t)modelVertices.size(), sizeof(Vertex) / sizeof(float),
+		modelIndices.data(), (uint32_t)modelIndices.size(), compressAssetCache);
+
+	auto buildEnd = std::chrono::steady_clock::now();
+	if (built)
+	{
+		std::cout << "Model chunks built in " << std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(buildEnd - buildStart).count() << " milliseconds.\n";
+	}
+
+	return built;
+}
+
+VkDeviceSize VulkanBase::EnableChunkedModel(bool opened)
+{
+	if (!opened || modelChunks.GetComponentCount() != sizeof(Vertex) / sizeof(float))
+	{
+		std::cout << "Model chunk file could not be read.\n";
+		residencyManager.MarkLoadFailed(modelAsset, true);
+		return 0;
+	}
+
+	//Every slot fits the largest chunk level, so any chunk can be streamed into any slot
+	chunkSlotVertexCount = modelChunks.GetMaxVertexCount();
+	chunkSlotIndexCount = modelChunks.GetMaxIndexCount();
+
+	chunkVertexAllocation = CreateDeviceBuffer(sizeof(Vertex) * chunkSlotVertexCount * CHUNK_POOL_SLOTS, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, MEMORY_TAG_VERTEX, ALLOCATION_SITE);
+	chunkIndexAllocation = CreateDeviceBuffer(sizeof(uint32_t) * chunkSlotIndexCount * CHUNK_POOL_SLOTS, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, MEMORY_TAG_INDEX, ALLOCATION_SITE);
+	if (chunkVertexAllocation == UINT32_MAX || chunkIndexAllocation == UINT32_MAX)
+	{
+		deviceAllocator.Destroy(chunkVertexAllocation);
+		deviceAllocator.Destroy(chunkIndexAllocation);
+		chunkVertexAllocation = UINT32_MAX;
+		chunkIndexAllocation = UINT32_MAX;
+		residencyManager.MarkLoadFailed(modelAsset, false);
+		return 0;
+	}
+
+	chunkedModel = true;
+	chunkStreamer.Initialise(modelChunks.GetChunks(), CHUNK_POOL_SLOTS, &syncTimeline);
+
+	//The model's bounds enclose every chunk's
+	const std::vector<ChunkRecord> &records = modelChunks.GetChunks();
+	for (uint32_t c = 0; c < records.size(); c++)
+	{
+		glm::vec3 chunkMin(records[c].boundsMin[0], records[c].boundsMin[1], records[c].boundsMin[2]);
+		glm::vec3 chunkMax(records[c].boundsMax[0], records[c].boundsMax[1], records[c].boundsMax[2]);
+		modelBoundsMin = c == 0 ? chunkMin : glm::min(modelBoundsMin, chunkMin);
+		modelBoundsMax = c == 0 ? chunkMax : glm::max(modelBoundsMax, chunkMax);
+	}
+
+	//The pool is resident from here, chunks fill it over the following frames
+	VkDeviceSize poolBytes = deviceAllocator.GetSize(chunkVertexAllocation) + deviceAllocator.GetSize(chunkIndexAllocation);
+	residencyManager.MarkResident(modelAsset, poolBytes);
+	drawResourcesDirty = true;
+
+	std::cout << "Model streamed out of core: " << modelChunks.GetChunks().size() << " chunks into " << CHUNK_POOL_SLOTS << " slots, " << poolBytes << " byte pool.\n";
+
+	return 0;
+}
+
+void VulkanBase::UpdateChunks()
+{
+	if (!chunkedModel || !residencyManager.IsResident(modelAsset))
+	{
+		return;
+	}
+
+	//Slots are only reused once the frames that drew them have completed, so nothing waits here. Prerecorded buffers
+	//are recorded again with the new list
+	if (chunkStreamer.Update(frameModelViewProjection, frameCameraPosition))
+	{
+		drawContentVersion++;
+	}
+
+	uint32_t chunk, lod, slot;
+	while (chunkStreamer.NextLoad(chunk, lod, slot))
+	{
+		RequestChunk(chunk, lod, slot);
+	}
+}
+
+void VulkanBase::RequestChunk(uint32_t chunk, uint32_t lod, uint32_t slot)
+{
+	uint32_t generation = chunkPoolGeneration;
+
+	assetLoader.Request(modelAsset, [this, chunk, lod, slot, generation]() -> AssetUpload
+	{
+		auto chunkData = std::make_shared<std::vector<uint8_t>>();
+		bool read = modelChunks.ReadLod(chunk, lod, *chunkData);
+
+		return [this, chunk, lod, slot, generation, chunkData, read]() { return UploadChunk(chunk, lod, slot, generation, read ? chunkData.get() : nullptr); };
+	});
+}
+
+VkDeviceSize VulkanBase::UploadChunk(uint32_t chunk, uint32_t lod, uint32_t slot, uint32_t generation, const std::vector<uint8_t> *chunkData)
+{
+	//The pool was released while the chunk was being read
+	if (generation != chunkPoolGeneration)
+	{
+		return 0;
+	}
+
+	if (chunkData == nullptr)
+	{
+		std::cout << "Failed to read chunk " << chunk << ".\n";
+		chunkStreamer.MarkLoadFailed(slot);
+		return 0;
+	}
+
+	const ChunkLod &chunkLod = modelChunks.GetChunks()[chunk].lods[lod];
+	VkDeviceSize vertexBytes = sizeof(Vertex) * chunkLod.vertexCount;
+	VkDeviceSize indexBytes = sizeof(uint32_t) * chunkLod.indexCount;
+	VkDeviceSize chunkBytes = vertexBytes + indexBytes;
+
+	if (chunkBytes == 0)
+	{
+		chunkStreamer.MarkLoaded(slot, 0);
+		return 0;
+	}
+
+	//The pool is being moved and the copy would land in the buffer about to be replaced, the chunk is asked for again
+	//on a later update
+	if (deviceAllocator.IsMoving(chunkVertexAllocation) || deviceAllocator.IsMoving(chunkIndexAllocation))
+	{
+		chunkStreamer.MarkLoadFailed(slot);
+		return 0;
+	}
+
+	VkBuffer uploadBuffer;
+	VkDeviceMemory uploadBufferMemory;
+	CreateBuffer(chunkBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uploadBuffer, uploadBufferMemory, MEMORY_TAG_STAGING, ALLOCATION_SITE);
+
+	void *mapped;
+	vkMapMemory(logicalDevice, uploadBufferMemory, 0, chunkBytes, 0, &mapped);
+	memcpy(mapped, chunkData->data(), (size_t)chunkBytes);
+	vkUnmapMemory(logicalDevice, uploadBufferMemory);
+
+	//Only the slot's range changes hands, the rest of the pool keeps being drawn
+	VkBuffer vertexPool = deviceAllocator.GetBuffer(chunkVertexAllocation);
+	VkBuffer indexPool = deviceAllocator.GetBuffer(chunkIndexAllocation);
+	VkDeviceSize vertexOffset = sizeof(Vertex) * chunkSlotVertexCount * slot;
+	VkDeviceSize indexOffset = sizeof(uint32_t) * chunkSlotIndexCount * slot;
+
+	if (vertexBytes > 0)
+	{
+		uploadBatch->CopyBuffer(uploadBuffer, vertexPool, vertexBytes, 0, vertexOffset);
+		uploadBatch->ReleaseBuffer(vertexPool, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, vertexOffset, vertexBytes);
+	}
+	if (indexBytes > 0)
+	{
+		uploadBatch->CopyBuffer(uploadBuffer, indexPool, indexBytes, vertexBytes, indexOffset);
+		uploadBatch->ReleaseBuffer(indexPool, VK_ACCESS_INDEX_READ_BIT, indexOffset, indexBytes);
+	}
+	deviceAllocator.BeginWrite(chunkVertexAllocation);
+	deviceAllocator.BeginWrite(chunkIndexAllocation);
+
+	uploadBatch->OnComplete([this, uploadBuffer, uploadBufferMemory, slot, generation, chunkBytes]()
+	{
+		FreeDeviceMemory(uploadBufferMemory);
+		vkDestroyBuffer(logicalDevice, uploadBuffer, nullptr);
+
+		//Otherwise the pool was released along with its writes
+		if (generation == chunkPoolGeneration)
+		{
+			deviceAllocator.EndWrite(chunkVertexAllocation);
+			deviceAllocator.EndWrite(chunkIndexAllocation);
+			chunkStreamer.MarkLoaded(slot, chunkBytes);
+		}
+	});
+
+	return chunkBytes;
+}
+
+void VulkanBase::RefreshDrawResources()
+{
+	//Point the descriptor sets at the current resources, or the placeholders of evicted assets. Sets of frames still in
+	//flight are left alone, WaitForFrame rewrites each once its frame has completed
+	descriptorVersion++;
+
+	drawResourcesDirty = false;
+	drawContentVersion++;
+}
+
+void VulkanBase::windowResize(GLFWwindow *window, int width, int height)
+{
+	if (width == 0 || height == 0) 
+	{ 
+		return; 
+	}
+
+	VulkanBase *vulkan = (VulkanBase*)(glfwGetWindowUserPointer(window));
+
+	//Only record the event, the swapchain is rebuilt by the renderer once resizing stops
+	WindowEvent event = {};
+	event.type = WINDOW_EVENT_RESIZE;
+	event.width = width;
+	event.height = height;
+	event.time = std::chrono::steady_clock::now();
+	vulkan->windowEvents.Push(std::move(event));
+}
+
+void VulkanBase::keyPressed(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_PRESS)
 	{
-		RecreateSwapchain();
+		return;
 	}
 
-	endFrame = std::chrono::steady_clock::now();
+	VulkanBase *vulkan = (VulkanBase*)(glfwGetWindowUserPointer(window));
 
-	auto elapsedTime = std::chrono::duration_cast<std::chrono::duration<double>>(endFrame - startFrame).count();
+	//Keys change renderer state, so they are applied by the renderer rather than on the main thread
+	WindowEvent event = {};
+	event.type = WINDOW_EVENT_KEY;
+	event.key = key;
+	event.time = std::chrono::steady_clock::now();
+	vulkan->windowEvents.Push(std::move(event));
+}
 
-	if (elapsedTime > 0)
+void VulkanBase::ProcessWindowEvents()
+{
+	WindowEvent event;
+	while (windowEvents.Pop(event))
 	{
-		drawFrames++;
-		elapsedSum += elapsedTime;
+		if (event.type == WINDOW_EVENT_RESIZE)
+		{
+			if (!resizePending)
+			{
+				firstResizeEvent = event.time;
+			}
+			lastResizeEvent = event.time;
+			windowWidth = event.width;
+			windowHeight = event.height;
+			resizeEventCount++;
+			resizePending = true;
+		}
+		else if (event.type == WINDOW_EVENT_KEY)
+		{
+			handleKey(event.key);
+		}
 	}
 }
 
-void VulkanBase::UpdateUniformBuffer()
-{ 
-	glm::mat4 model = glm::scale(glm::mat4(), glm::vec3(0.05f, 0.05f, 0.05f));
-	model *= glm::rotate(glm::mat4(), glm::radians(105.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-	model *= glm::rotate(glm::mat4(), glm::radians(10.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	model *= glm::rotate(glm::mat4(), glm::radians(120.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model *= glm::translate(glm::mat4(), glm::vec3(-15.0f, 5.0f, 0.0f));
-	glm::mat4 view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	glm::mat4 projection = glm::perspective(glm::radians(65.0f), swapchainExtent.width / (float)swapchainExtent.height, 0.1f, 10.0f);
-	projection[1][1] *= -1; //Flip the y axis
-
-	UniformBufferObject ubo = {};
-	ubo.mvp = projection * view * model;
+void VulkanBase::handleKey(int key)
+{
+	if (key == GLFW_KEY_F12) //Dump the allocation registry
+	{
+		memoryTracker.ReportHeaps();
+		memoryTracker.WriteSnapshot("memory_snapshot.json");
+	}
+	else if (key >= GLFW_KEY_1 && key < GLFW_KEY_1 + (int)MAX_FRAMES_IN_FLIGHT) //Frames in flight
+	{
+		SetFramesInFlight((uint32_t)(key - GLFW_KEY_1) + 1);
+	}
+	else if (key == GLFW_KEY_P) //Next present mode
+	{
+		const VkPresentModeKHR presentModeCycle[] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+		const uint32_t cycleLength = sizeof(presentModeCycle) / sizeof(presentModeCycle[0]);
 
-	void *data;
-	vkMapMemory(logicalDevice, uniformStagingBufferMemory, 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(logicalDevice, uniformStagingBufferMemory);
+		uint32_t next = 0;
+		for (uint32_t i = 0; i < cycleLength; i++)
+		{
+			if (presentModeCycle[i] == requestedPresentMode)
+			{
+				next = (i + 1) % cycleLength;
+			}
+		}
+		SetPresentMode(presentModeCycle[next]);
+	}
+	else if (key == GLFW_KEY_R) //Record every frame or replay prerecorded buffers
+	{
+		SetRecordingMode(recordingMode == RECORD_PER_FRAME ? RECORD_PRERECORDED : RECORD_PER_FRAME);
+	}
+	else if (key == GLFW_KEY_L) //Frame pacing on or off
+	{
+		framePacingRequested = !framePacingRequested;
+		updateFramePacing();
 
-	copyBuffer(uniformStagingBuffer, uniformBuffer, sizeof(ubo));
+		if (framePacingRequested && framePacer.GetTargetFrameTime() == 0.0)
+		{
+			std::cout << "Frame pacing held off while presenting in " << presentModeName(swapchainPresentMode) << ".\n";
+		}
+	}
 }
 
-void VulkanBase::RecreateSwapchain()
+void VulkanBase::showAverages()
 {
-	//Wait until our we aren't doing anything
-	vkDeviceWaitIdle(logicalDevice);
+	double averageFPS = fpssum / fpscount;
+	double averageMSPF = mspfsum / mspfcount;
+	std::cout << "\n\nAverage FPS for scene: " << averageFPS << " frames per second.\n";
+	std::cout << "Average MSPF for scene: " << averageMSPF << " milliseconds per frame.\n";
 
-	vkDestroyImageView(logicalDevice, depthImageView, nullptr);
-	vkFreeMemory(logicalDevice, depthImageMemory, nullptr);
-	vkDestroyImage(logicalDevice, depthImage, nullptr);
+	if (resizeCount > 0)
+	{
+		std::cout << "Average resize latency: " << resizeLatencySum / resizeCount << " milliseconds over " << resizeCount << " resizes.\n";
+	}
 
-	vkDestroyImageView(logicalDevice, multisampleDepthImageView, nullptr);
-	vkFreeMemory(logicalDevice, multisampleDepthImageMemory, nullptr);
-	vkDestroyImage(logicalDevice, multisampleDepthImage, nullptr);
-	vkDestroyImageView(logicalDevice, multisampleColourImageView, nullptr);
-	vkFreeMemory(logicalDevice, multisampleColourImageMemory, nullptr);
-	vkDestroyImage(logicalDevice, multisampleColourImage, nullptr);
+	if (recreateCount > 0)
+	{
+		std::cout << "Average swapchain recreation time: " << recreateTimeSum / recreateCount << " milliseconds, " << recreateTimeMax << " worst hitch, ";
+		std::cout << pipelineRebuildCount << " of " << recreateCount << " recreations rebuilt the render pass and pipeline.\n";
+	}
 
-	//Destroy previous Vulkan systems
-	for (uint32_t i = 0; i < framebuffers.size(); i++)
+	const char *threadingMode = threadedFrameLoop ? "own thread" : "main thread";
+	if (simulationStepCount > 0)
 	{
-		vkDestroyFramebuffer(logicalDevice, framebuffers[i], nullptr);
+		std::cout << "Simulation on the " << threadingMode << ": " << simulationStepCount << " steps, " << simulationTimeSum / simulationStepCount << " milliseconds average CPU time per step.\n";
 	}
-	vkDestroyPipeline(logicalDevice, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
-	vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
-	for (uint32_t i = 0; i < swapchainImageViews.size(); i++)
+	if (renderFrameCount > 0)
 	{
-		vkDestroyImageView(logicalDevice, swapchainImageViews[i], nullptr);
+		std::cout << "Rendering on the " << threadingMode << ": " << renderFrameCount << " frames, " << renderTimeSum / renderFrameCount << " milliseconds average CPU time per frame, ";
+		std::cout << snapshotsConsumed << " snapshots drawn, " << snapshotsSuperseded << " superseded before drawing, " << snapshotsRepeated << " frames drew the previous snapshot again.\n";
 	}
 
-	//Create new ones
-	CreateSwapchain();
-	CreateSwapchainImageViews();
-	CreateRenderPass();
-	CreateGraphicsPipeline();
-	CreateDepthImageResources();
-	CreateFramebuffers();
-	CreateCommandBuffers();
-	RecordCommandBuffers();
+	//Record time covers gathering, recording and, prerecorded, checking whether the buffer is still current
+	for (uint32_t i = 0; i < RECORDING_MODE_COUNT; i++)
+	{
+		const RecordingStats &stats = recordingStats[i];
+		if (stats.frameCount == 0)
+		{
+			continue;
+		}
 
-	UpdateUniformBuffer();
-}
+		if (i == RECORD_PRERECORDED)
+		{
+			std::cout << "Prerecorded: " << stats.frameCount << " frames, " << stats.recordedCount << " recorded again, ";
+		}
+		else
+		{
+			std::cout << "Recorded per frame " << (secondaryCommandBuffers ? "into secondary buffers" : "inline") << ": " << stats.frameCount << " frames, ";
+			std::cout << (double)stats.secondaryCount / stats.frameCount << " secondary buffers per frame on " << jobSystem.GetWorkerCount() + 1 << " threads, ";
+		}
+		if (stats.recordedCount > 0)
+		{
+			std::cout << stats.drawCount / stats.recordedCount << " draws per recording, ";
+		}
+		std::cout << stats.recordTimeSum / stats.frameCount << " milliseconds average CPU time per frame";
+		if (stats.gpuTimedCount > 0)
+		{
+			std::cout << ", " << stats.gpuTimeSum / stats.gpuTimedCount << " milliseconds GPU";
+		}
+		std::cout << ".\n";
+	}
 
-void VulkanBase::CreateMultisampleTargets()
-{
-	VkFormat depthFormat = findDepthFormat();
+	framePacer.ReportMetrics();
+	jobSystem.ReportMetrics();
+	residencyManager.ReportMetrics();
+	assetLoader.ReportMetrics();
+	syncTimeline.ReportMetrics();
+	renderGraph.ReportMetrics();
 
-	CreateMultisampleImage(swapchainExtent.width, swapchainExtent.height, swapchainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, SAMPLE_COUNT, multisampleColourImage, multisampleColourImageMemory);
+	if (uploadCount > 0)
+	{
+		std::cout << "Upload batches on the " << (dedicatedTransferQueue ? "dedicated transfer" : "graphics") << " queue: " << uploadContext.GetSubmitCount() << ", " << uploadGpuTimeSum << " milliseconds of GPU time, ";
+		std::cout << uploadOverlapSum << " milliseconds overlapped with rendering.\n";
+	}
 
-	CreateImageView(multisampleColourImage, swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, multisampleColourImageView);
+	if (directUploadCount > 0)
+	{
+		std::cout << "Direct buffer writes: " << directUploadCount << ", " << directUploadTimeSum / directUploadCount << " milliseconds average CPU time.\n";
+	}
+	if (stagedUploadCount > 0)
+	{
+		std::cout << "Staged buffer uploads: " << stagedUploadCount << ", " << stagedUploadTimeSum / stagedUploadCount << " milliseconds average CPU time to record.\n";
+	}
+	//Frame time against how long the CPU blocked on frame fences and how long the GPU was busy. GPU time the CPU did
+	//not spend blocked on it ran alongside CPU work
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		const FramePacingStats &stats = framePacingStats[i];
+		if (stats.frameCount == 0)
+		{
+			continue;
+		}
 
-	CreateMultisampleImage(swapchainExtent.width, swapchainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, SAMPLE_COUNT, multisampleDepthImage, multisampleDepthImageMemory);
+		double frameTime = stats.frameTimeSum / stats.frameCount;
+		double fenceWait = stats.fenceWaitSum / stats.frameCount;
+		std::cout << i + 1 << " frames in flight: " << stats.frameCount << " frames, " << frameTime << " milliseconds average frame time, ";
+		std::cout << fenceWait << " milliseconds blocked on frame fences";
 
-	CreateImageView(multisampleDepthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, multisampleDepthImageView);
-}
+		if (stats.gpuTimedCount > 0)
+		{
+			double gpuTime = stats.gpuTimeSum / stats.gpuTimedCount;
+			double overlap = std::max(0.0, gpuTime - fenceWait);
+			double utilisation = frameTime > 0 ? std::min(1.0, gpuTime / frameTime) * 100.0 : 0.0;
+			std::cout << ", " << gpuTime << " milliseconds GPU (" << utilisation << "% busy), " << overlap << " milliseconds CPU/GPU overlap";
+		}
+		std::cout << ".\n";
+	}
 
-void VulkanBase::windowResize(GLFWwindow *window, int width, int height)
-{
-	if (width == 0 || height == 0) 
-	{ 
-		return; 
+	if (uniformUpdateCount > 0)
+	{
+		const char *uniformPath = uniformDirect ? "written in place" : (stagedUniformUpdates ? "through staging" : "written to mapped host memory");
+		std::cout << "Uniform updates " << uniformPath << ": " << uniformUpdateTimeSum / uniformUpdateCount << " milliseconds average CPU time per frame.\n";
 	}
 
-	VulkanBase *vulkan = (VulkanBase*)(glfwGetWindowUserPointer(window));
-	vulkan->RecreateSwapchain();
-}
+	if (chunkedModel)
+	{
+		chunkStreamer.ReportMetrics();
+	}
 
-void VulkanBase::showAverages()
-{
-	double averageFPS = fpssum / fpscount;
-	double averageMSPF = mspfsum / mspfcount;
-	std::cout << "\n\nAverage FPS for scene: " << averageFPS << " frames per second.\n";
-	std::cout << "Average MSPF for scene: " << averageMSPF << " milliseconds per frame.\n";
+	if (meshDecodeCount > 0)
+	{
+		std::cout << "GPU mesh decodes: " << meshDecodeCount << ", " << encodedUploadBytes << " bytes uploaded instead of " << decodedMeshBytes << " (" << (double)decodedMeshBytes / encodedUploadBytes << "x less upload traffic)";
+		if (meshDecodeTimedCount > 0)
+		{
+			std::cout << ", " << meshDecodeGpuTimeSum / meshDecodeTimedCount << " milliseconds average decode";
+		}
+		std::cout << ".\n";
+	}
+
+	if (defragmentSteps > 0)
+	{
+		std::cout << "Defragmentation: " << defragmentSteps << " steps, " << deviceAllocator.GetTotalBytesMoved() << " bytes moved, " << deviceAllocator.GetTotalBytesFreed() << " bytes released.\n";
+	}
 }
 
 void VulkanBase::windowTimer()
@@ -1564,6 +3670,17 @@ void VulkanBase::windowTimer()
 		{
 			glfwSetWindowShouldClose(window, GLFW_TRUE);
 		}		
+
+		//An equal share of the window for each frames in flight setting
+		if (framesInFlightSweep)
+		{
+			SetFramesInFlight((uint32_t)(elapsedTime * MAX_FRAMES_IN_FLIGHT / 60) + 1);
+		}
+
+		if (recordingModeSweep)
+		{
+			SetRecordingMode(elapsedTime < 30 ? RECORD_PER_FRAME : RECORD_PRERECORDED);
+		}
 	}
 }
 
@@ -1582,6 +3699,8 @@ uint32_t VulkanBase::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags p
 	}
 
 	std::cout << "No suitable memory types found on physical device.\n";
+
+	return UINT32_MAX;
 }
 
 VkFormat VulkanBase::findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
@@ -1609,50 +3728,79 @@ VkFormat VulkanBase::findDepthFormat()
 	return findSupportedFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
 }
 
-bool hasStencilComponent(VkFormat format)
-{
-	return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
-}
-
-void VulkanBase::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+SyncTicket VulkanBase::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize offset)
 {
 	VkCommandBuffer transferCommandBuffer = beginSingleTransferCommand();
 
 	VkBufferCopy copy_region = {};
-	//copy_region.srcOffset = 0;
-	//copy_region.dstOffset = 0;
+	copy_region.srcOffset = offset;
+	copy_region.dstOffset = offset;
 	copy_region.size = size;
 
 	vkCmdCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, 1, &copy_region);
 
-	endSingleTransferCommand(transferCommandBuffer);
+	return endSingleTransferCommand(transferCommandBuffer);
 }
 
-void VulkanBase::copyImage(VkImage srcImage, VkImage dstImage, uint32_t imageWidth, uint32_t imageHeight)
+UploadBatch *VulkanBase::beginUpload()
 {
-	VkCommandBuffer transferCommandBuffer = beginSingleTransferCommand();
+	return uploadBatch != nullptr ? uploadBatch : uploadContext.Begin();
+}
+
+void VulkanBase::endUpload(UploadBatch *batch)
+{
+	//Part of a larger batch, submitted by whoever opened it
+	if (batch == uploadBatch)
+	{
+		return;
+	}
+
+	//Graphics work submitted later is ordered after the batch, the CPU only hears back once it completes
+	batch->OnComplete([this, batch]() { reportUploadTimestamps(batch); });
+	batch->Submit();
+}
+
+void VulkanBase::reportUploadTimestamps(UploadBatch *batch)
+{
+	uint64_t uploadTimes[2];
+	if (!batch->GetTimestamps(uploadTimes[0], uploadTimes[1]))
+	{
+		return;
+	}
+
+	double uploadTime = (uploadTimes[1] - uploadTimes[0]) * timestampPeriod / 1000000.0;
+
+	//Overlap with the last execution of each frame in flight, anything above zero ran alongside rendering
+	double overlap = 0;
+	for (uint32_t i = 0; frameTimestamps && i < framesInFlight && i < maxTimestampedFrames; i++)
+	{
+		uint64_t frameTimes[2];
+		if (frameResources[i].ticket == 0)
+		{
+			continue;
+		}
 
-	VkImageSubresourceLayers subresource_layers = {};
-	subresource_layers.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	subresource_layers.baseArrayLayer = 0;
-	subresource_layers.mipLevel = 0;
-	subresource_layers.layerCount = 1;
+		if (vkGetQueryPoolResults(logicalDevice, timestampQueryPool, i * 2, 2, sizeof(frameTimes), frameTimes, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		{
+			continue;
+		}
 
-	VkImageCopy copy_region = {};
-	copy_region.srcSubresource = subresource_layers;
-	copy_region.dstSubresource = subresource_layers;
-	copy_region.srcOffset = { 0, 0, 0 };
-	copy_region.dstOffset = { 0, 0, 0 };
-	copy_region.extent.width = imageWidth;
-	copy_region.extent.height = imageHeight;
-	copy_region.extent.depth = 1;
+		uint64_t overlapStart = std::max(uploadTimes[0], frameTimes[0]);
+		uint64_t overlapEnd = std::min(uploadTimes[1], frameTimes[1]);
+		if (overlapEnd > overlapStart)
+		{
+			overlap += (overlapEnd - overlapStart) * timestampPeriod / 1000000.0;
+		}
+	}
 
-	vkCmdCopyImage(transferCommandBuffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy_region);
+	uploadCount++;
+	uploadGpuTimeSum += uploadTime;
+	uploadOverlapSum += overlap;
 
-	endSingleTransferCommand(transferCommandBuffer);
+	std::cout << "Upload GPU time: " << uploadTime << " milliseconds, " << overlap << " milliseconds overlapped with rendering.\n";
 }
 
-void VulkanBase::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory)
+void VulkanBase::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory, MemoryUsageTag tag, AllocationSite site)
 {
 	VkBufferCreateInfo buffer_info = {};
 	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1671,13 +3819,7 @@ void VulkanBase::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMem
 	VkMemoryRequirements memoryRequirements;
 	vkGetBufferMemoryRequirements(logicalDevice, buffer, &memoryRequirements);
 
-	VkMemoryAllocateInfo allocate_info = {};
-	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocate_info.pNext = nullptr;
-	allocate_info.allocationSize = memoryRequirements.size;
-	allocate_info.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, properties);
-
-	result = vkAllocateMemory(logicalDevice, &allocate_info, nullptr, &bufferMemory);
+	result = AllocateDeviceMemory(memoryRequirements.size, findMemoryType(memoryRequirements.memoryTypeBits, properties), tag, site, bufferMemory);
 	if (result == VK_SUCCESS)
 	{
 		std::cout << "Memory allocated to buffer successfully.\n";
@@ -1690,7 +3832,7 @@ void VulkanBase::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMem
 	}
 }
 
-void VulkanBase::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkSampleCountFlagBits samples, VkImage &image, VkDeviceMemory &imageMemory)
+void VulkanBase::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkSampleCountFlagBits samples, VkImage &image, VkDeviceMemory &imageMemory, MemoryUsageTag tag, AllocationSite site)
 {
 	VkImageCreateInfo image_info = {};
 	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1718,12 +3860,7 @@ void VulkanBase::CreateImage(uint32_t width, uint32_t height, VkFormat format, V
 	VkMemoryRequirements memoryRequirements;
 	vkGetImageMemoryRequirements(logicalDevice, image, &memoryRequirements);
 
-	VkMemoryAllocateInfo allocate_info = {};
-	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocate_info.allocationSize = memoryRequirements.size;
-	allocate_info.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, properties);
-
-	result = vkAllocateMemory(logicalDevice, &allocate_info, nullptr, &imageMemory);
+	result = AllocateDeviceMemory(memoryRequirements.size, findMemoryType(memoryRequirements.memoryTypeBits, properties), tag, site, imageMemory);
 	if (result == VK_SUCCESS)
 	{
 		std::cout << "Image memory allocated successfully.\n";
@@ -1732,46 +3869,31 @@ void VulkanBase::CreateImage(uint32_t width, uint32_t height, VkFormat format, V
 	vkBindImageMemory(logicalDevice, image, imageMemory, 0);
 }
 
-void VulkanBase::CreateMultisampleImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkSampleCountFlagBits samples, VkImage &image, VkDeviceMemory &imageMemory)
+VkResult VulkanBase::AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, MemoryUsageTag tag, AllocationSite site, VkDeviceMemory &memory)
 {
-	VkImageCreateInfo image_info = {};
-	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	image_info.pNext = nullptr;
-	image_info.flags = 0;
-	image_info.imageType = VK_IMAGE_TYPE_2D;
-	image_info.extent.width = width;
-	image_info.extent.height = height;
-	image_info.extent.depth = 1;
-	image_info.mipLevels = 1;
-	image_info.arrayLayers = 1;
-	image_info.format = format;
-	image_info.tiling = tiling;
-	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	image_info.usage = usage;
-	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	image_info.samples = samples; //RELEVANT FOR MULTI-SAMPLING
-
-	result = vkCreateImage(logicalDevice, &image_info, nullptr, &image);
-	if (result == VK_SUCCESS)
-	{
-		std::cout << "Image created successfully.\n";
-	}
-
-	VkMemoryRequirements memoryRequirements;
-	vkGetImageMemoryRequirements(logicalDevice, image, &memoryRequirements);
-
 	VkMemoryAllocateInfo allocate_info = {};
 	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocate_info.allocationSize = memoryRequirements.size;
-	allocate_info.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, properties);
+	allocate_info.pNext = nullptr;
+	allocate_info.allocationSize = size;
+	allocate_info.memoryTypeIndex = memoryTypeIndex;
 
-	result = vkAllocateMemory(logicalDevice, &allocate_info, nullptr, &imageMemory);
-	if (result == VK_SUCCESS)
+	VkResult allocateResult = vkAllocateMemory(logicalDevice, &allocate_info, nullptr, &memory);
+	if (allocateResult == VK_SUCCESS)
 	{
-		std::cout << "Image memory allocated successfully.\n";
+		memoryTracker.RecordAllocation(memory, size, memoryTypeIndex, tag, site);
+	}
+	else
+	{
+		std::cout << "Device memory allocation of " << size << " bytes for " << MemoryTracker::TagName(tag) << " failed in " << site.function << ".\n";
 	}
 
-	vkBindImageMemory(logicalDevice, image, imageMemory, 0);
+	return allocateResult;
+}
+
+void VulkanBase::FreeDeviceMemory(VkDeviceMemory memory)
+{
+	memoryTracker.RecordFree(memory);
+	vkFreeMemory(logicalDevice, memory, nullptr);
 }
 
 void VulkanBase::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView &imageView)
@@ -1803,21 +3925,8 @@ void VulkanBase::CreateImageView(VkImage image, VkFormat format, VkImageAspectFl
 
 VkCommandBuffer VulkanBase::beginSingleTransferCommand()
 {
-	VkCommandBufferAllocateInfo allocate_info = {};
-	allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocate_info.pNext = nullptr;
-	allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocate_info.commandPool = transferPool;
-	allocate_info.commandBufferCount = 1;
-
-	VkCommandBuffer transferCommandBuffer;
-	result = vkAllocateCommandBuffers(logicalDevice, &allocate_info, &transferCommandBuffer);
-	if (result == VK_SUCCESS)
-	{
-#ifdef DEBUG
-		std::cout << allocate_info.commandBufferCount << " command buffers allocated for transfer use.\n";
-#endif // DEBUG
-	}
+	//From the calling thread's own pool, returned with the rest of the pool when the frame completes
+	VkCommandBuffer transferCommandBuffer = transferPools.Allocate();
 
 	VkCommandBufferBeginInfo begin_info = {};
 	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -1833,7 +3942,7 @@ VkCommandBuffer VulkanBase::beginSingleTransferCommand()
 	return transferCommandBuffer;
 }
 
-void VulkanBase::endSingleTransferCommand(VkCommandBuffer transferCommandBuffer)
+SyncTicket VulkanBase::endSingleTransferCommand(VkCommandBuffer transferCommandBuffer)
 {
 	result = vkEndCommandBuffer(transferCommandBuffer);
 	if (result == VK_SUCCESS)
@@ -1849,73 +3958,8 @@ void VulkanBase::endSingleTransferCommand(VkCommandBuffer transferCommandBuffer)
 	submit_info.commandBufferCount = 1;
 	submit_info.pCommandBuffers = &transferCommandBuffer;
 
-	//NO FENCES USED - COULD BE USED TO EXECUTE MULTIPLE TRANSFERS OPERATIONS AND WAIT FOR ALL TO FINISH
-	vkQueueSubmit(graphicsQueue, 1, &submit_info, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
-
-	vkFreeCommandBuffers(logicalDevice, transferPool, 1, &transferCommandBuffer);
-}
-
-void VulkanBase::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
-{
-	VkCommandBuffer transferCommandBuffer = beginSingleTransferCommand();
-
-	VkImageMemoryBarrier image_barrier = {};
-	image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	image_barrier.pNext = nullptr;
-	image_barrier.oldLayout = oldLayout;
-	image_barrier.newLayout = newLayout;
-	image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	image_barrier.image = image;
-	image_barrier.subresourceRange.baseMipLevel = 0;
-	image_barrier.subresourceRange.levelCount = 1;
-	image_barrier.subresourceRange.baseArrayLayer = 0;
-	image_barrier.subresourceRange.layerCount = 1;
-
-	if (oldLayout == VK_IMAGE_LAYOUT_PREINITIALIZED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
-	{
-		image_barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-		image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_PREINITIALIZED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-	{
-		image_barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-		image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-	{
-		image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-	{
-		image_barrier.srcAccessMask = 0;
-		image_barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	}
-	else
-	{
-		std::cout << "Unsupported image layout transition.\n";
-	}
-
-	if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-	{
-		image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-		
-		if (hasStencilComponent(format))
-		{
-			image_barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-		}
-	}
-	else
-	{
-		image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	}
-
-
-	vkCmdPipelineBarrier(transferCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
-
-	endSingleTransferCommand(transferCommandBuffer);
+	//Later graphics work is ordered after the transfer, the command buffer is recycled with its pool
+	return syncTimeline.Submit(graphicsTimeline, submit_info);
 }
 
 void VulkanBase::showFPS(GLFWwindow *pWindow)
@@ -1937,7 +3981,20 @@ void VulkanBase::showFPS(GLFWwindow *pWindow)
 		std::stringstream ss;
 		ss << "Vulkan Comparison" << " " << " " << fps << " FPS.    " << mspf << " MSPF.";
 
-		glfwSetWindowTitle(pWindow, ss.str().c_str());
+		//Applied by the main thread, this may be running on the render thread
+		std::string title = ss.str();
+		jobSystem.Run(jobSystem.CreateMainThread([this, title]()
+		{
+			glfwSetWindowTitle(window, title.c_str());
+		}));
+
+		if (chunkedModel)
+		{
+			VkDeviceSize streamedBytes = chunkStreamer.GetStreamedBytes();
+			std::cout << chunkStreamer.GetResidentCount() << " chunks resident, " << chunkStreamer.GetVisibleCount() << " visible, ";
+			std::cout << (streamedBytes - lastStreamedBytes) / delta / (1024.0 * 1024.0) << " MB/s streamed.\n";
+			lastStreamedBytes = streamedBytes;
+		}
 
 		frames = 0;
 		lastTime = currentTime;
@@ -1973,4 +4030,42 @@ bool VulkanBase::checkValidationLayerSupport()
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+
+bool VulkanBase::checkInstanceExtensionSupport(const char *extensionName)
+{
+	uint32_t extensionCount;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+	for (const auto& extensionProperties : availableExtensions)
+	{
+		if (strcmp(extensionName, extensionProperties.extensionName) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool VulkanBase::checkDeviceExtensionSupport(const char *extensionName)
+{
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevices[0], nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevices[0], nullptr, &extensionCount, availableExtensions.data());
+
+	for (const auto& extensionProperties : availableExtensions)
+	{
+		if (strcmp(extensionName, extensionProperties.extensionName) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -11,12 +11,39 @@
 #include <array>
 #include <chrono>
 #include <unordered_map>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/hash.hpp"
 
 #include "ReadFile.h"
+#include "MemoryTracker.h"
+#include "DeviceAllocator.h"
+#include "ResidencyManager.h"
+#include "RenderTargetPool.h"
+#include "RenderGraph.h"
+#include "SyncTimeline.h"
+#include "UploadBatch.h"
+#include "CommandPoolRegistry.h"
+#include "TransferBenchmark.h"
+#include "AssetLoader.h"
+#include "MeshCodec.h"
+#include "MeshDecoder.h"
+#include "MeshChunkFile.h"
+#include "ChunkStreamer.h"
+#include "AssetPack.h"
+#include "CompressionBenchmark.h"
+#include "FramePacer.h"
+#include "TripleBuffer.h"
+#include "LockFreeQueue.h"
+#include "JobSystem.h"
+#include "JobBenchmark.h"
 #include "stb_image.h"
 #include "tiny_obj_loader.h"
 
@@ -74,6 +101,114 @@ struct UniformBufferObject {
 	glm::mat4 mvp;
 };
 
+//Smallest push constant size every device supports
+const uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+
+//Per-draw data pushed into the command buffer at record time for the vertexShaderPush.vert variant, larger per-frame
+//data stays in the uniform buffer
+struct PushConstantTransform {
+	glm::mat4 mvp;
+	uint32_t materialIndex;
+};
+static_assert(sizeof(PushConstantTransform) <= MAX_PUSH_CONSTANT_SIZE, "Push constant transform exceeds the guaranteed push constant size");
+
+//Everything the renderer takes from one simulation step, never written again once published. The projection is left to
+//the renderer as it depends on the swapchain extent
+struct FrameSnapshot
+{
+	uint64_t sequence;
+	double simulationTime; //Seconds since the simulation started
+	glm::mat4 model;
+	glm::mat4 view;
+	glm::vec3 cameraPosition; //In model space
+	uint32_t materialIndex;
+};
+
+enum WindowEventType
+{
+	WINDOW_EVENT_RESIZE,
+	WINDOW_EVENT_KEY
+};
+
+//Window input recorded by the GLFW callbacks on the main thread and applied by the renderer at the start of a frame
+struct WindowEvent
+{
+	WindowEventType type;
+	int key;
+	int width; //New window size of a resize
+	int height;
+	std::chrono::time_point<std::chrono::steady_clock> time;
+};
+
+//Upper bound on frames the CPU may record ahead of the GPU, each owns its own copy of the resources below
+const uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
+//How the frame's commands are recorded, R switches between them while running
+enum RecordingMode
+{
+	RECORD_PER_FRAME, //Recorded again every frame into a one time submit buffer from the frame's transient pool
+	RECORD_PRERECORDED, //Recorded once per frame and swapchain image for simultaneous use, replayed until what is drawn changes
+	RECORDING_MODE_COUNT
+};
+
+//Everything one frame in flight records and submits with, reused only once the submission that last used it completes
+struct FrameResources
+{
+	VkSemaphore imageAcquiredSemaphore;
+	VkSemaphore renderFinishedSemaphore;
+	VkCommandPool commandPool; //Reset as a whole before the frame records again
+	VkCommandBuffer commandBuffer;
+	std::vector<VkCommandBuffer> prerecordedBuffers; //One per swapchain image, from prerecordedPool
+	std::vector<uint64_t> prerecordedVersions; //drawContentVersion each buffer was recorded against
+	RecordingMode recordingMode; //Of the ticket's submission
+	VkDescriptorSet descriptorSet; //Points at this frame's region of the uniform buffer
+	uint64_t descriptorVersion; //descriptorVersion the set was last written against
+	VkDeviceSize uniformOffset;
+	SyncTicket ticket; //Submission the frame last rendered with, stands in for a per-frame fence
+	bool timestamped; //The ticket's submission wrote this frame's pair of timestamp queries
+};
+
+//Everything a frame's draws are recorded from, gathered once before recording so the threads recording draws only read
+//it. Draws are numbered copy by copy, every copy of the model in the stress grid repeats the same drawsPerCopy draws
+struct FrameDrawState
+{
+	VkFramebuffer framebuffer;
+	VkDescriptorSet descriptorSet;
+	VkBuffer vertexBuffer;
+	VkBuffer indexBuffer;
+	uint32_t indexCount; //Of the whole model or its placeholder, unused when drawing chunks
+	const std::vector<ChunkDraw> *chunkDraws; //Set while a streamed model is resident
+	uint32_t drawsPerCopy;
+	uint32_t drawCount;
+	uint32_t gridWidth; //Copies per row of the stress grid
+	VkPipeline pipeline;
+	bool pushTransforms; //Each copy's transform is pushed, otherwise every draw reads the uniform buffer
+	glm::mat4 modelViewProjection;
+	uint32_t materialIndex;
+};
+
+//CPU time recording and GPU time executing the frame's commands in one recording mode
+struct RecordingStats
+{
+	uint32_t frameCount;
+	double recordTimeSum; //Includes frames that only replayed a prerecorded buffer
+	uint32_t recordedCount; //Frames whose commands were recorded rather than replayed
+	uint64_t drawCount; //Over the recorded frames
+	uint64_t secondaryCount;
+	uint32_t gpuTimedCount;
+	double gpuTimeSum;
+};
+
+//Frame time, CPU blocking and GPU time accumulated while running with a given number of frames in flight
+struct FramePacingStats
+{
+	uint32_t frameCount;
+	double frameTimeSum;
+	double fenceWaitSum;
+	uint32_t gpuTimedCount;
+	double gpuTimeSum;
+};
+
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_LUNARG_standard_validation"
 };
@@ -82,7 +217,94 @@ const bool enableValidationLayers = false;
 
 const bool timedWindow = true;
 
-const bool multiCopy = false;
+//Sweep upload sizes and staging strategies at startup, written to transfer_benchmark.csv
+const bool transferBenchmark = false;
+
+const bool defragmentMemory = true;
+
+//Fragment a heap with buffers of mixed tags at startup and check compaction empties a block and keeps their contents
+const bool defragmentCheck = false;
+
+//Write buffers straight into device local memory when the CPU can map it, on UMA devices and with resizable BAR
+const bool directWriteBuffers = true;
+
+//Upload meshes in the MeshCodec encoding and expand them with a compute dispatch, needs shaders/meshdecode.spv
+const bool compressedMeshUpload = true;
+
+//Stream the model a chunk at a time from a cache on disk instead of uploading it whole. Models that would take more
+//than half the device local budget are streamed regardless
+const bool outOfCoreModel = false;
+
+//Hold the device local budget to what the drawn assets need and take the model out of the scene every few seconds, so
+//it and its texture are evicted and uploaded again
+const bool residencyCheck = false;
+
+//Frames recorded ahead of the GPU at startup, 1 to MAX_FRAMES_IN_FLIGHT. Keys 1 to 3 change it while running
+const uint32_t defaultFramesInFlight = 2;
+
+//Step through 1 to MAX_FRAMES_IN_FLIGHT frames in flight over the timed window so their averages can be compared
+const bool framesInFlightSweep = false;
+
+//Keep the decoded texture, model and chunk caches block compressed on disk, decompressed on the loader threads at load
+const bool compressAssetCache = true;
+
+//Measure the asset cache compression ratio, decompression throughput and load time against uncompressed caches at startup
+const bool compressionBenchmark = false;
+
+//Copy the uniforms through a staging buffer and a transfer submission every frame instead of writing persistently
+//mapped memory, only kept to compare frame and GPU times against the mapped paths
+const bool stagedUniformUpdates = false;
+
+//Push the transform with each draw instead of reading it from the uniform buffer, needs shaders/vertpush.spv and falls
+//back to the uniform buffer without it
+const bool pushConstantTransforms = true;
+
+//Present mode requested at startup, the closest one the surface supports is used. P cycles FIFO, MAILBOX, IMMEDIATE and
+//FIFO_RELAXED while running
+const VkPresentModeKHR defaultPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+//Milliseconds the frame loop is paced to, 0 runs uncapped. Only applied in the IMMEDIATE and MAILBOX present modes, FIFO
+//and FIFO_RELAXED already hold frames to vertical blank. L toggles pacing while running
+const double targetFrameTime = 1000.0 / 60.0;
+
+//Run the simulation and rendering on their own threads, handing frames over through a triple buffer. The main thread
+//is left polling window input, which GLFW requires of it
+const bool threadedFrameLoop = true;
+
+//Milliseconds between simulation steps on the simulation thread
+const double simulationTickTime = 1000.0 / 120.0;
+
+//Seconds the main thread sleeps waiting for window events while the frame threads run
+const double WINDOW_EVENT_TIMEOUT = 0.01;
+
+//Measure job spawn overhead and parallel_for scaling over 1 to 8 threads at startup
+const bool jobSystemBenchmark = false;
+
+//Record the frame's draws into secondary command buffers on the job system's threads instead of inline on the render
+//thread. Below SECONDARY_MIN_DRAWS draws a frame records into a single secondary buffer
+const bool secondaryCommandBuffers = true;
+const uint32_t SECONDARY_MIN_DRAWS = 64;
+const uint32_t SECONDARY_BUFFERS_PER_THREAD = 2; //Spare buffers for threads that finish early to take
+
+//Recording mode at startup
+const RecordingMode defaultRecordingMode = RECORD_PER_FRAME;
+
+//Spend the first half of the timed window recording every frame and the second replaying prerecorded buffers
+const bool recordingModeSweep = false;
+
+//Extra copies of the model drawn in a grid, each its own draw with its own pushed transform, to load the CPU with
+//recording. Without push constants the copies are drawn over each other
+const uint32_t stressCopyCount = 0;
+const float STRESS_GRID_SPACING = 2.5f;
+
+//Time recording a draw heavy frame on 1 to 16 threads at startup, against recording it inline
+const bool drawRecordingBenchmark = false;
+const uint32_t DRAW_BENCHMARK_COPIES = 16384;
+const uint32_t DRAW_BENCHMARK_THREADS[] = { 1, 2, 4, 8, 16 };
+const uint32_t DRAW_BENCHMARK_REPETITIONS = 5;
+
+//Fills a tightly packed RGBA8 image, returns false if the source could not be decoded
+typedef std::function<bool(uint8_t *pixels)> PixelWriter;
 
 class VulkanBase
 {
@@ -97,9 +319,14 @@ private:
 
 	const std::string MODEL_PATH = "models/vari3d.obj";
 	const std::string TEXTURE_PATH = "textures/vari3d.jpg";
+	const std::string MODEL_CHUNK_PATH = "models/vari3d.chunks";
+	const std::string MODEL_PACK_PATH = "models/vari3d.obj.pack";
+	const std::string TEXTURE_PACK_PATH = "textures/vari3d.jpg.pack";
 
 	uint32_t graphics_queue_family_index = UINT32_MAX;
 	uint32_t present_queue_family_index = UINT32_MAX;
+	uint32_t transfer_queue_family_index = UINT32_MAX; //Same as the graphics family when there is no transfer-only family
+	bool dedicatedTransferQueue = false;
 
 	//Timing/Testing variables
 	double lastTime = glfwGetTime();
@@ -120,6 +347,67 @@ private:
 	//Validation Handle
 	VkResult result;
 
+	//Registry of every device memory allocation, dumped on F12 and at exit
+	MemoryTracker memoryTracker;
+	bool physicalDeviceProperties2Enabled = false;
+	bool memoryBudgetEnabled = false;
+	bool timelineSemaphoreEnabled = false;
+
+	//Every submission is tracked by ticket, waits are on the tickets a resource depends on rather than whole queues
+	SyncTimeline syncTimeline;
+	uint32_t graphicsTimeline;
+	uint32_t transferTimeline; //Same as the graphics timeline when there is no dedicated transfer queue
+	SyncTicket lastFrameTicket = 0;
+
+	//The CPU runs up to framesInFlight frames ahead, blocking only on the frame whose resources it is about to reuse
+	std::array<FrameResources, MAX_FRAMES_IN_FLIGHT> frameResources = {};
+	uint32_t framesInFlight = defaultFramesInFlight;
+	uint32_t currentFrame = 0;
+	std::array<FramePacingStats, MAX_FRAMES_IN_FLIGHT> framePacingStats = {};
+	std::chrono::time_point<std::chrono::steady_clock> lastFrameStart;
+	double frameFenceWait = 0; //Blocked on the current frame's ticket so far this frame
+
+	//Sub-allocator for the device local buffers and images, compacted a little each frame
+	DeviceAllocator deviceAllocator;
+	const VkDeviceSize defragmentBytesPerFrame = 4 * 1024 * 1024;
+	int defragmentSteps = 0;
+
+	//Host visible device local memory buffers are written in place through, UINT32_MAX if the device has none. Uploads
+	//fall back to a staging copy when it is missing or its heap is out of budget
+	uint32_t directWriteMemoryType = UINT32_MAX;
+	uint32_t directWriteHeap = UINT32_MAX;
+	uint32_t directUploadCount = 0;
+	double directUploadTimeSum = 0;
+	uint32_t stagedUploadCount = 0;
+	double stagedUploadTimeSum = 0;
+
+	//Textures and meshes are evicted least recently used first when the device local heap is over budget and
+	//re-uploaded a few megabytes per frame once drawn again, placeholders are drawn in the meantime
+	ResidencyManager residencyManager;
+	uint32_t deviceLocalHeap;
+	uint32_t textureAsset;
+	uint32_t modelAsset;
+	const VkDeviceSize residencyUploadBytesPerFrame = 16 * 1024 * 1024;
+	bool drawResourcesDirty = false;
+	uint64_t descriptorVersion = 1; //Bumped when what the sets point at changes, each set is rewritten once its frame completes
+	VkDeviceSize evictingBytes = 0; //Of evicted assets whose memory goes once the frames drawing them complete
+
+	//The model and its texture are only stamped as used on frames its bounds are in view. The bounds are the unit cube
+	//until the model has been parsed
+	glm::vec3 modelBoundsMin = glm::vec3(-0.5f);
+	glm::vec3 modelBoundsMax = glm::vec3(0.5f);
+	bool modelHidden = false; //Taken out of the scene by the residency check
+	uint32_t residencyCheckFrames = 0;
+	const uint32_t residencyCheckPeriod = 300; //Frames the check keeps the model in and then out of the scene
+
+	//Textures and meshes are decoded on loader threads and swapped in once their upload completes, so the first frame
+	//does not wait on them
+	AssetLoader assetLoader;
+	bool firstFramePresented = false;
+
+	//Fine grained frame work is split into jobs across these workers, the threads waiting on it run jobs too
+	JobSystem jobSystem;
+
 	//Display context/window
 	VkSurfaceKHR surface;
 
@@ -131,84 +419,169 @@ private:
 	//Queue Handles
 	VkQueue graphicsQueue; //Handle on our graphics queue - Destroyed on Logical Device destruction (only when idle)
 	VkQueue presentQueue; //Handle on our present queue - Destroyed on Logical Device destruction (only when idle)
+	VkQueue transferQueue; //Handle on the queue uploads are submitted to, the graphics queue if there is no dedicated one
 
 	//Swapchain Information
 	VkFormat swapchainImageFormat; //Our chosen format for the swapchain from those available on the device
 	VkExtent2D swapchainExtent;
 	VkSwapchainKHR swapchain;
+	std::vector<VkImage> swapchainImages;
 	std::vector<VkImageView> swapchainImageViews;
 
-	//RenderPass/Subpass information
+	//Frame passes and the images they use. The graph owns the render passes and framebuffers, renderPass is the forward
+	//pass's for pipelines and inherited secondary buffers
+	RenderGraph renderGraph;
+	uint32_t backbufferImage;
+	uint32_t forwardPass;
 	VkRenderPass renderPass;
 
 	//Shader Information
 	VkShaderModule vertexShaderModule;
+	VkShaderModule uniformVertexShaderModule = VK_NULL_HANDLE; //Loaded beside the push constant variant for uniformPipeline
 	VkShaderModule fragmentShaderModule;
 	VkPipelineShaderStageCreateInfo shaderStages[2];
+	bool pushTransforms = false; //The push constant vertex shader variant is in use
 
 	//Descriptor Set Information - Uniform Buffer
 	VkDescriptorSetLayout descriptorSetLayout;
 	VkDescriptorPool descriptorPool;
-	VkDescriptorSet descriptorSet;
 
 	//Pipeline Creation
 	VkPipelineLayout pipelineLayout;
 	VkPipeline graphicsPipeline;
-
-	//Framebuffer Handles
-	std::vector<VkFramebuffer> framebuffers;
-
-	//Pools for command buffers
-	VkCommandPool commandPool;
-	VkCommandPool transferPool;
-
-	//Command buffers to record to
-	std::vector<VkCommandBuffer> commandBuffers;
-
-	//Semaphores Handles for rendering
-	VkSemaphore imageAcquiredSemaphore;
-	VkSemaphore renderFinishedSemaphore;
-
-	//Handle on staging buffer and its associated memory - used for transfer to local vertex buffer
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	//Handle on uniform staging buffer and its associated memory
-	VkBuffer uniformStagingBuffer;
-	VkDeviceMemory uniformStagingBufferMemory;
-
-	//Handle on uniform buffer and its associated memory
-	VkBuffer uniformBuffer;
-	VkDeviceMemory uniformBufferMemory;
-
-	//Handle on our vertex buffer and its associated memory
+	VkPipeline uniformPipeline; //Reads the transform from the uniform buffer, for prerecorded buffers. graphicsPipeline without push constants
+
+	//Pools for command buffers, the frame command pools are owned by their frames
+	CommandPoolRegistry transferPools; //Transient pools per recording thread, reset once the frame that used them completes
+	CommandPoolRegistry drawPools; //Secondary command buffers the frame's draws are recorded into, per job thread
+	std::vector<VkCommandBuffer> secondaryBuffers; //Of the frame being recorded, in draw order
+
+	//Prerecorded buffers are recorded again one at a time when what they draw has changed, never reset with the pool
+	RecordingMode recordingMode = defaultRecordingMode;
+	VkCommandPool prerecordedPool;
+	uint64_t drawContentVersion = 1; //Bumped whenever anything a prerecorded buffer draws or binds changes
+	RecordingStats recordingStats[RECORDING_MODE_COUNT] = {};
+
+	//Uploads are recorded into batches submitted once each, on the dedicated transfer queue when there is one
+	UploadContext uploadContext;
+	UploadBatch *uploadBatch = nullptr; //Open batch uploads are added to, each upload is submitted and waited on alone when null
+
+	//GPU timestamps, each frame in flight owns a pair
+	VkQueryPool timestampQueryPool;
+	const uint32_t maxTimestampedFrames = 8;
+	bool uploadTimestamps = false;
+	bool frameTimestamps = false;
+	bool graphicsCompute = false; //The graphics family can also dispatch compute
+	double timestampPeriod = 1.0; //Nanoseconds per tick
+	uint32_t uploadCount = 0;
+	double uploadGpuTimeSum = 0;
+	double uploadOverlapSum = 0;
+
+	//Host visible uniform buffer and its memory, mapped for the lifetime of the device when the uniform buffer cannot be
+	//device local and written in place. With stagedUniformUpdates it is only the copy source
+	VkBuffer uniformHostBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory uniformHostBufferMemory = VK_NULL_HANDLE;
+	uint8_t *uniformHostMapped = nullptr;
+
+	//Allocator handle for the device local uniform buffer, one aligned region per frame in flight. UINT32_MAX when the
+	//shaders read the host visible buffer directly
+	uint32_t uniformAllocation = UINT32_MAX;
+	VkDeviceSize uniformStride = 0;
+	bool uniformDirect = false;
+	uint32_t uniformUpdateCount = 0;
+	double uniformUpdateTimeSum = 0;
+
+	//Allocator handle for our vertex buffer, UINT32_MAX while the model is evicted
 	std::vector<Vertex> vertices;
-	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
+	uint32_t vertexAllocation = UINT32_MAX;
 
-	//Handle on our index buffer and its associated memory
+	//Allocator handle for our index buffer
 	std::vector<uint32_t> indices;
-	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
-
-	//Handle for our texture image, associated memory, its view and sampler
-	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
-	VkImageView textureImageView;
+	uint32_t indexAllocation = UINT32_MAX;
+
+	//Model stream as uploaded, expanded into the vertex and index buffers on the GPU. Empty when the model is uploaded
+	//as is, because compression is off or the decode shader is missing
+	MeshDecoder meshDecoder;
+	std::vector<uint8_t> encodedModel;
+	uint32_t meshDecodeCount = 0;
+	uint32_t meshDecodeTimedCount = 0;
+	VkDeviceSize encodedUploadBytes = 0;
+	VkDeviceSize decodedMeshBytes = 0;
+	double meshDecodeGpuTimeSum = 0;
+
+	//Present mode asked for and the one the swapchain was created with after falling back to what the surface supports
+	VkPresentModeKHR requestedPresentMode = defaultPresentMode;
+	VkPresentModeKHR swapchainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+	FramePacer framePacer;
+	bool framePacingRequested = targetFrameTime > 0; //Toggled by L, paced only while the present mode does not block
+
+	//Snapshots from the simulation to the renderer and window events from the main thread to the renderer. The renderer
+	//owns every Vulkan object, the main thread only polls input and runs the jobs created for it
+	TripleBuffer<FrameSnapshot> frameHandoff;
+	LockFreeQueue<WindowEvent, 64> windowEvents;
+	std::thread simulationThread;
+	std::thread renderThread;
+	std::atomic<bool> frameThreadsRunning{ false };
+	std::chrono::time_point<std::chrono::steady_clock> simulationStart;
+	uint64_t simulationSequence = 0;
+	uint64_t lastConsumedSequence = 0;
+
+	//CPU time spent per simulation step and per rendered frame, the render figure leaves out the pacing wait
+	uint32_t simulationStepCount = 0;
+	double simulationTimeSum = 0;
+	uint32_t renderFrameCount = 0;
+	double renderTimeSum = 0;
+	uint32_t snapshotsConsumed = 0;
+	uint64_t snapshotsSuperseded = 0; //Published and overwritten before the renderer took them
+	uint32_t snapshotsRepeated = 0; //Frames rendered again from the previous snapshot
+
+	//Out-of-core model, chunks are read from the chunk file into fixed size slots of two pool buffers. The pool is
+	//registered with the residency manager as the model's device copy
+	MeshChunkFile modelChunks;
+	ChunkStreamer chunkStreamer;
+	bool chunkedModel = false;
+	uint32_t chunkVertexAllocation = UINT32_MAX;
+	uint32_t chunkIndexAllocation = UINT32_MAX;
+	uint32_t chunkSlotVertexCount = 0;
+	uint32_t chunkSlotIndexCount = 0;
+	uint32_t chunkPoolGeneration = 0; //Bumped when the pool is released, reads begun against an older pool are dropped
+	VkDeviceSize lastStreamedBytes = 0;
+
+	//Matrices of the frame being built, chunks are culled with them
+	glm::mat4 frameModelViewProjection;
+	glm::vec3 frameCameraPosition; //In model space
+
+	//Allocator handle for our texture image, its view and sampler
+	uint32_t textureAllocation = UINT32_MAX;
+	VkImageView textureImageView = VK_NULL_HANDLE;
 	VkSampler textureSampler;
 
-	//Handles for our depth attachments
-	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
-	VkImageView depthImageView;
-
-	//Handle for Multisample resolve images
-	VkImage multisampleColourImage;
-	VkImage multisampleDepthImage;
-	VkDeviceMemory multisampleColourImageMemory;
-	VkDeviceMemory multisampleDepthImageMemory;
-	VkImageView multisampleColourImageView;
-	VkImageView multisampleDepthImageView;
+	//Drawn in place of assets still loading or evicted, a 1x1 white texture and the model's bounding box. The box is a
+	//unit cube until the model has been parsed
+	uint32_t placeholderTextureAllocation;
+	VkImageView placeholderTextureView;
+	uint32_t placeholderVertexAllocation;
+	uint32_t placeholderIndexAllocation;
+	uint32_t placeholderIndexCount;
+	bool placeholderFitsModel = false;
+
+	//Pool owning the render graph's transient attachments, handles index into the pool and survive swapchain recreation
+	RenderTargetPool renderTargetPool;
+
+	//Resize events are coalesced, the swapchain is only rebuilt once the size has been stable for resizeSettleTime seconds
+	const double resizeSettleTime = 0.1;
+	int windowWidth = 0; //Latest size from the resize events, so the renderer never asks GLFW off the main thread
+	int windowHeight = 0;
+	bool resizePending = false;
+	int resizeEventCount = 0;
+	std::chrono::time_point<std::chrono::steady_clock> firstResizeEvent;
+	std::chrono::time_point<std::chrono::steady_clock> lastResizeEvent;
+	int resizeCount = 0;
+	double resizeLatencySum = 0;
+	int recreateCount = 0;
+	double recreateTimeSum = 0;
+	double recreateTimeMax = 0;
+	int pipelineRebuildCount = 0;
 
 	//Initialise our systems
 	void InitialiseVulkan();
@@ -225,45 +598,92 @@ private:
 	void CreateDescriptorSetLayout();
 	void CreateGraphicsPipeline();
 	void CreateFramebuffers();
-	void CreateCommandPool(VkCommandPool &commandpool, VkCommandPoolCreateFlags flags);
-	void CreateDepthImageResources();
-	void CreateTextureImage();
+	void CreateCommandPool(VkCommandPool &commandpool, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags);
+	void CreateUploadResources();
+	void CreateRenderTargets();
+	void UploadTextureImage(const stbi_uc *pixels, int texWidth, int texHeight, uint32_t &imageAllocation);
+	void UploadTextureImage(int texWidth, int texHeight, const PixelWriter &writePixels, uint32_t &imageAllocation);
 	void CreateTextureImageView();
 	void CreateTextureSampler();
-	void CreateCommandBuffers();
-	void RecordCommandBuffers();
-	void CreateSemaphores();
-	void CreateModel();
+	void CreateFrameResources();
+	VkCommandBuffer RecordFrameCommands(FrameResources &frame, uint32_t imageIndex); //Returns the buffer to submit
+	void recordPrimary(VkCommandBuffer commandBuffer, VkCommandBufferUsageFlags usage, const FrameResources &frame, const FrameDrawState &state, uint32_t imageIndex, uint32_t secondaryCount);
+	FrameDrawState gatherDrawState(const FrameResources &frame, uint32_t imageIndex, uint32_t copyCount, bool pushed);
+	void recordDraws(VkCommandBuffer commandBuffer, const FrameDrawState &state, uint32_t firstDraw, uint32_t lastDraw);
+	uint32_t recordSecondaryBuffers(const FrameDrawState &state); //Returns how many of secondaryBuffers were recorded
+	void benchmarkDrawRecording();
+	void WaitForFrame(FrameResources &frame);
+	void SetFramesInFlight(uint32_t count);
+	void SetRecordingMode(RecordingMode mode);
+	VkPresentModeKHR ChoosePresentMode(const VkPresentModeKHR *availableModes, uint32_t availableCount) const;
+	void SetPresentMode(VkPresentModeKHR presentMode);
+	static const char *presentModeName(VkPresentModeKHR presentMode);
+	bool LoadModel(std::vector<Vertex> &modelVertices, std::vector<uint32_t> &modelIndices) const;
 	void CreateVertexBuffer();
 	void CreateIndexBuffer();
 	void CreateUniformBuffer();
 	void CreateDescriptorPool();
 	void CreateDescriptorSet();
-
-	void CreateMultisampleTargets();
+	void WriteDescriptorSet(FrameResources &frame);
+
+	void CreatePlaceholders();
+	void CreatePlaceholderBox(uint32_t &vertexAllocation, uint32_t &indexAllocation);
+
+	//Residency
+	uint32_t CreateDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsageTag tag, AllocationSite site);
+	uint32_t CreateDirectBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsageTag tag, AllocationSite site);
+	uint32_t CreateDeviceImage(const VkImageCreateInfo &imageInfo, VkImageAspectFlags aspect, MemoryUsageTag tag, AllocationSite site);
+	uint32_t UploadBuffer(const void *data, VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsageTag tag, AllocationSite site);
+	bool EvictLeastRecentlyUsed();
+	void EvictAsset(uint32_t asset);
+	void reclaimEvictedMemory();
+	void RequestAsset(uint32_t asset);
+	PixelWriter LoadTexture(int &texWidth, int &texHeight) const;
+	VkDeviceSize UploadTexture(int texWidth, int texHeight, const PixelWriter &writePixels);
+	VkDeviceSize UploadModel();
+	bool UploadEncodedModel();
+	std::vector<uint8_t> EncodeModel(const std::vector<Vertex> &modelVertices, const std::vector<uint32_t> &modelIndices) const;
+	bool BuildModelChunks(const std::vector<Vertex> &modelVertices, const std::vector<uint32_t> &modelIndices) const;
+	VkDeviceSize EnableChunkedModel(bool opened);
+	void UpdateChunks();
+	void RequestChunk(uint32_t chunk, uint32_t lod, uint32_t slot);
+	VkDeviceSize UploadChunk(uint32_t chunk, uint32_t lod, uint32_t slot, uint32_t generation, const std::vector<uint8_t> *chunkData);
+	void RefreshDrawResources();
 
 	//Abstract Helper Functions
-	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory);
-	void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkSampleCountFlagBits samples, VkImage &image, VkDeviceMemory &imageMemory);
-	void CreateMultisampleImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkSampleCountFlagBits samples, VkImage &image, VkDeviceMemory &imageMemory);
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory, MemoryUsageTag tag, AllocationSite site);
+	void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkSampleCountFlagBits samples, VkImage &image, VkDeviceMemory &imageMemory, MemoryUsageTag tag, AllocationSite site);
+	VkResult AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, MemoryUsageTag tag, AllocationSite site, VkDeviceMemory &memory);
+	void FreeDeviceMemory(VkDeviceMemory memory);
 	void CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView &imageView);
 
 	VkCommandBuffer beginSingleTransferCommand();
-	void endSingleTransferCommand(VkCommandBuffer transferCommandBuffer);
-	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+	SyncTicket endSingleTransferCommand(VkCommandBuffer transferCommandBuffer);
 
 	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 	VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 	VkFormat findDepthFormat();
 
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-	void copyImage(VkImage srcImage, VkImage dstImage, uint32_t imageWidth, uint32_t imageHeight);
+	SyncTicket copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize offset = 0);
+
+	UploadBatch *beginUpload();
+	void endUpload(UploadBatch *batch);
+	void reportUploadTimestamps(UploadBatch *batch);
 
 	void RecreateSwapchain();
+	void HandlePendingResize();
 
 	static void windowResize(GLFWwindow *window, int width, int height);
+	static void keyPressed(GLFWwindow *window, int key, int scancode, int action, int mods);
+	void ProcessWindowEvents();
+	void handleKey(int key);
+	void consumeSnapshot();
+	void simulationLoop();
+	void renderLoop();
 
 	bool checkValidationLayerSupport();
+	bool checkInstanceExtensionSupport(const char *extensionName);
+	bool checkDeviceExtensionSupport(const char *extensionName);
 
 public:
 	GLFWwindow *window;
@@ -279,6 +699,32 @@ public:
 	//Update the uniform buffer
 	void UpdateUniformBuffer();
 
+	//Move a few megabytes out of sparse device memory blocks and patch whatever referenced them
+	void Defragment();
+	void checkDefragmentation();
+
+	//Stamp the assets drawn this frame, evict over budget and re-upload what was drawn while evicted
+	void UpdateResidency();
+	bool isModelInView() const;
+	void getDeviceLocalBudget(VkDeviceSize &budget, VkDeviceSize &usage);
+
+	//Hold the loop to the target frame time
+	void PaceFrame();
+	void updateFramePacing();
+
+	//Advance the simulation one step and publish its snapshot to the renderer
+	void UpdateSimulation();
+
+	//Apply window events, take the newest snapshot and draw, update and pace one frame
+	void RenderFrame();
+
+	//Run UpdateSimulation and RenderFrame on their own threads until StopFrameThreads
+	void StartFrameThreads();
+	void StopFrameThreads();
+
+	//Main thread only, runs the jobs that call GLFW window functions, which may not be called from other threads
+	void RunMainThreadJobs();
+
 	//Handle our fps output to the GLFW window
 	void showFPS(GLFWwindow *pWindow);
 	void showAverages();
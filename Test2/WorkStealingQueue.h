@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//Bounded work-stealing deque after Chase and Lev. The owning thread pushes and pops at the bottom, newest first, while
+//other threads steal the oldest from the top. Only a steal racing the owner for the last element needs a compare
+//exchange. Capacity must be a power of two and T trivially copyable
+template<typename T, size_t Capacity>
+class WorkStealingQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "WorkStealingQueue capacity must be a power of two");
+
+public:
+	WorkStealingQueue() : top(0), bottom(0) {}
+
+	WorkStealingQueue(const WorkStealingQueue&) = delete;
+	WorkStealingQueue &operator=(const WorkStealingQueue&) = delete;
+
+	//Owner only, returns false when the queue is full
+	bool Push(T value)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= (int64_t)Capacity)
+		{
+			return false;
+		}
+
+		cells[b & (Capacity - 1)].store(value, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	//Owner only, returns false when the queue is empty or a thief took the last element
+	bool Pop(T &value)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		value = cells[b & (Capacity - 1)].load(std::memory_order_relaxed);
+		if (t != b)
+		{
+			return true;
+		}
+
+		//Last element, whoever moves top first has it
+		bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_relaxed);
+
+		return won;
+	}
+
+	//Any thread, returns false when the queue is empty or another thread got there first
+	bool Steal(T &value)
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+
+		if (t >= b)
+		{
+			return false;
+		}
+
+		value = cells[t & (Capacity - 1)].load(std::memory_order_relaxed);
+
+		return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+private:
+	//Top is written by thieves and bottom by the owner, padded apart so they do not share a cache line
+	std::atomic<int64_t> top;
+	char topPadding[64 - sizeof(std::atomic<int64_t>)];
+	std::atomic<int64_t> bottom;
+	char bottomPadding[64 - sizeof(std::atomic<int64_t>)];
+
+	std::atomic<T> cells[Capacity];
+};
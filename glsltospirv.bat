@@ -1,3 +1,5 @@
 C:/VulkanSDK/1.0.37.0/Bin/glslangValidator.exe -V vertexShader.vert
 C:/VulkanSDK/1.0.37.0/Bin/glslangValidator.exe -V fragmentShader.frag
+C:/VulkanSDK/1.0.37.0/Bin/glslangValidator.exe -V vertexShaderPush.vert -o Test2/shaders/vertpush.spv
+C:/VulkanSDK/1.0.37.0/Bin/glslangValidator.exe -V meshdecode.comp -o Test2/shaders/meshdecode.spv
 pause
\ No newline at end of file
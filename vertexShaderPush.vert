@@ -0,0 +1,28 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+//Variant of vertexShader.vert taking the transform from push constants, laid out as PushConstantTransform. Compile to
+//shaders/vertpush.spv with glslangValidator -V vertexShaderPush.vert -o Test2/shaders/vertpush.spv
+layout (push_constant) uniform PushConstantTransform {
+	mat4 mvp;
+	uint materialIndex;
+} transform;
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inColor;
+layout (location = 2) in vec2 inTexCoord;
+
+layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec2 fragTexCoord;
+
+out gl_PerVertex 
+{
+    vec4 gl_Position;
+};
+	
+void main() 
+{
+    gl_Position = transform.mvp * vec4(inPosition, 1.0);
+    fragColor = inColor;
+	fragTexCoord = inTexCoord;
+}
\ No newline at end of file